@@ -1,2 +1,7 @@
+export 'src/cipher_mode.dart';
+export 'src/playback_event.dart';
 export 'src/player.dart';
+export 'src/player_stats.dart';
 export 'src/player_state.dart';
+export 'src/recording_event.dart';
+export 'src/waveform_bar.dart';
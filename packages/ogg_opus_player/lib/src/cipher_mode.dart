@@ -0,0 +1,8 @@
+/// Cipher of a file played with [OggOpusPlayer.encryptedFile].
+enum CipherMode {
+  /// AES in counter mode, the iv is the initial 128 bit big endian counter.
+  aesCtr,
+
+  /// AES in cipher block chaining mode with PKCS#7 padding.
+  aesCbc,
+}
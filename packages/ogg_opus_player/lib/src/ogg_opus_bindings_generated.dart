@@ -26,6 +26,9 @@ class OggOpusBindings {
           lookup)
       : _lookup = lookup;
 
+  /// Play an ogg opus file. This and the other create functions return NULL if
+  /// the audio output can not be opened or 32 players already exist, the
+  /// players share one output with a slot for each.
   ffi.Pointer<ffi.Void> ogg_opus_player_create(
     ffi.Pointer<ffi.Char> file_path,
     int send_port,
@@ -43,6 +46,178 @@ class OggOpusBindings {
   late final _ogg_opus_player_create = _ogg_opus_player_createPtr
       .asFunction<ffi.Pointer<ffi.Void> Function(ffi.Pointer<ffi.Char>, int)>();
 
+  /// Play an ogg opus stream held in memory. |data| is not copied, it must stay
+  /// valid until the player posts [2, 0] to |send_port| or
+  /// ogg_opus_player_dispose returns, whichever comes first, see
+  /// ogg_opus_player_enqueue_memory.
+  ffi.Pointer<ffi.Void> ogg_opus_player_create_from_memory(
+    ffi.Pointer<ffi.Uint8> data,
+    int length,
+    int send_port,
+  ) {
+    return _ogg_opus_player_create_from_memory(
+      data,
+      length,
+      send_port,
+    );
+  }
+
+  late final _ogg_opus_player_create_from_memoryPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Void> Function(ffi.Pointer<ffi.Uint8>,
+              ffi.Int64, ffi.Int64)>>('ogg_opus_player_create_from_memory');
+  late final _ogg_opus_player_create_from_memory =
+      _ogg_opus_player_create_from_memoryPtr
+          .asFunction<
+              ffi.Pointer<ffi.Void> Function(ffi.Pointer<ffi.Uint8>, int, int)>();
+
+  /// Play an ogg opus stream that is still being downloaded, its bytes are pushed
+  /// with ogg_opus_player_append_data. Playback starts once the first pages
+  /// arrived. If the player runs out of bytes it posts 2 to |send_port| and keeps
+  /// waiting instead of ending, 3 is posted once playback continues.
+  ffi.Pointer<ffi.Void> ogg_opus_player_create_streaming(
+    int send_port,
+  ) {
+    return _ogg_opus_player_create_streaming(
+      send_port,
+    );
+  }
+
+  late final _ogg_opus_player_create_streamingPtr =
+      _lookup<ffi.NativeFunction<ffi.Pointer<ffi.Void> Function(ffi.Int64)>>(
+          'ogg_opus_player_create_streaming');
+  late final _ogg_opus_player_create_streaming =
+      _ogg_opus_player_create_streamingPtr
+          .asFunction<ffi.Pointer<ffi.Void> Function(int)>();
+
+  /// Like ogg_opus_player_create_streaming, but the bytes are read from a file
+  /// another writer is still appending to. The file does not need to exist yet.
+  ffi.Pointer<ffi.Void> ogg_opus_player_create_from_growing_file(
+    ffi.Pointer<ffi.Char> file_path,
+    int send_port,
+  ) {
+    return _ogg_opus_player_create_from_growing_file(
+      file_path,
+      send_port,
+    );
+  }
+
+  late final _ogg_opus_player_create_from_growing_filePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Void> Function(ffi.Pointer<ffi.Char>,
+              ffi.Int64)>>('ogg_opus_player_create_from_growing_file');
+  late final _ogg_opus_player_create_from_growing_file =
+      _ogg_opus_player_create_from_growing_filePtr
+          .asFunction<
+              ffi.Pointer<ffi.Void> Function(ffi.Pointer<ffi.Char>, int)>();
+
+  /// Append |length| bytes to a player created by ogg_opus_player_create_streaming,
+  /// the bytes are copied.
+  void ogg_opus_player_append_data(
+    ffi.Pointer<ffi.Void> player,
+    ffi.Pointer<ffi.Uint8> data,
+    int length,
+  ) {
+    return _ogg_opus_player_append_data(
+      player,
+      data,
+      length,
+    );
+  }
+
+  late final _ogg_opus_player_append_dataPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Void>,
+              ffi.Pointer<ffi.Uint8>,
+              ffi.Int64)>>('ogg_opus_player_append_data');
+  late final _ogg_opus_player_append_data =
+      _ogg_opus_player_append_dataPtr
+          .asFunction<
+              void Function(ffi.Pointer<ffi.Void>, ffi.Pointer<ffi.Uint8>, int)>();
+
+  /// No more bytes will arrive for a streaming or growing file player, playback
+  /// ends normally once the remaining bytes were played.
+  void ogg_opus_player_end_of_data(
+    ffi.Pointer<ffi.Void> player,
+  ) {
+    return _ogg_opus_player_end_of_data(
+      player,
+    );
+  }
+
+  late final _ogg_opus_player_end_of_dataPtr =
+      _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<ffi.Void>)>>(
+          'ogg_opus_player_end_of_data');
+  late final _ogg_opus_player_end_of_data =
+      _ogg_opus_player_end_of_dataPtr
+          .asFunction<void Function(ffi.Pointer<ffi.Void>)>();
+
+  /// Play an ogg opus stream read through |callbacks|, which are copied.
+  /// |user_data| is passed to every callback.
+  ffi.Pointer<ffi.Void> ogg_opus_player_create_from_callbacks(
+    ffi.Pointer<OggOpusPlayerCallbacks> callbacks,
+    ffi.Pointer<ffi.Void> user_data,
+    int send_port,
+  ) {
+    return _ogg_opus_player_create_from_callbacks(
+      callbacks,
+      user_data,
+      send_port,
+    );
+  }
+
+  late final _ogg_opus_player_create_from_callbacksPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Void> Function(ffi.Pointer<OggOpusPlayerCallbacks>,
+              ffi.Pointer<ffi.Void>,
+              ffi.Int64)>>('ogg_opus_player_create_from_callbacks');
+  late final _ogg_opus_player_create_from_callbacks =
+      _ogg_opus_player_create_from_callbacksPtr
+          .asFunction<
+              ffi.Pointer<ffi.Void> Function(ffi.Pointer<OggOpusPlayerCallbacks>,
+                  ffi.Pointer<ffi.Void>, int)>();
+
+  /// Play an AES encrypted ogg opus file. |mode| is OGG_OPUS_CIPHER_AES_CTR, the
+  /// |iv| is the initial big endian counter, or OGG_OPUS_CIPHER_AES_CBC with
+  /// PKCS#7 padding. |key| is 16, 24 or 32 bytes and |iv| 16 bytes, both are
+  /// copied and may be wiped once the call returns. Pages are decrypted in
+  /// memory as they are decoded, seeking only decrypts the blocks it reads.
+  /// Return NULL if the key, the mode or the file is invalid.
+  ffi.Pointer<ffi.Void> ogg_opus_player_create_encrypted(
+    ffi.Pointer<ffi.Char> file_path,
+    int mode,
+    ffi.Pointer<ffi.Uint8> key,
+    int key_length,
+    ffi.Pointer<ffi.Uint8> iv,
+    int send_port,
+  ) {
+    return _ogg_opus_player_create_encrypted(
+      file_path,
+      mode,
+      key,
+      key_length,
+      iv,
+      send_port,
+    );
+  }
+
+  late final _ogg_opus_player_create_encryptedPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Void> Function(
+              ffi.Pointer<ffi.Char>,
+              ffi.Int32,
+              ffi.Pointer<ffi.Uint8>,
+              ffi.Int32,
+              ffi.Pointer<ffi.Uint8>,
+              ffi.Int64)>>('ogg_opus_player_create_encrypted');
+  late final _ogg_opus_player_create_encrypted =
+      _ogg_opus_player_create_encryptedPtr.asFunction<
+          ffi.Pointer<ffi.Void> Function(ffi.Pointer<ffi.Char>, int,
+              ffi.Pointer<ffi.Uint8>, int, ffi.Pointer<ffi.Uint8>, int)>();
+
+  /// Control calls do not block on the audio thread. They post a command the
+  /// audio callback applies at the start of its next buffer, a later command
+  /// of the same kind replaces one that was not applied yet.
   void ogg_opus_player_pause(
     ffi.Pointer<ffi.Void> player,
   ) {
@@ -100,6 +275,7 @@ class OggOpusBindings {
       _ogg_opus_player_get_current_timePtr
           .asFunction<double Function(ffi.Pointer<ffi.Void>)>();
 
+  /// |rate| is clamped to [0.5, 3], 1 is normal speed.
   void ogg_opus_player_set_playback_rate(
     ffi.Pointer<ffi.Void> player,
     double rate,
@@ -118,6 +294,145 @@ class OggOpusBindings {
       _ogg_opus_player_set_playback_ratePtr
           .asFunction<void Function(ffi.Pointer<ffi.Void>, double)>();
 
+  /// Seek to |seconds|. Takes effect on the next audio callback, until then
+  /// ogg_opus_player_get_current_time reports the target position.
+  void ogg_opus_player_seek(
+    ffi.Pointer<ffi.Void> player,
+    double seconds,
+  ) {
+    return _ogg_opus_player_seek(
+      player,
+      seconds,
+    );
+  }
+
+  late final _ogg_opus_player_seekPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Void>,
+              ffi.Double)>>('ogg_opus_player_seek');
+  late final _ogg_opus_player_seek =
+      _ogg_opus_player_seekPtr
+          .asFunction<void Function(ffi.Pointer<ffi.Void>, double)>();
+
+  /// Linear gain of the player in the shared mixer, 1.0 is unchanged, clamped
+  /// to [0, 4].
+  void ogg_opus_player_set_volume(
+    ffi.Pointer<ffi.Void> player,
+    double volume,
+  ) {
+    return _ogg_opus_player_set_volume(
+      player,
+      volume,
+    );
+  }
+
+  late final _ogg_opus_player_set_volumePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Void>,
+              ffi.Double)>>('ogg_opus_player_set_volume');
+  late final _ogg_opus_player_set_volume =
+      _ogg_opus_player_set_volumePtr
+          .asFunction<void Function(ffi.Pointer<ffi.Void>, double)>();
+
+  /// Queue a file to play right after the current stream and everything queued
+  /// before it, without a gap. It is opened right away and decoded ahead while
+  /// the previous track plays. Each transition posts a list [1, track_index,
+  /// queued_tracks] to the send port, |track_index| counts from 0, the stream
+  /// the player was created with. A seek applies to the track that is playing.
+  /// Return 0 on success, -1 if the file could not be opened.
+  int ogg_opus_player_enqueue_file(
+    ffi.Pointer<ffi.Void> player,
+    ffi.Pointer<ffi.Char> file_path,
+  ) {
+    return _ogg_opus_player_enqueue_file(
+      player,
+      file_path,
+    );
+  }
+
+  late final _ogg_opus_player_enqueue_filePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int Function(ffi.Pointer<ffi.Void>,
+              ffi.Pointer<ffi.Char>)>>('ogg_opus_player_enqueue_file');
+  late final _ogg_opus_player_enqueue_file =
+      _ogg_opus_player_enqueue_filePtr
+          .asFunction<
+              int Function(ffi.Pointer<ffi.Void>, ffi.Pointer<ffi.Char>)>();
+
+  /// Like ogg_opus_player_enqueue_file, for a stream in memory. |data| is not
+  /// copied, it must stay valid until the player posts [2, track_index] to the
+  /// send port or ogg_opus_player_dispose returns. |track_index| of the first
+  /// track enqueued is 1. The list is posted for every track, once the track
+  /// after it started playing, and for the remaining ones during dispose.
+  int ogg_opus_player_enqueue_memory(
+    ffi.Pointer<ffi.Void> player,
+    ffi.Pointer<ffi.Uint8> data,
+    int length,
+  ) {
+    return _ogg_opus_player_enqueue_memory(
+      player,
+      data,
+      length,
+    );
+  }
+
+  late final _ogg_opus_player_enqueue_memoryPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int Function(ffi.Pointer<ffi.Void>,
+              ffi.Pointer<ffi.Uint8>,
+              ffi.Int64)>>('ogg_opus_player_enqueue_memory');
+  late final _ogg_opus_player_enqueue_memory =
+      _ogg_opus_player_enqueue_memoryPtr
+          .asFunction<
+              int Function(ffi.Pointer<ffi.Void>, ffi.Pointer<ffi.Uint8>, int)>();
+
+  /// Post playback events to the player's send port every |milliseconds| while
+  /// it plays, and right after each state change. 0, the default, stops them.
+  /// Events are posted from a helper thread, never from the audio callback.
+  /// Each event is a list [0, position, buffered_position, peak, underruns, state]:
+  /// |position| and |buffered_position|, the end of the decoded pcm, in seconds,
+  /// |peak| the largest absolute sample since the last event in [0, 1],
+  /// |underruns| the count of audio callbacks that ran out of decoded pcm,
+  /// |state| 0 paused, 1 playing, 2 buffering, 3 ended.
+  void ogg_opus_player_set_event_interval(
+    ffi.Pointer<ffi.Void> player,
+    int milliseconds,
+  ) {
+    return _ogg_opus_player_set_event_interval(
+      player,
+      milliseconds,
+    );
+  }
+
+  late final _ogg_opus_player_set_event_intervalPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Void>,
+              ffi.Int32)>>('ogg_opus_player_set_event_interval');
+  late final _ogg_opus_player_set_event_interval =
+      _ogg_opus_player_set_event_intervalPtr
+          .asFunction<void Function(ffi.Pointer<ffi.Void>, int)>();
+
+  /// Copy the instrumentation of |player| to |stats|. Cheap and lock-free, may
+  /// be polled from any thread.
+  void ogg_opus_player_get_stats(
+    ffi.Pointer<ffi.Void> player,
+    ffi.Pointer<OggOpusPlayerStats> stats,
+  ) {
+    return _ogg_opus_player_get_stats(
+      player,
+      stats,
+    );
+  }
+
+  late final _ogg_opus_player_get_statsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Void>,
+              ffi.Pointer<OggOpusPlayerStats>)>>('ogg_opus_player_get_stats');
+  late final _ogg_opus_player_get_stats =
+      _ogg_opus_player_get_statsPtr.asFunction<
+          void Function(
+              ffi.Pointer<ffi.Void>, ffi.Pointer<OggOpusPlayerStats>)>();
+
   void ogg_opus_player_initialize_dart(
     ffi.Pointer<ffi.Void> native_port,
   ) {
@@ -133,6 +448,193 @@ class OggOpusBindings {
       _ogg_opus_player_initialize_dartPtr
           .asFunction<void Function(ffi.Pointer<ffi.Void>)>();
 
+  /// Open the shared output device paused and prepare |count| idle playback
+  /// contexts for streams with |channels| channels, so the next players only
+  /// have to open their reader. Disposed players return their context to the
+  /// pool as well. Return 0 on success, -1 if the device could not be opened.
+  int ogg_opus_player_warm_up(
+    int count,
+    int channels,
+  ) {
+    return _ogg_opus_player_warm_up(
+      count,
+      channels,
+    );
+  }
+
+  late final _ogg_opus_player_warm_upPtr =
+      _lookup<ffi.NativeFunction<ffi.Int Function(ffi.Int32, ffi.Int32)>>(
+          'ogg_opus_player_warm_up');
+  late final _ogg_opus_player_warm_up =
+      _ogg_opus_player_warm_upPtr.asFunction<int Function(int, int)>();
+
+  /// Decode, time stretch and mix in float and open the shared output device with
+  /// float samples if it supports them, instead of int16. Must be called before
+  /// the first player is created or warmed up. Return 0 on success, -1 if the
+  /// device is already open.
+  int ogg_opus_player_set_float_pipeline(
+    int enabled,
+  ) {
+    return _ogg_opus_player_set_float_pipeline(
+      enabled,
+    );
+  }
+
+  late final _ogg_opus_player_set_float_pipelinePtr =
+      _lookup<ffi.NativeFunction<ffi.Int Function(ffi.Int32)>>(
+          'ogg_opus_player_set_float_pipeline');
+  late final _ogg_opus_player_set_float_pipeline =
+      _ogg_opus_player_set_float_pipelinePtr.asFunction<int Function(int)>();
+
+  /// Low latency mode of the shared output device: open it with a buffer of
+  /// |min_frames| frames and double the buffer, up to |max_frames|, whenever
+  /// an audio callback came late. 0 for both restores the fixed 1024 frames.
+  /// Must be called before the first player is created or warmed up. Return 0
+  /// on success, -1 if the device is already open.
+  int ogg_opus_player_set_latency_mode(
+    int min_frames,
+    int max_frames,
+  ) {
+    return _ogg_opus_player_set_latency_mode(
+      min_frames,
+      max_frames,
+    );
+  }
+
+  late final _ogg_opus_player_set_latency_modePtr =
+      _lookup<ffi.NativeFunction<ffi.Int Function(ffi.Int32, ffi.Int32)>>(
+          'ogg_opus_player_set_latency_mode');
+  late final _ogg_opus_player_set_latency_mode =
+      _ogg_opus_player_set_latency_modePtr.asFunction<int Function(int, int)>();
+
+  /// Byte budget of the process wide cache of decoded pcm, keyed by path,
+  /// modification time and size. A file is cached once a player decoded it from
+  /// start to end, later players of the file and seeks of that player are
+  /// served from memory without decoding. Least recently used files are evicted
+  /// first. 0 disables the cache, the default is 32 MiB.
+  void ogg_opus_player_set_pcm_cache_size(
+    int bytes,
+  ) {
+    return _ogg_opus_player_set_pcm_cache_size(
+      bytes,
+    );
+  }
+
+  late final _ogg_opus_player_set_pcm_cache_sizePtr =
+      _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Int64)>>(
+          'ogg_opus_player_set_pcm_cache_size');
+  late final _ogg_opus_player_set_pcm_cache_size =
+      _ogg_opus_player_set_pcm_cache_sizePtr.asFunction<void Function(int)>();
+
+  /// Map files into memory instead of reading them with stdio, players of the
+  /// same file then share its page cache pages. Off by default: truncating or
+  /// rewriting a mapped file in place, e.g. recording over a file that is still
+  /// played, raises SIGBUS on Linux and crashes the app. Only enable it if the
+  /// played files never change. Players created after the call use it.
+  void ogg_opus_player_set_memory_mapping(
+    int enabled,
+  ) {
+    return _ogg_opus_player_set_memory_mapping(
+      enabled,
+    );
+  }
+
+  late final _ogg_opus_player_set_memory_mappingPtr =
+      _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Int32)>>(
+          'ogg_opus_player_set_memory_mapping');
+  late final _ogg_opus_player_set_memory_mapping =
+      _ogg_opus_player_set_memory_mappingPtr.asFunction<void Function(int)>();
+
+  /// Scan |file_path| once and record the byte offset of every ogg page with
+  /// its granule position, players of the file then seek with a single jump
+  /// instead of bisecting the file. If |index_path| is not null, the index is
+  /// loaded from it if it still matches the file and written back, so it
+  /// survives restarts. The part of a file that grew since it was indexed is
+  /// scanned incrementally, also when a player of the file is created. Chained
+  /// files are not indexed. Return the count of checkpoints, or -1 on error.
+  int ogg_opus_player_build_seek_index(
+    ffi.Pointer<ffi.Char> file_path,
+    ffi.Pointer<ffi.Char> index_path,
+  ) {
+    return _ogg_opus_player_build_seek_index(
+      file_path,
+      index_path,
+    );
+  }
+
+  late final _ogg_opus_player_build_seek_indexPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<ffi.Char>,
+              ffi.Pointer<ffi.Char>)>>('ogg_opus_player_build_seek_index');
+  late final _ogg_opus_player_build_seek_index =
+      _ogg_opus_player_build_seek_indexPtr.asFunction<
+          int Function(ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Char>)>();
+
+  /// Latency of the shared output device buffer in seconds, its size in frames
+  /// is stored to |buffer_frames| if it is not null.
+  double ogg_opus_player_get_output_latency(
+    ffi.Pointer<ffi.Int32> buffer_frames,
+  ) {
+    return _ogg_opus_player_get_output_latency(
+      buffer_frames,
+    );
+  }
+
+  late final _ogg_opus_player_get_output_latencyPtr =
+      _lookup<ffi.NativeFunction<ffi.Double Function(ffi.Pointer<ffi.Int32>)>>(
+          'ogg_opus_player_get_output_latency');
+  late final _ogg_opus_player_get_output_latency =
+      _ogg_opus_player_get_output_latencyPtr
+          .asFunction<double Function(ffi.Pointer<ffi.Int32>)>();
+
+  /// Called once per player on its decoder thread after its first audio callback.
+  /// Pass NULL to remove the hook.
+  void ogg_opus_player_set_startup_hook(
+    ogg_opus_player_startup_hook hook,
+  ) {
+    return _ogg_opus_player_set_startup_hook(
+      hook,
+    );
+  }
+
+  late final _ogg_opus_player_set_startup_hookPtr = _lookup<
+          ffi.NativeFunction<ffi.Void Function(ogg_opus_player_startup_hook)>>(
+      'ogg_opus_player_set_startup_hook');
+  late final _ogg_opus_player_set_startup_hook =
+      _ogg_opus_player_set_startup_hookPtr
+          .asFunction<void Function(ogg_opus_player_startup_hook)>();
+
+  /// Seconds from the start of the create call to the first audio callback that
+  /// rendered |player|, negative if there was none yet.
+  double ogg_opus_player_get_startup_latency(
+    ffi.Pointer<ffi.Void> player,
+  ) {
+    return _ogg_opus_player_get_startup_latency(
+      player,
+    );
+  }
+
+  late final _ogg_opus_player_get_startup_latencyPtr =
+      _lookup<ffi.NativeFunction<ffi.Double Function(ffi.Pointer<ffi.Void>)>>(
+          'ogg_opus_player_get_startup_latency');
+  late final _ogg_opus_player_get_startup_latency =
+      _ogg_opus_player_get_startup_latencyPtr
+          .asFunction<double Function(ffi.Pointer<ffi.Void>)>();
+
+  /// Count of heap allocations made on the audio callbacks since the library was
+  /// loaded, -1 if the library was built without OGG_OPUS_PLAYER_TRACK_ALLOCATIONS.
+  /// Should stay constant during steady state playback.
+  int ogg_opus_player_get_realtime_allocation_count() {
+    return _ogg_opus_player_get_realtime_allocation_count();
+  }
+
+  late final _ogg_opus_player_get_realtime_allocation_countPtr =
+      _lookup<ffi.NativeFunction<ffi.Int64 Function()>>(
+          'ogg_opus_player_get_realtime_allocation_count');
+  late final _ogg_opus_player_get_realtime_allocation_count =
+      _ogg_opus_player_get_realtime_allocation_countPtr
+          .asFunction<int Function()>();
+
   ffi.Pointer<ffi.Void> ogg_opus_recorder_create(
     ffi.Pointer<ffi.Char> file_path,
     int send_port,
@@ -215,6 +717,59 @@ class OggOpusBindings {
           void Function(ffi.Pointer<ffi.Void>,
               ffi.Pointer<ffi.Pointer<ffi.Uint8>>, ffi.Pointer<ffi.Int64>)>();
 
+  /// Peak and rms level, in [0, 1], of |bar_count| equal parts of the last
+  /// |seconds| of the recording, or of all of it if |seconds| is 0. May be
+  /// called while recording. |peaks| and |rms| hold |bar_count| values, either
+  /// may be null. return |bar_count|, or 0 if nothing was recorded yet.
+  int ogg_opus_recorder_get_waveform(
+    ffi.Pointer<ffi.Void> recoder,
+    int bar_count,
+    double seconds,
+    ffi.Pointer<ffi.Float> peaks,
+    ffi.Pointer<ffi.Float> rms,
+  ) {
+    return _ogg_opus_recorder_get_waveform(
+      recoder,
+      bar_count,
+      seconds,
+      peaks,
+      rms,
+    );
+  }
+
+  late final _ogg_opus_recorder_get_waveformPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+              ffi.Pointer<ffi.Void>,
+              ffi.Int32,
+              ffi.Double,
+              ffi.Pointer<ffi.Float>,
+              ffi.Pointer<ffi.Float>)>>('ogg_opus_recorder_get_waveform');
+  late final _ogg_opus_recorder_get_waveform =
+      _ogg_opus_recorder_get_waveformPtr.asFunction<
+          int Function(ffi.Pointer<ffi.Void>, int, double,
+              ffi.Pointer<ffi.Float>, ffi.Pointer<ffi.Float>)>();
+
+  /// Peak level, in [0, 1], of the input recorded since the previous call,
+  /// its rms level is stored to |rms| if it is not null. For live meters.
+  double ogg_opus_recorder_get_level(
+    ffi.Pointer<ffi.Void> recoder,
+    ffi.Pointer<ffi.Double> rms,
+  ) {
+    return _ogg_opus_recorder_get_level(
+      recoder,
+      rms,
+    );
+  }
+
+  late final _ogg_opus_recorder_get_levelPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Double Function(ffi.Pointer<ffi.Void>,
+              ffi.Pointer<ffi.Double>)>>('ogg_opus_recorder_get_level');
+  late final _ogg_opus_recorder_get_level =
+      _ogg_opus_recorder_get_levelPtr.asFunction<
+          double Function(ffi.Pointer<ffi.Void>, ffi.Pointer<ffi.Double>)>();
+
   double ogg_opus_recorder_get_duration(
     ffi.Pointer<ffi.Void> recoder,
   ) {
@@ -229,4 +784,265 @@ class OggOpusBindings {
   late final _ogg_opus_recorder_get_duration =
       _ogg_opus_recorder_get_durationPtr
           .asFunction<double Function(ffi.Pointer<ffi.Void>)>();
+
+  /// Low latency mode of the recorders created afterwards: open the capture
+  /// device with a buffer of |min_frames| frames and double the buffer, up to
+  /// |max_frames|, whenever a callback came late and input was dropped. 0 for
+  /// both restores the fixed 1024 frames.
+  void ogg_opus_recorder_set_latency_mode(
+    int min_frames,
+    int max_frames,
+  ) {
+    return _ogg_opus_recorder_set_latency_mode(
+      min_frames,
+      max_frames,
+    );
+  }
+
+  late final _ogg_opus_recorder_set_latency_modePtr =
+      _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Int32, ffi.Int32)>>(
+          'ogg_opus_recorder_set_latency_mode');
+  late final _ogg_opus_recorder_set_latency_mode =
+      _ogg_opus_recorder_set_latency_modePtr
+          .asFunction<void Function(int, int)>();
+
+  /// Latency of the capture device buffer in seconds, its size in frames is
+  /// stored to |buffer_frames| if it is not null.
+  double ogg_opus_recorder_get_input_latency(
+    ffi.Pointer<ffi.Void> recoder,
+    ffi.Pointer<ffi.Int32> buffer_frames,
+  ) {
+    return _ogg_opus_recorder_get_input_latency(
+      recoder,
+      buffer_frames,
+    );
+  }
+
+  late final _ogg_opus_recorder_get_input_latencyPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Double Function(ffi.Pointer<ffi.Void>,
+              ffi.Pointer<ffi.Int32>)>>('ogg_opus_recorder_get_input_latency');
+  late final _ogg_opus_recorder_get_input_latency =
+      _ogg_opus_recorder_get_input_latencyPtr
+          .asFunction<
+              double Function(ffi.Pointer<ffi.Void>, ffi.Pointer<ffi.Int32>)>();
+
+  /// Frames of input dropped because the encoder fell behind the capture device
+  /// by more than 2 seconds, the number of times it happened is stored to
+  /// |overflows| if it is not null.
+  int ogg_opus_recorder_get_dropped_frames(
+    ffi.Pointer<ffi.Void> recoder,
+    ffi.Pointer<ffi.Int64> overflows,
+  ) {
+    return _ogg_opus_recorder_get_dropped_frames(
+      recoder,
+      overflows,
+    );
+  }
+
+  late final _ogg_opus_recorder_get_dropped_framesPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int64 Function(ffi.Pointer<ffi.Void>,
+              ffi.Pointer<ffi.Int64>)>>('ogg_opus_recorder_get_dropped_frames');
+  late final _ogg_opus_recorder_get_dropped_frames =
+      _ogg_opus_recorder_get_dropped_framesPtr
+          .asFunction<
+              int Function(ffi.Pointer<ffi.Void>, ffi.Pointer<ffi.Int64>)>();
+
+  /// Post progress events to the recorder's send port every |milliseconds|
+  /// while it records, and once more after it stopped. 0, the default, stops
+  /// them. Events are posted from a helper thread, never from the capture
+  /// callback. Each event is a list [0, duration, peak, rms, dropped_frames,
+  /// bitrate]:
+  /// |duration| of the audio encoded so far in seconds,
+  /// |peak| and |rms| the input levels since the last event in [0, 1],
+  /// |dropped_frames| as ogg_opus_recorder_get_dropped_frames,
+  /// |bitrate| the average bitrate of the opus packets so far in bits per second.
+  void ogg_opus_recorder_set_event_interval(
+    ffi.Pointer<ffi.Void> recoder,
+    int milliseconds,
+  ) {
+    return _ogg_opus_recorder_set_event_interval(
+      recoder,
+      milliseconds,
+    );
+  }
+
+  late final _ogg_opus_recorder_set_event_intervalPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Void>,
+              ffi.Int32)>>('ogg_opus_recorder_set_event_interval');
+  late final _ogg_opus_recorder_set_event_interval =
+      _ogg_opus_recorder_set_event_intervalPtr
+          .asFunction<void Function(ffi.Pointer<ffi.Void>, int)>();
+
+  /// Post every ogg page of the file to the recorder's send port as soon as the
+  /// encoder completed it, so the file can be uploaded while it is recorded.
+  /// Each page is a list [1, page] with |page| a Uint8List backed by native
+  /// memory, freed once the list is garbage collected. After the last page,
+  /// when the recorder stops, [2] is posted. Enable it before starting the
+  /// recorder, the pages written before are not posted.
+  void ogg_opus_recorder_set_page_streaming(
+    ffi.Pointer<ffi.Void> recoder,
+    int enabled,
+  ) {
+    return _ogg_opus_recorder_set_page_streaming(
+      recoder,
+      enabled,
+    );
+  }
+
+  late final _ogg_opus_recorder_set_page_streamingPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Void>,
+              ffi.Int32)>>('ogg_opus_recorder_set_page_streaming');
+  late final _ogg_opus_recorder_set_page_streaming =
+      _ogg_opus_recorder_set_page_streamingPtr
+          .asFunction<void Function(ffi.Pointer<ffi.Void>, int)>();
+
+  /// Set the page callback before starting the recorder, for native upload
+  /// queues. Pass NULL to remove it.
+  void ogg_opus_recorder_set_page_callback(
+    ffi.Pointer<ffi.Void> recoder,
+    ogg_opus_recorder_page_callback callback,
+    ffi.Pointer<ffi.Void> user_data,
+  ) {
+    return _ogg_opus_recorder_set_page_callback(
+      recoder,
+      callback,
+      user_data,
+    );
+  }
+
+  late final _ogg_opus_recorder_set_page_callbackPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Void>,
+              ogg_opus_recorder_page_callback,
+              ffi.Pointer<ffi.Void>)>>('ogg_opus_recorder_set_page_callback');
+  late final _ogg_opus_recorder_set_page_callback =
+      _ogg_opus_recorder_set_page_callbackPtr
+          .asFunction<
+              void Function(ffi.Pointer<ffi.Void>,
+                  ogg_opus_recorder_page_callback, ffi.Pointer<ffi.Void>)>();
+}
+
+/// Byte source for ogg_opus_player_create_from_callbacks. The functions are
+/// called from the player's decoder thread, never from the audio callback.
+class OggOpusPlayerCallbacks extends ffi.Struct {
+  /// Read at most |size| bytes into |buffer|, return the count of bytes read,
+  /// 0 at the end of the stream or negative on error.
+  external ffi.Pointer<
+          ffi.NativeFunction<
+              ffi.Int Function(
+                  ffi.Pointer<ffi.Void> user_data,
+                  ffi.Pointer<ffi.Uint8> buffer,
+                  ffi.Int size)>> read;
+
+  /// fseek() semantics, return 0 on success or -1. May be NULL together with
+  /// |tell| if the source can not seek, the player can not seek either then.
+  external ffi.Pointer<
+          ffi.NativeFunction<
+              ffi.Int Function(ffi.Pointer<ffi.Void> user_data,
+                  ffi.Int64 offset, ffi.Int whence)>> seek;
+
+  external ffi.Pointer<
+          ffi.NativeFunction<ffi.Int64 Function(ffi.Pointer<ffi.Void> user_data)>>
+      tell;
+
+  /// Called once the player no longer uses the source. May be NULL.
+  external ffi.Pointer<
+          ffi.NativeFunction<ffi.Void Function(ffi.Pointer<ffi.Void> user_data)>>
+      close;
 }
+
+/// Audio callback instrumentation of a player since it was created, durations
+/// in microseconds. Histogram bucket 0 counts values below 1us, bucket i the
+/// values in [2^(i-1), 2^i) us, the last bucket everything above.
+class OggOpusPlayerStats extends ffi.Struct {
+  /// audio callbacks that rendered the player, and the ones that produced
+  /// fewer frames than requested because the decoder fell behind.
+  @ffi.Int64()
+  external int callbacks;
+
+  @ffi.Int64()
+  external int underruns;
+
+  /// time spent rendering the player, and between two renders.
+  @ffi.Double()
+  external double callback_duration_mean_us;
+
+  @ffi.Double()
+  external double callback_duration_max_us;
+
+  @ffi.Double()
+  external double callback_period_mean_us;
+
+  @ffi.Double()
+  external double callback_period_max_us;
+
+  /// smallest time left in the device buffer once the player was rendered,
+  /// measured from the start of the mixer callback. negative means missed.
+  @ffi.Double()
+  external double deadline_margin_min_us;
+
+  /// decoded audio ahead of the callback after the last render, its minimum
+  /// and the capacity of the decode-ahead buffer, in milliseconds.
+  @ffi.Double()
+  external double buffer_fill_ms;
+
+  @ffi.Double()
+  external double buffer_fill_min_ms;
+
+  @ffi.Double()
+  external double buffer_capacity_ms;
+
+  @ffi.Array.multi([16])
+  external ffi.Array<ffi.Int64> callback_duration_histogram;
+
+  @ffi.Array.multi([16])
+  external ffi.Array<ffi.Int64> callback_period_histogram;
+
+  @ffi.Array.multi([16])
+  external ffi.Array<ffi.Int64> deadline_margin_histogram;
+
+  /// the process wide decoded pcm cache, see ogg_opus_player_set_pcm_cache_size.
+  /// lookups of files that hit and missed, entries evicted to stay within the
+  /// budget, the bytes held and the budget.
+  @ffi.Int64()
+  external int pcm_cache_hits;
+
+  @ffi.Int64()
+  external int pcm_cache_misses;
+
+  @ffi.Int64()
+  external int pcm_cache_evictions;
+
+  @ffi.Int64()
+  external int pcm_cache_bytes;
+
+  @ffi.Int64()
+  external int pcm_cache_capacity_bytes;
+}
+
+/// Startup latency of a player in microseconds: |create_us| spent in the create
+/// call, |first_callback_us| from the start of the create call to the first
+/// audio callback that rendered the player.
+typedef ogg_opus_player_startup_hook = ffi.Pointer<
+    ffi.NativeFunction<
+        ffi.Void Function(ffi.Pointer<ffi.Void> player, ffi.Int64 create_us,
+            ffi.Int64 first_callback_us)>>;
+
+/// Called with every ogg page of the file as soon as the encoder completed it,
+/// on the recorder's encoder thread, or on the thread that stops the recorder
+/// for the last pages. |page| is only valid during the call. Called once more
+/// with a null |page| after the last page.
+typedef ogg_opus_recorder_page_callback = ffi.Pointer<
+    ffi.NativeFunction<
+        ffi.Void Function(ffi.Pointer<ffi.Void> user_data,
+            ffi.Pointer<ffi.Uint8> page, ffi.Int32 length)>>;
+
+const int OGG_OPUS_PLAYER_STATS_BUCKETS = 16;
+
+const int OGG_OPUS_CIPHER_AES_CTR = 0;
+
+const int OGG_OPUS_CIPHER_AES_CBC = 1;
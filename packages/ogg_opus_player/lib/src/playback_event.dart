@@ -0,0 +1,44 @@
+import 'player_state.dart';
+
+/// Playback state pushed by the native player, see
+/// [OggOpusPlayer.playbackEvents].
+class PlaybackEvent {
+  const PlaybackEvent({
+    required this.position,
+    required this.bufferedPosition,
+    required this.peakLevel,
+    required this.underruns,
+    required this.state,
+    required this.deviceBufferFrames,
+    required this.outputLatency,
+  });
+
+  /// Playing position, in seconds.
+  final double position;
+
+  /// End of the audio decoded ahead of the playing position, in seconds.
+  final double bufferedPosition;
+
+  /// Largest absolute sample level since the previous event, in [0, 1].
+  final double peakLevel;
+
+  /// Count of audio callbacks that ran out of decoded audio so far.
+  final int underruns;
+
+  final PlayerState state;
+
+  /// Size of the shared output device buffer in frames, see
+  /// [OggOpusPlayer.useLowLatency], and its latency in seconds.
+  final int deviceBufferFrames;
+
+  final double outputLatency;
+
+  @override
+  String toString() {
+    return 'PlaybackEvent(position: $position, '
+        'bufferedPosition: $bufferedPosition, peakLevel: $peakLevel, '
+        'underruns: $underruns, state: $state, '
+        'deviceBufferFrames: $deviceBufferFrames, '
+        'outputLatency: $outputLatency)';
+  }
+}
@@ -1,10 +1,16 @@
+import 'dart:ffi';
 import 'dart:io';
 
 import 'package:flutter/foundation.dart';
 
+import 'cipher_mode.dart';
+import 'playback_event.dart';
 import 'player_ffi_impl.dart';
 import 'player_plugin_impl.dart';
 import 'player_state.dart';
+import 'player_stats.dart';
+import 'recording_event.dart';
+import 'waveform_bar.dart';
 
 abstract class OggOpusPlayer {
   OggOpusPlayer.create();
@@ -18,6 +24,143 @@ abstract class OggOpusPlayer {
     throw UnsupportedError('Platform not supported');
   }
 
+  /// Play an ogg opus stream from [length] bytes of native memory at [buffer],
+  /// e.g. allocated with `malloc` from `package:ffi`. The buffer is not copied,
+  /// it must stay valid until [onBufferReleased] is called: once a track
+  /// queued with [enqueue] started playing after it, at the latest during
+  /// [dispose].
+  /// Only supported on Linux and Windows.
+  factory OggOpusPlayer.fromNativeBuffer(
+    Pointer<Uint8> buffer,
+    int length, {
+    VoidCallback? onBufferReleased,
+  }) {
+    if (Platform.isLinux || Platform.isWindows) {
+      return OggOpusPlayerFfiImpl.fromNativeBuffer(
+        buffer,
+        length,
+        onBufferReleased: onBufferReleased,
+      );
+    }
+    throw UnsupportedError('Platform not supported');
+  }
+
+  /// Play an ogg opus stream that is still being downloaded, push its bytes
+  /// with [appendData] and call [endOfData] once the download completed.
+  /// Playback starts as soon as the first pages arrived, [state] is
+  /// [PlayerState.buffering] while the player waits for more bytes.
+  /// Only supported on Linux and Windows.
+  factory OggOpusPlayer.streaming() {
+    if (Platform.isLinux || Platform.isWindows) {
+      return OggOpusPlayerFfiImpl.streaming();
+    }
+    throw UnsupportedError('Platform not supported');
+  }
+
+  /// Play the file at [path] while another writer is still appending to it,
+  /// call [endOfData] once the file is complete. See [OggOpusPlayer.streaming].
+  /// Only supported on Linux and Windows.
+  factory OggOpusPlayer.growingFile(String path) {
+    if (Platform.isLinux || Platform.isWindows) {
+      return OggOpusPlayerFfiImpl.growingFile(path);
+    }
+    throw UnsupportedError('Platform not supported');
+  }
+
+  /// Play the AES encrypted file at [path], decrypting it in memory while it
+  /// is played. [key] is 16, 24 or 32 bytes and [iv] 16 bytes, see
+  /// [CipherMode]. The player is in [PlayerState.error] if the key, the iv
+  /// or the file is invalid.
+  /// Only supported on Linux and Windows.
+  factory OggOpusPlayer.encryptedFile(
+    String path, {
+    required Uint8List key,
+    required Uint8List iv,
+    CipherMode mode = CipherMode.aesCtr,
+  }) {
+    if (Platform.isLinux || Platform.isWindows) {
+      return OggOpusPlayerFfiImpl.encryptedFile(
+        path,
+        key: key,
+        iv: iv,
+        mode: mode,
+      );
+    }
+    throw UnsupportedError('Platform not supported');
+  }
+
+  /// Prepare [count] players for streams with [channels] channels ahead of
+  /// time, e.g. at app start, so creating them later is cheaper.
+  /// Does nothing on platforms other than Linux and Windows.
+  static void warmUp({int count = 1, int channels = 1}) {
+    if (Platform.isLinux || Platform.isWindows) {
+      OggOpusPlayerFfiImpl.warmUp(count, channels);
+    }
+  }
+
+  /// Decode and mix in float and let the output device run with float
+  /// samples if it supports them. Must be called before the first player is
+  /// created or warmed up, returns false otherwise.
+  /// Does nothing on platforms other than Linux and Windows.
+  static bool useFloatPipeline(bool enabled) {
+    if (Platform.isLinux || Platform.isWindows) {
+      return OggOpusPlayerFfiImpl.useFloatPipeline(enabled);
+    }
+    return false;
+  }
+
+  /// Open the output device with a buffer of [minFrames] frames, for quick
+  /// response of short sounds, and double the buffer up to [maxFrames]
+  /// whenever the device glitched. The size in use is reported by
+  /// [PlaybackEvent.deviceBufferFrames]. Must be called before the first
+  /// player is created or warmed up, returns false otherwise.
+  /// Does nothing on platforms other than Linux and Windows.
+  static bool useLowLatency({int minFrames = 256, int maxFrames = 2048}) {
+    if (Platform.isLinux || Platform.isWindows) {
+      return OggOpusPlayerFfiImpl.useLowLatency(minFrames, maxFrames);
+    }
+    return false;
+  }
+
+  /// Byte budget of the cache of decoded audio shared by all players,
+  /// 32 MiB by default, 0 disables it. A file is cached once a player
+  /// decoded it from start to end, replaying it and seeking in it then skip
+  /// decoding until the file changes. Least recently played files are
+  /// evicted first, see [PlayerStats.pcmCacheEvictions].
+  /// Does nothing on platforms other than Linux and Windows.
+  static void setPcmCacheSize(int bytes) {
+    if (Platform.isLinux || Platform.isWindows) {
+      OggOpusPlayerFfiImpl.setPcmCacheSize(bytes);
+    }
+  }
+
+  /// Map played files into memory instead of reading them with stdio,
+  /// players of the same file then share its pages in the page cache.
+  /// Off by default: if a mapped file is truncated or rewritten while it is
+  /// played, e.g. by recording over it, the app crashes. Only enable it if
+  /// the played files never change. Applies to players created afterwards.
+  /// Does nothing on platforms other than Linux and Windows.
+  static void useMemoryMappedFiles(bool enabled) {
+    if (Platform.isLinux || Platform.isWindows) {
+      OggOpusPlayerFfiImpl.useMemoryMappedFiles(enabled);
+    }
+  }
+
+  /// Scan the file at [path] once and record where each of its pages
+  /// starts, players of the file then seek with a single jump instead of
+  /// bisecting the file. If [indexPath] is given, the index is loaded from
+  /// it if it still matches the file and written back, so it survives
+  /// restarts. A file that grew since it was indexed is only scanned from
+  /// where the index ended. Returns the count of seek points, or -1 if the
+  /// file can not be indexed, e.g. a chained file.
+  /// Does nothing on platforms other than Linux and Windows.
+  static int buildSeekIndex(String path, {String? indexPath}) {
+    if (Platform.isLinux || Platform.isWindows) {
+      return OggOpusPlayerFfiImpl.buildSeekIndex(path, indexPath);
+    }
+    return -1;
+  }
+
   void pause();
 
   void play();
@@ -29,9 +172,52 @@ abstract class OggOpusPlayer {
   /// Current playing position, in seconds.
   double get currentPosition;
 
-  /// Set playback rate, in the range 0.5 through 2.0.
-  /// 1.0 is normal speed (default).
+  /// Set playback rate, in the range 0.5 through 3.0, other rates are
+  /// clamped on Linux and Windows. 1.0 is normal speed (default).
   void setPlaybackRate(double speed);
+
+  /// Seek to [position], in seconds.
+  /// Only supported on Linux and Windows.
+  void seek(double position);
+
+  /// Set the volume of this player, 1.0 is unchanged (default).
+  /// Only supported on Linux and Windows.
+  void setVolume(double volume);
+
+  /// Queue the file at [path] to play right after the current track and
+  /// everything queued before it, without a gap. A [seek] applies to the
+  /// track that is playing.
+  /// Return false if the file could not be opened.
+  /// Only supported on Linux and Windows.
+  bool enqueue(String path);
+
+  /// Index of the track that is playing, 0 is the one the player was created
+  /// with, the tracks added by [enqueue] follow in order.
+  /// Only supported on Linux and Windows.
+  ValueListenable<int> get currentTrack;
+
+  /// Playback events pushed by the native player every [setEventInterval]
+  /// while playing, and after each state change. Events are only produced
+  /// while the stream has listeners.
+  /// Only supported on Linux and Windows.
+  Stream<PlaybackEvent> get playbackEvents;
+
+  /// Cadence of [playbackEvents], 50 milliseconds by default.
+  /// Only supported on Linux and Windows.
+  void setEventInterval(Duration interval);
+
+  /// Audio callback timings, underruns and decode-ahead fill of this player,
+  /// read without blocking the audio thread. Null once disposed.
+  /// Only supported on Linux and Windows.
+  PlayerStats? get stats;
+
+  /// Append downloaded [bytes] to a player created by
+  /// [OggOpusPlayer.streaming].
+  void appendData(Uint8List bytes);
+
+  /// No more bytes will arrive for a player created by
+  /// [OggOpusPlayer.streaming] or [OggOpusPlayer.growingFile].
+  void endOfData();
 }
 
 abstract class OggOpusRecorder {
@@ -59,4 +245,56 @@ abstract class OggOpusRecorder {
   /// get the recorded audio duration.
   /// must be called after [stop] is called.
   Future<double> duration();
+
+  /// Peak and rms level of [bars] equal parts of the last [seconds] of the
+  /// recording, or of all of it if [seconds] is 0. May be called while
+  /// recording, empty if nothing was recorded yet.
+  /// Only supported on Linux and Windows.
+  List<WaveformBar> waveform(int bars, {double seconds = 0});
+
+  /// Peak and rms level of the input recorded since the previous call, for
+  /// live meters.
+  /// Only supported on Linux and Windows.
+  WaveformBar level();
+
+  /// Open the input device of recorders created afterwards with a buffer of
+  /// [minFrames] frames and double the buffer up to [maxFrames] whenever
+  /// input was dropped.
+  /// Does nothing on platforms other than Linux and Windows.
+  static void useLowLatency({int minFrames = 256, int maxFrames = 2048}) {
+    if (Platform.isLinux || Platform.isWindows) {
+      OggOpusRecorderFfiImpl.useLowLatency(minFrames, maxFrames);
+    }
+  }
+
+  /// Size of the input device buffer in frames, and its latency in seconds.
+  /// Only supported on Linux and Windows.
+  int get deviceBufferFrames;
+
+  double get inputLatency;
+
+  /// Frames of input dropped because encoding fell behind the input device,
+  /// and the number of times it happened.
+  /// Only supported on Linux and Windows.
+  int get droppedFrames;
+
+  int get overflowCount;
+
+  /// Progress events pushed by the native recorder every [setEventInterval]
+  /// while recording, and once more after [stop]. Events are only produced
+  /// while the stream has listeners.
+  /// Only supported on Linux and Windows.
+  Stream<RecordingEvent> get recordingEvents;
+
+  /// Cadence of [recordingEvents], 50 milliseconds by default.
+  /// Only supported on Linux and Windows.
+  void setEventInterval(Duration interval);
+
+  /// The ogg pages of the file as the encoder completes them, about one per
+  /// second, so it can be uploaded while it is recorded. Concatenated they
+  /// are the file, the stream closes after [stop] wrote the last page.
+  /// Pages are backed by native memory and not copied on their way to dart.
+  /// Listen before [start], pages written before are not delivered.
+  /// Only supported on Linux and Windows.
+  Stream<Uint8List> get pages;
 }
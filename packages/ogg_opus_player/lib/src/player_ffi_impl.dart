@@ -7,8 +7,13 @@ import 'package:ffi/ffi.dart';
 import 'package:flutter/foundation.dart';
 import 'package:ogg_opus_player/src/player.dart';
 
+import 'cipher_mode.dart';
 import 'ogg_opus_bindings_generated.dart';
+import 'playback_event.dart';
 import 'player_state.dart';
+import 'player_stats.dart';
+import 'recording_event.dart';
+import 'waveform_bar.dart';
 
 class OggOpusPlayerFfiImpl extends OggOpusPlayer {
   final String _path;
@@ -32,23 +37,254 @@ class OggOpusPlayerFfiImpl extends OggOpusPlayer {
     return _bindings.ogg_opus_player_get_current_time(_playerHandle);
   }
 
-  OggOpusPlayerFfiImpl(this._path)
-      : _port = ReceivePort('OggOpusPlayer: #$_path'),
+  VoidCallback? _onSourceReleased;
+
+  late final _playbackEvents = StreamController<PlaybackEvent>.broadcast(
+    onListen: _updateEventInterval,
+    onCancel: _updateEventInterval,
+  );
+
+  Duration _eventInterval = const Duration(milliseconds: 50);
+
+  final _currentTrack = ValueNotifier(0);
+
+  @override
+  ValueListenable<int> get currentTrack => _currentTrack;
+
+  OggOpusPlayerFfiImpl(String path)
+      : this._(
+          path,
+          (sendPort) => _bindings.ogg_opus_player_create(
+              path.toNativeUtf8().cast(), sendPort),
+        );
+
+  OggOpusPlayerFfiImpl.fromNativeBuffer(
+    Pointer<Uint8> buffer,
+    int length, {
+    VoidCallback? onBufferReleased,
+  }) : this._(
+          'buffer@${buffer.address}',
+          (sendPort) => _bindings.ogg_opus_player_create_from_memory(
+              buffer, length, sendPort),
+          onSourceReleased: onBufferReleased,
+        );
+
+  OggOpusPlayerFfiImpl.streaming()
+      : this._(
+          'streaming',
+          (sendPort) => _bindings.ogg_opus_player_create_streaming(sendPort),
+        );
+
+  OggOpusPlayerFfiImpl.growingFile(String path)
+      : this._(
+          path,
+          (sendPort) => _bindings.ogg_opus_player_create_from_growing_file(
+              path.toNativeUtf8().cast(), sendPort),
+        );
+
+  OggOpusPlayerFfiImpl.encryptedFile(
+    String path, {
+    required Uint8List key,
+    required Uint8List iv,
+    required CipherMode mode,
+  }) : this._(
+          path,
+          (sendPort) => _createEncrypted(path, key, iv, mode, sendPort),
+        );
+
+  static Pointer<Void> _createEncrypted(
+    String path,
+    Uint8List key,
+    Uint8List iv,
+    CipherMode mode,
+    int sendPort,
+  ) {
+    if (iv.length != 16) {
+      return nullptr;
+    }
+    final nativePath = path.toNativeUtf8();
+    final nativeKey = malloc<Uint8>(key.length);
+    final nativeIv = malloc<Uint8>(iv.length);
+    nativeKey.asTypedList(key.length).setAll(0, key);
+    nativeIv.asTypedList(iv.length).setAll(0, iv);
+    final handle = _bindings.ogg_opus_player_create_encrypted(
+      nativePath.cast(),
+      mode == CipherMode.aesCbc
+          ? OGG_OPUS_CIPHER_AES_CBC
+          : OGG_OPUS_CIPHER_AES_CTR,
+      nativeKey,
+      key.length,
+      nativeIv,
+      sendPort,
+    );
+    // the native side keeps its own copy, do not leave the key in the heap.
+    nativeKey.asTypedList(key.length).fillRange(0, key.length, 0);
+    nativeIv.asTypedList(iv.length).fillRange(0, iv.length, 0);
+    malloc.free(nativeKey);
+    malloc.free(nativeIv);
+    malloc.free(nativePath);
+    return handle;
+  }
+
+  OggOpusPlayerFfiImpl._(
+    this._path,
+    Pointer<Void> Function(int sendPort) create, {
+    VoidCallback? onSourceReleased,
+  })  : _port = ReceivePort('OggOpusPlayer: #$_path'),
+        _onSourceReleased = onSourceReleased,
         super.create() {
     _initializeDartApi();
-    _playerHandle = _bindings.ogg_opus_player_create(
-        _path.toNativeUtf8().cast(), _port.sendPort.nativePort);
+    _playerHandle = create(_port.sendPort.nativePort);
+    if (_playerHandle == nullptr) {
+      _state.value = PlayerState.error;
+    }
     _portSubscription = _port.listen((message) {
-      if (message is int) {
+      if (message is List) {
+        // 0: playback event
+        if (message.isNotEmpty && message[0] == 0) {
+          _playbackEvents.add(_parsePlaybackEvent(message));
+        } else if (message.isNotEmpty && message[0] == 1) {
+          // 1: track changed
+          _currentTrack.value = message[1] as int;
+        } else if (message.isNotEmpty && message[0] == 2) {
+          // 2: source released, 0 is the one the player was created with
+          if (message[1] == 0) {
+            _notifySourceReleased();
+          }
+        }
+      } else if (message is int) {
         // 0: play finished
         if (message == 0) {
           _bindings.ogg_opus_player_pause(_playerHandle);
           _state.value = PlayerState.ended;
+        } else if (message == 2) {
+          // 2: waiting for more bytes
+          if (_state.value == PlayerState.playing) {
+            _state.value = PlayerState.buffering;
+          }
+        } else if (message == 3) {
+          // 3: playback continued
+          if (_state.value == PlayerState.buffering) {
+            _state.value = PlayerState.playing;
+          }
         }
       }
     });
   }
 
+  static PlaybackEvent _parsePlaybackEvent(List message) {
+    const states = [
+      PlayerState.paused,
+      PlayerState.playing,
+      PlayerState.buffering,
+      PlayerState.ended,
+    ];
+    return PlaybackEvent(
+      position: message[1] as double,
+      bufferedPosition: message[2] as double,
+      peakLevel: message[3] as double,
+      underruns: message[4] as int,
+      state: states[message[5] as int],
+      deviceBufferFrames: message[6] as int,
+      outputLatency: message[7] as double,
+    );
+  }
+
+  void _updateEventInterval() {
+    if (_playerHandle == nullptr) {
+      return;
+    }
+    final milliseconds =
+        _playbackEvents.hasListener ? _eventInterval.inMilliseconds : 0;
+    _bindings.ogg_opus_player_set_event_interval(_playerHandle, milliseconds);
+  }
+
+  @override
+  Stream<PlaybackEvent> get playbackEvents => _playbackEvents.stream;
+
+  @override
+  void setEventInterval(Duration interval) {
+    assert(interval > Duration.zero);
+    _eventInterval = interval;
+    _updateEventInterval();
+  }
+
+  @override
+  PlayerStats? get stats {
+    if (_playerHandle == nullptr) {
+      return null;
+    }
+    final native = calloc<OggOpusPlayerStats>();
+    _bindings.ogg_opus_player_get_stats(_playerHandle, native);
+    final stats = _toPlayerStats(native.ref);
+    calloc.free(native);
+    return stats;
+  }
+
+  static PlayerStats _toPlayerStats(OggOpusPlayerStats stats) {
+    List<int> histogram(Array<Int64> buckets) =>
+        List.generate(OGG_OPUS_PLAYER_STATS_BUCKETS, (i) => buckets[i]);
+    return PlayerStats(
+      callbacks: stats.callbacks,
+      underruns: stats.underruns,
+      callbackDurationMean: stats.callback_duration_mean_us,
+      callbackDurationMax: stats.callback_duration_max_us,
+      callbackPeriodMean: stats.callback_period_mean_us,
+      callbackPeriodMax: stats.callback_period_max_us,
+      deadlineMarginMin: stats.deadline_margin_min_us,
+      bufferFill: stats.buffer_fill_ms,
+      bufferFillMin: stats.buffer_fill_min_ms,
+      bufferCapacity: stats.buffer_capacity_ms,
+      callbackDurationHistogram: histogram(stats.callback_duration_histogram),
+      callbackPeriodHistogram: histogram(stats.callback_period_histogram),
+      deadlineMarginHistogram: histogram(stats.deadline_margin_histogram),
+      pcmCacheHits: stats.pcm_cache_hits,
+      pcmCacheMisses: stats.pcm_cache_misses,
+      pcmCacheEvictions: stats.pcm_cache_evictions,
+      pcmCacheBytes: stats.pcm_cache_bytes,
+      pcmCacheCapacity: stats.pcm_cache_capacity_bytes,
+    );
+  }
+
+  static void warmUp(int count, int channels) {
+    _bindings.ogg_opus_player_warm_up(count, channels);
+  }
+
+  static bool useFloatPipeline(bool enabled) {
+    return _bindings.ogg_opus_player_set_float_pipeline(enabled ? 1 : 0) == 0;
+  }
+
+  static void setPcmCacheSize(int bytes) {
+    _bindings.ogg_opus_player_set_pcm_cache_size(bytes);
+  }
+
+  static void useMemoryMappedFiles(bool enabled) {
+    _bindings.ogg_opus_player_set_memory_mapping(enabled ? 1 : 0);
+  }
+
+  static int buildSeekIndex(String path, String? indexPath) {
+    final nativePath = path.toNativeUtf8();
+    final nativeIndexPath = indexPath?.toNativeUtf8() ?? nullptr;
+    final result = _bindings.ogg_opus_player_build_seek_index(
+        nativePath.cast(), nativeIndexPath.cast());
+    malloc.free(nativePath);
+    if (nativeIndexPath != nullptr) {
+      malloc.free(nativeIndexPath);
+    }
+    return result;
+  }
+
+  static bool useLowLatency(int minFrames, int maxFrames) {
+    return _bindings.ogg_opus_player_set_latency_mode(minFrames, maxFrames) ==
+        0;
+  }
+
+  void _notifySourceReleased() {
+    final callback = _onSourceReleased;
+    _onSourceReleased = null;
+    callback?.call();
+  }
+
   @override
   void play() {
     if (_playerHandle != nullptr) {
@@ -73,6 +309,55 @@ class OggOpusPlayerFfiImpl extends OggOpusPlayer {
     }
   }
 
+  @override
+  void seek(double position) {
+    if (_playerHandle != nullptr) {
+      assert(position >= 0);
+      _bindings.ogg_opus_player_seek(_playerHandle, position);
+      if (_state.value == PlayerState.ended) {
+        _state.value = PlayerState.paused;
+      }
+    }
+  }
+
+  @override
+  void setVolume(double volume) {
+    if (_playerHandle != nullptr) {
+      assert(volume >= 0);
+      _bindings.ogg_opus_player_set_volume(_playerHandle, volume);
+    }
+  }
+
+  @override
+  bool enqueue(String path) {
+    if (_playerHandle == nullptr) {
+      return false;
+    }
+    final nativePath = path.toNativeUtf8();
+    final result =
+        _bindings.ogg_opus_player_enqueue_file(_playerHandle, nativePath.cast());
+    malloc.free(nativePath);
+    return result == 0;
+  }
+
+  @override
+  void appendData(Uint8List bytes) {
+    if (_playerHandle == nullptr || bytes.isEmpty) {
+      return;
+    }
+    final data = malloc<Uint8>(bytes.length);
+    data.asTypedList(bytes.length).setAll(0, bytes);
+    _bindings.ogg_opus_player_append_data(_playerHandle, data, bytes.length);
+    malloc.free(data);
+  }
+
+  @override
+  void endOfData() {
+    if (_playerHandle != nullptr) {
+      _bindings.ogg_opus_player_end_of_data(_playerHandle);
+    }
+  }
+
   @override
   void dispose() {
     _portSubscription?.cancel();
@@ -80,6 +365,9 @@ class OggOpusPlayerFfiImpl extends OggOpusPlayer {
       _bindings.ogg_opus_player_dispose(_playerHandle);
       _playerHandle = nullptr;
     }
+    // the native player released its source before dispose returned.
+    _notifySourceReleased();
+    _playbackEvents.close();
     _state.value = PlayerState.idle;
   }
 }
@@ -119,12 +407,78 @@ class OggOpusRecorderFfiImpl extends OggOpusRecorder {
   Pointer<Void> _recorderHandle = nullptr;
   final ReceivePort _port;
 
+  StreamSubscription? _portSubscription;
+
+  late final _recordingEvents = StreamController<RecordingEvent>.broadcast(
+    onListen: _updateEventInterval,
+    onCancel: _updateEventInterval,
+  );
+
+  Duration _eventInterval = const Duration(milliseconds: 50);
+
+  late final _pages = StreamController<Uint8List>(
+    onListen: () => _setPageStreaming(true),
+    onCancel: () => _setPageStreaming(false),
+  );
+
   OggOpusRecorderFfiImpl(this._path)
       : _port = ReceivePort('OggOpusRecorderFfiImpl: $_path'),
         super.create() {
     _initializeDartApi();
     _recorderHandle = _bindings.ogg_opus_recorder_create(
         _path.toNativeUtf8().cast(), _port.sendPort.nativePort);
+    _portSubscription = _port.listen((message) {
+      if (message is! List || message.isEmpty) {
+        return;
+      }
+      // 0: progress event
+      if (message[0] == 0) {
+        _recordingEvents.add(RecordingEvent(
+          duration: message[1] as double,
+          peakLevel: message[2] as double,
+          rmsLevel: message[3] as double,
+          droppedFrames: message[4] as int,
+          bitrate: message[5] as double,
+        ));
+      } else if (message[0] == 1) {
+        // 1: ogg page
+        _pages.add(message[1] as Uint8List);
+      } else if (message[0] == 2) {
+        // 2: last page written
+        _pages.close();
+      }
+    });
+  }
+
+  void _setPageStreaming(bool enabled) {
+    if (_recorderHandle == nullptr) {
+      return;
+    }
+    _bindings.ogg_opus_recorder_set_page_streaming(
+        _recorderHandle, enabled ? 1 : 0);
+  }
+
+  void _updateEventInterval() {
+    if (_recorderHandle == nullptr) {
+      return;
+    }
+    final milliseconds =
+        _recordingEvents.hasListener ? _eventInterval.inMilliseconds : 0;
+    _bindings.ogg_opus_recorder_set_event_interval(
+        _recorderHandle, milliseconds);
+  }
+
+  @override
+  Stream<RecordingEvent> get recordingEvents => _recordingEvents.stream;
+
+  @override
+  Stream<Uint8List> get pages => _pages.stream;
+
+  @override
+  void setEventInterval(Duration interval) {
+    assert(interval > Duration.zero);
+    _eventInterval = interval;
+    _updateEventInterval();
   }
 
   @override
@@ -144,10 +498,14 @@ class OggOpusRecorderFfiImpl extends OggOpusRecorder {
 
   @override
   void dispose() {
+    _portSubscription?.cancel();
     if (_recorderHandle != nullptr) {
       _bindings.ogg_opus_recorder_destroy(_recorderHandle);
       _recorderHandle = nullptr;
     }
+    _port.close();
+    _recordingEvents.close();
+    _pages.close();
   }
 
   @override
@@ -158,6 +516,80 @@ class OggOpusRecorderFfiImpl extends OggOpusRecorder {
     return _bindings.ogg_opus_recorder_get_duration(_recorderHandle);
   }
 
+  @override
+  List<WaveformBar> waveform(int bars, {double seconds = 0}) {
+    if (_recorderHandle == nullptr || bars <= 0) {
+      return const [];
+    }
+    final peaks = malloc<Float>(bars);
+    final rms = malloc<Float>(bars);
+    final count = _bindings.ogg_opus_recorder_get_waveform(
+        _recorderHandle, bars, seconds, peaks, rms);
+    final result = List.generate(
+        count, (i) => WaveformBar(peak: peaks[i], rms: rms[i]));
+    malloc.free(peaks);
+    malloc.free(rms);
+    return result;
+  }
+
+  @override
+  WaveformBar level() {
+    if (_recorderHandle == nullptr) {
+      return const WaveformBar(peak: 0, rms: 0);
+    }
+    final rms = malloc<Double>();
+    final peak = _bindings.ogg_opus_recorder_get_level(_recorderHandle, rms);
+    final result = WaveformBar(peak: peak, rms: rms.value);
+    malloc.free(rms);
+    return result;
+  }
+
+  static void useLowLatency(int minFrames, int maxFrames) {
+    _bindings.ogg_opus_recorder_set_latency_mode(minFrames, maxFrames);
+  }
+
+  @override
+  int get deviceBufferFrames {
+    if (_recorderHandle == nullptr) {
+      return 0;
+    }
+    final frames = malloc<Int32>();
+    _bindings.ogg_opus_recorder_get_input_latency(_recorderHandle, frames);
+    final result = frames.value;
+    malloc.free(frames);
+    return result;
+  }
+
+  @override
+  double get inputLatency {
+    if (_recorderHandle == nullptr) {
+      return 0;
+    }
+    return _bindings.ogg_opus_recorder_get_input_latency(
+        _recorderHandle, nullptr);
+  }
+
+  @override
+  int get droppedFrames {
+    if (_recorderHandle == nullptr) {
+      return 0;
+    }
+    return _bindings.ogg_opus_recorder_get_dropped_frames(
+        _recorderHandle, nullptr);
+  }
+
+  @override
+  int get overflowCount {
+    if (_recorderHandle == nullptr) {
+      return 0;
+    }
+    final overflows = malloc<Int64>();
+    _bindings.ogg_opus_recorder_get_dropped_frames(_recorderHandle, overflows);
+    final result = overflows.value;
+    malloc.free(overflows);
+    return result;
+  }
+
   @override
   Future<List<int>> getWaveformData() async {
     if (_recorderHandle == nullptr) {
@@ -5,8 +5,12 @@ import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 import 'package:system_clock/system_clock.dart';
 
+import 'playback_event.dart';
 import 'player.dart';
 import 'player_state.dart';
+import 'player_stats.dart';
+import 'recording_event.dart';
+import 'waveform_bar.dart';
 
 PlayerState _convertFromRawValue(int state) {
   switch (state) {
@@ -185,6 +189,54 @@ class OggOpusPlayerPluginImpl extends OggOpusPlayer {
     });
   }
 
+  @override
+  void seek(double position) {
+    throw UnsupportedError(
+        'seek is not supported on ${Platform.operatingSystem}');
+  }
+
+  @override
+  void setVolume(double volume) {
+    throw UnsupportedError(
+        'setVolume is not supported on ${Platform.operatingSystem}');
+  }
+
+  @override
+  bool enqueue(String path) {
+    throw UnsupportedError(
+        'enqueue is not supported on ${Platform.operatingSystem}');
+  }
+
+  @override
+  ValueListenable<int> get currentTrack => throw UnsupportedError(
+      'currentTrack is not supported on ${Platform.operatingSystem}');
+
+  @override
+  Stream<PlaybackEvent> get playbackEvents => throw UnsupportedError(
+      'playbackEvents is not supported on ${Platform.operatingSystem}');
+
+  @override
+  void setEventInterval(Duration interval) {
+    throw UnsupportedError(
+        'setEventInterval is not supported on ${Platform.operatingSystem}');
+  }
+
+  @override
+  PlayerStats? get stats => throw UnsupportedError(
+      'stats is not supported on ${Platform.operatingSystem}');
+
+  @override
+  void appendData(Uint8List bytes) {
+    throw UnsupportedError(
+        'appendData is not supported on ${Platform.operatingSystem}');
+  }
+
+  @override
+  void endOfData() {
+    throw UnsupportedError(
+        'endOfData is not supported on ${Platform.operatingSystem}');
+  }
+
   @override
   void dispose() {
     _channel.invokeMethod("stop", _playerId);
@@ -249,6 +301,45 @@ class OggOpusRecorderPluginImpl extends OggOpusRecorder {
     return _waveformData ?? [];
   }
 
+  @override
+  int get deviceBufferFrames => throw UnsupportedError(
+      'deviceBufferFrames is not supported on ${Platform.operatingSystem}');
+
+  @override
+  double get inputLatency => throw UnsupportedError(
+      'inputLatency is not supported on ${Platform.operatingSystem}');
+
+  @override
+  List<WaveformBar> waveform(int bars, {double seconds = 0}) =>
+      throw UnsupportedError(
+          'waveform is not supported on ${Platform.operatingSystem}');
+
+  @override
+  WaveformBar level() => throw UnsupportedError(
+      'level is not supported on ${Platform.operatingSystem}');
+
+  @override
+  int get droppedFrames => throw UnsupportedError(
+      'droppedFrames is not supported on ${Platform.operatingSystem}');
+
+  @override
+  int get overflowCount => throw UnsupportedError(
+      'overflowCount is not supported on ${Platform.operatingSystem}');
+
+  @override
+  Stream<RecordingEvent> get recordingEvents => throw UnsupportedError(
+      'recordingEvents is not supported on ${Platform.operatingSystem}');
+
+  @override
+  void setEventInterval(Duration interval) {
+    throw UnsupportedError(
+        'setEventInterval is not supported on ${Platform.operatingSystem}');
+  }
+
+  @override
+  Stream<Uint8List> get pages => throw UnsupportedError(
+      'pages is not supported on ${Platform.operatingSystem}');
+
   void onCanceled(int reason) {
     _stopCompleter.complete();
   }
@@ -4,4 +4,7 @@ enum PlayerState {
   playing,
   paused,
   ended,
+
+  /// playing, but waiting for more bytes of a streaming player.
+  buffering,
 }
@@ -0,0 +1,77 @@
+/// Audio callback instrumentation of a player since it was created, see
+/// [OggOpusPlayer.stats].
+///
+/// Histograms count durations in power of two buckets of microseconds:
+/// bucket 0 counts values below 1us, bucket i the values in
+/// [2^(i-1), 2^i) us and the last bucket everything above.
+class PlayerStats {
+  const PlayerStats({
+    required this.callbacks,
+    required this.underruns,
+    required this.callbackDurationMean,
+    required this.callbackDurationMax,
+    required this.callbackPeriodMean,
+    required this.callbackPeriodMax,
+    required this.deadlineMarginMin,
+    required this.bufferFill,
+    required this.bufferFillMin,
+    required this.bufferCapacity,
+    required this.callbackDurationHistogram,
+    required this.callbackPeriodHistogram,
+    required this.deadlineMarginHistogram,
+    required this.pcmCacheHits,
+    required this.pcmCacheMisses,
+    required this.pcmCacheEvictions,
+    required this.pcmCacheBytes,
+    required this.pcmCacheCapacity,
+  });
+
+  /// Count of audio callbacks that rendered the player.
+  final int callbacks;
+
+  /// Count of audio callbacks that ran out of decoded audio.
+  final int underruns;
+
+  /// Time spent rendering the player per callback, in microseconds.
+  final double callbackDurationMean;
+  final double callbackDurationMax;
+
+  /// Time between two renders of the player, in microseconds.
+  final double callbackPeriodMean;
+  final double callbackPeriodMax;
+
+  /// Smallest time left in the device buffer once the player was rendered,
+  /// in microseconds. Negative means a deadline was missed.
+  final double deadlineMarginMin;
+
+  /// Decoded audio ahead of the audio callback after the last render, its
+  /// minimum and the capacity of the decode-ahead buffer, in milliseconds.
+  final double bufferFill;
+  final double bufferFillMin;
+  final double bufferCapacity;
+
+  final List<int> callbackDurationHistogram;
+  final List<int> callbackPeriodHistogram;
+  final List<int> deadlineMarginHistogram;
+
+  /// The process wide cache of decoded audio shared by all players, see
+  /// [OggOpusPlayer.setPcmCacheSize]: files found and not found in it,
+  /// files evicted to stay within the budget, the bytes it holds and the
+  /// budget.
+  final int pcmCacheHits;
+  final int pcmCacheMisses;
+  final int pcmCacheEvictions;
+  final int pcmCacheBytes;
+  final int pcmCacheCapacity;
+
+  @override
+  String toString() {
+    return 'PlayerStats(callbacks: $callbacks, underruns: $underruns, '
+        'callbackDuration: $callbackDurationMean/$callbackDurationMax us, '
+        'callbackPeriod: $callbackPeriodMean/$callbackPeriodMax us, '
+        'deadlineMarginMin: $deadlineMarginMin us, '
+        'bufferFill: $bufferFill/$bufferFillMin/$bufferCapacity ms, '
+        'pcmCache: $pcmCacheHits hits/$pcmCacheMisses misses/'
+        '$pcmCacheEvictions evictions, $pcmCacheBytes/$pcmCacheCapacity bytes)';
+  }
+}
@@ -0,0 +1,33 @@
+/// Recording progress pushed by the native recorder, see
+/// [OggOpusRecorder.recordingEvents].
+class RecordingEvent {
+  const RecordingEvent({
+    required this.duration,
+    required this.peakLevel,
+    required this.rmsLevel,
+    required this.droppedFrames,
+    required this.bitrate,
+  });
+
+  /// Duration of the audio encoded so far, in seconds.
+  final double duration;
+
+  /// Largest absolute sample level and root mean square level of the input
+  /// since the previous event, in [0, 1].
+  final double peakLevel;
+
+  final double rmsLevel;
+
+  /// Frames of input dropped so far, see [OggOpusRecorder.droppedFrames].
+  final int droppedFrames;
+
+  /// Average bitrate of the encoded audio so far, in bits per second.
+  final double bitrate;
+
+  @override
+  String toString() {
+    return 'RecordingEvent(duration: $duration, peakLevel: $peakLevel, '
+        'rmsLevel: $rmsLevel, droppedFrames: $droppedFrames, '
+        'bitrate: $bitrate)';
+  }
+}
@@ -0,0 +1,18 @@
+/// Level of a part of a recording, see [OggOpusRecorder.waveform].
+class WaveformBar {
+  const WaveformBar({
+    required this.peak,
+    required this.rms,
+  });
+
+  /// Largest absolute sample level, in [0, 1].
+  final double peak;
+
+  /// Root mean square level, in [0, 1].
+  final double rms;
+
+  @override
+  String toString() {
+    return 'WaveformBar(peak: $peak, rms: $rms)';
+  }
+}
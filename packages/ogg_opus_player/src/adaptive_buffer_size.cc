@@ -0,0 +1,112 @@
+//
+// Device buffer size of the low latency mode, for the output mixer and the
+// recorder.
+//
+
+#include "adaptive_buffer_size.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// a callback later than this many buffer durations after the previous one
+// is a glitch.
+const double kGlitchPeriods = 2.0;
+
+// callbacks right after the device started may come in bursts, they are
+// not held against the buffer size.
+const int kSettleCallbacks = 8;
+
+const int kMinFrames = 64;
+const int kMaxFrames = 16384;
+
+}
+
+AdaptiveBufferSize::AdaptiveBufferSize(std::function<void(int frames)> reopen)
+    : reopen_(std::move(reopen)),
+      frames_(kDefaultFrames),
+      sample_rate_(0),
+      glitches_(0),
+      grows_(0),
+      grow_requested_(false),
+      running_(false) {
+}
+
+AdaptiveBufferSize::~AdaptiveBufferSize() {
+  if (thread_.joinable()) {
+    running_.store(false, std::memory_order_release);
+    SDL_SemPost(semaphore_);
+    thread_.join();
+  }
+  if (semaphore_) {
+    SDL_DestroySemaphore(semaphore_);
+  }
+}
+
+void AdaptiveBufferSize::SetBounds(int min_frames, int max_frames) {
+  if (min_frames <= 0 && max_frames <= 0) {
+    min_frames = kDefaultFrames;
+    max_frames = kDefaultFrames;
+  }
+  min_frames_ = std::min(kMaxFrames, std::max(kMinFrames, min_frames));
+  max_frames_ = std::min(kMaxFrames, std::max(min_frames_, max_frames));
+  if (max_frames_ > min_frames_ && !thread_.joinable()) {
+    semaphore_ = SDL_CreateSemaphore(0);
+    running_.store(true, std::memory_order_release);
+    thread_ = std::thread(&AdaptiveBufferSize::Run, this);
+  }
+}
+
+void AdaptiveBufferSize::Opened(int frames, int sample_rate) {
+  frames_.store(frames, std::memory_order_relaxed);
+  sample_rate_.store(sample_rate, std::memory_order_relaxed);
+  period_ticks_ = sample_rate > 0 ? SDL_GetPerformanceFrequency() * frames / sample_rate : 0;
+  Restart();
+}
+
+void AdaptiveBufferSize::Restart() {
+  last_callback_at_ = 0;
+  settle_callbacks_ = kSettleCallbacks;
+}
+
+double AdaptiveBufferSize::latency() const {
+  auto sample_rate = sample_rate_.load(std::memory_order_relaxed);
+  return sample_rate > 0 ? double(frames()) / sample_rate : 0;
+}
+
+void AdaptiveBufferSize::OnCallback() {
+  if (max_frames_ <= min_frames_) {
+    return;
+  }
+  auto now = SDL_GetPerformanceCounter();
+  auto last = last_callback_at_;
+  last_callback_at_ = now;
+  if (settle_callbacks_ > 0) {
+    settle_callbacks_--;
+    return;
+  }
+  if (last == 0 || double(now - last) <= kGlitchPeriods * double(period_ticks_)) {
+    return;
+  }
+  glitches_.store(glitches_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (frames() < max_frames_ && !grow_requested_.exchange(true, std::memory_order_acq_rel)) {
+    SDL_SemPost(semaphore_);
+  }
+}
+
+void AdaptiveBufferSize::Run() {
+  while (true) {
+    SDL_SemWait(semaphore_);
+    if (!running_.load(std::memory_order_acquire)) {
+      break;
+    }
+    auto current = frames();
+    auto next = std::min(max_frames_, current * 2);
+    if (next > current) {
+      reopen_(next);
+      grows_.store(grows_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    grow_requested_.store(false, std::memory_order_release);
+  }
+}
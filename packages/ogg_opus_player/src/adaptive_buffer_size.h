@@ -0,0 +1,89 @@
+//
+// Device buffer size of the low latency mode, for the output mixer and the
+// recorder.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__ADAPTIVE_BUFFER_SIZE_H_
+#define OGG_OPUS_PLAYER_LIBRARY__ADAPTIVE_BUFFER_SIZE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+#include "SDL.h"
+
+// Opens a device with the smallest buffer of its bounds and doubles the
+// buffer whenever the device glitched: a callback came more than twice the
+// buffer duration after the previous one, so an output device ran dry or a
+// capture device dropped input. The device is reopened on a helper thread,
+// never on the audio thread.
+class AdaptiveBufferSize {
+
+ public:
+  // Device buffer size outside of the low latency mode.
+  static const int kDefaultFrames = 1024;
+
+  // |reopen| runs on the helper thread, it reopens the device with a buffer
+  // of the given frames, or the previous size if that failed, and calls
+  // Opened().
+  explicit AdaptiveBufferSize(std::function<void(int frames)> reopen);
+
+  ~AdaptiveBufferSize();
+
+  // Before the device is opened. Grow from |min_frames| up to |max_frames|,
+  // the size is fixed if both are equal. 0 for both goes back to the fixed
+  // kDefaultFrames.
+  void SetBounds(int min_frames, int max_frames);
+
+  // the size to open the device with first.
+  int initial_frames() const { return min_frames_; }
+
+  // Device owner, with the device paused. The device was opened with a
+  // buffer of |frames| frames at |sample_rate|.
+  void Opened(int frames, int sample_rate);
+
+  // Device owner, with the device paused. It resumes, the gap before the
+  // next callback is no glitch.
+  void Restart();
+
+  // Audio thread, at the start of every callback.
+  void OnCallback();
+
+  // Any thread. the size the device runs with, and its latency in seconds.
+  int frames() const { return frames_.load(std::memory_order_relaxed); }
+  double latency() const;
+
+  // Any thread. callbacks that came late, and how often the buffer grew.
+  int64_t glitches() const { return glitches_.load(std::memory_order_relaxed); }
+  int64_t grows() const { return grows_.load(std::memory_order_relaxed); }
+
+ private:
+  std::function<void(int frames)> reopen_;
+
+  int min_frames_ = kDefaultFrames;
+  int max_frames_ = kDefaultFrames;
+
+  std::atomic<int> frames_;
+  std::atomic<int> sample_rate_;
+
+  // written with the device paused, read by the audio thread.
+  uint64_t period_ticks_ = 0;
+  uint64_t last_callback_at_ = 0;
+  int settle_callbacks_ = 0;
+
+  std::atomic<int64_t> glitches_;
+  std::atomic<int64_t> grows_;
+
+  // set by the audio thread until the helper thread handled the growth.
+  std::atomic<bool> grow_requested_;
+
+  std::thread thread_;
+  SDL_sem *semaphore_ = nullptr;
+  std::atomic<bool> running_;
+
+  void Run();
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__ADAPTIVE_BUFFER_SIZE_H_
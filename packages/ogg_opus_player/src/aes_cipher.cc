@@ -0,0 +1,189 @@
+//
+// AES block cipher, FIPS-197.
+//
+
+#include "aes_cipher.h"
+
+#include <cstring>
+
+namespace {
+
+const uint8_t kSbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+const uint8_t kInverseSbox[256] = {
+    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+    0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+    0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+    0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+    0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+    0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+    0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+    0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+    0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+    0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+    0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d,
+};
+
+// multiplication by x in GF(2^8).
+inline uint8_t Xtime(uint8_t value) {
+  return uint8_t((value << 1) ^ ((value & 0x80) ? 0x1b : 0));
+}
+
+inline uint8_t Multiply(uint8_t a, uint8_t b) {
+  uint8_t product = 0;
+  while (b) {
+    if (b & 1) {
+      product ^= a;
+    }
+    a = Xtime(a);
+    b >>= 1;
+  }
+  return product;
+}
+
+// the state is column major, byte |row + 4 * column|, like the input block.
+inline void AddRoundKey(uint8_t *state, const uint8_t *round_key) {
+  for (int i = 0; i < AesCipher::kBlockSize; ++i) {
+    state[i] ^= round_key[i];
+  }
+}
+
+inline void SubBytes(uint8_t *state, const uint8_t *box) {
+  for (int i = 0; i < AesCipher::kBlockSize; ++i) {
+    state[i] = box[state[i]];
+  }
+}
+
+// row r rotates left by r columns, or right when |inverse|.
+inline void ShiftRows(uint8_t *state, bool inverse) {
+  uint8_t shifted[AesCipher::kBlockSize];
+  for (int row = 0; row < 4; ++row) {
+    for (int column = 0; column < 4; ++column) {
+      auto from = inverse ? (column - row + 4) % 4 : (column + row) % 4;
+      shifted[row + 4 * column] = state[row + 4 * from];
+    }
+  }
+  memcpy(state, shifted, sizeof(shifted));
+}
+
+inline void MixColumns(uint8_t *state) {
+  for (int column = 0; column < 4; ++column) {
+    auto *c = state + 4 * column;
+    auto all = uint8_t(c[0] ^ c[1] ^ c[2] ^ c[3]);
+    auto first = c[0];
+    c[0] ^= all ^ Xtime(uint8_t(c[0] ^ c[1]));
+    c[1] ^= all ^ Xtime(uint8_t(c[1] ^ c[2]));
+    c[2] ^= all ^ Xtime(uint8_t(c[2] ^ c[3]));
+    c[3] ^= all ^ Xtime(uint8_t(c[3] ^ first));
+  }
+}
+
+inline void InverseMixColumns(uint8_t *state) {
+  for (int column = 0; column < 4; ++column) {
+    auto *c = state + 4 * column;
+    uint8_t a[4] = {c[0], c[1], c[2], c[3]};
+    for (int row = 0; row < 4; ++row) {
+      c[row] = uint8_t(Multiply(a[row], 0x0e) ^ Multiply(a[(row + 1) % 4], 0x0b)
+                           ^ Multiply(a[(row + 2) % 4], 0x0d) ^ Multiply(a[(row + 3) % 4], 0x09));
+    }
+  }
+}
+
+}
+
+void SecureZero(void *data, size_t length) {
+  // a plain memset may be optimized away before the memory dies.
+  volatile auto *bytes = static_cast<uint8_t *>(data);
+  for (size_t i = 0; i < length; ++i) {
+    bytes[i] = 0;
+  }
+}
+
+AesCipher::~AesCipher() {
+  SecureZero(round_keys_, sizeof(round_keys_));
+}
+
+bool AesCipher::SetKey(const uint8_t *key, size_t length) {
+  if (length != 16 && length != 24 && length != 32) {
+    return false;
+  }
+  auto key_words = int(length / 4);
+  rounds_ = key_words + 6;
+  auto total_words = 4 * (rounds_ + 1);
+  memcpy(round_keys_, key, length);
+
+  uint8_t round_constant = 1;
+  for (int i = key_words; i < total_words; ++i) {
+    uint8_t word[4];
+    memcpy(word, round_keys_ + 4 * (i - 1), 4);
+    if (i % key_words == 0) {
+      // RotWord, SubWord and the round constant.
+      auto first = word[0];
+      word[0] = uint8_t(kSbox[word[1]] ^ round_constant);
+      word[1] = kSbox[word[2]];
+      word[2] = kSbox[word[3]];
+      word[3] = kSbox[first];
+      round_constant = Xtime(round_constant);
+    } else if (key_words > 6 && i % key_words == 4) {
+      for (auto &byte : word) {
+        byte = kSbox[byte];
+      }
+    }
+    for (int j = 0; j < 4; ++j) {
+      round_keys_[4 * i + j] = uint8_t(round_keys_[4 * (i - key_words) + j] ^ word[j]);
+    }
+  }
+  return true;
+}
+
+void AesCipher::EncryptBlock(const uint8_t *in, uint8_t *out) const {
+  uint8_t state[kBlockSize];
+  memcpy(state, in, kBlockSize);
+  AddRoundKey(state, round_keys_);
+  for (int round = 1; round <= rounds_; ++round) {
+    SubBytes(state, kSbox);
+    ShiftRows(state, false);
+    if (round < rounds_) {
+      MixColumns(state);
+    }
+    AddRoundKey(state, round_keys_ + round * kBlockSize);
+  }
+  memcpy(out, state, kBlockSize);
+}
+
+void AesCipher::DecryptBlock(const uint8_t *in, uint8_t *out) const {
+  uint8_t state[kBlockSize];
+  memcpy(state, in, kBlockSize);
+  AddRoundKey(state, round_keys_ + rounds_ * kBlockSize);
+  for (int round = rounds_ - 1; round >= 0; --round) {
+    ShiftRows(state, true);
+    SubBytes(state, kInverseSbox);
+    AddRoundKey(state, round_keys_ + round * kBlockSize);
+    if (round > 0) {
+      InverseMixColumns(state);
+    }
+  }
+  memcpy(out, state, kBlockSize);
+}
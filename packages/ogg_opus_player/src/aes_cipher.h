@@ -0,0 +1,46 @@
+//
+// AES block cipher, FIPS-197.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__AES_CIPHER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__AES_CIPHER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// A compact byte oriented AES with 128, 192 and 256 bit keys, enough to
+// decrypt audio at many times its bitrate. It is not hardened against
+// timing side channels, the keys it is used with protect files at rest.
+class AesCipher {
+
+ public:
+  static const int kBlockSize = 16;
+
+  AesCipher() = default;
+
+  // wipes the round keys.
+  ~AesCipher();
+
+  AesCipher(const AesCipher &) = delete;
+  AesCipher &operator=(const AesCipher &) = delete;
+
+  // |length| is 16, 24 or 32 bytes. return false for other lengths.
+  bool SetKey(const uint8_t *key, size_t length);
+
+  // one block of kBlockSize bytes, |in| and |out| may be the same.
+  void EncryptBlock(const uint8_t *in, uint8_t *out) const;
+  void DecryptBlock(const uint8_t *in, uint8_t *out) const;
+
+ private:
+  static const int kMaxRounds = 14;
+
+  uint8_t round_keys_[(kMaxRounds + 1) * kBlockSize] = {};
+  int rounds_ = 0;
+
+};
+
+// Overwrite key material with zeros, the compiler cannot drop it as a dead
+// store.
+void SecureZero(void *data, size_t length);
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__AES_CIPHER_H_
@@ -0,0 +1,73 @@
+//
+// Debug helper to prove the audio callbacks run without heap allocations.
+//
+
+#include "allocation_tracker.h"
+
+#ifdef OGG_OPUS_PLAYER_TRACK_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<int64_t> realtime_allocations(0);
+
+thread_local int realtime_scope_depth = 0;
+
+}
+
+RealtimeAllocationScope::RealtimeAllocationScope() {
+  realtime_scope_depth++;
+}
+
+RealtimeAllocationScope::~RealtimeAllocationScope() {
+  realtime_scope_depth--;
+}
+
+int64_t realtime_allocation_count() {
+  return realtime_allocations.load(std::memory_order_relaxed);
+}
+
+void ogg_opus_count_realtime_allocation(void) {
+  if (realtime_scope_depth > 0) {
+    realtime_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void *operator new(std::size_t size) {
+  ogg_opus_count_realtime_allocation();
+  auto *p = std::malloc(size == 0 ? 1 : size);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+#else
+
+void ogg_opus_count_realtime_allocation(void) {
+}
+
+#endif // OGG_OPUS_PLAYER_TRACK_ALLOCATIONS
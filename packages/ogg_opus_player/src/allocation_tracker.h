@@ -0,0 +1,54 @@
+//
+// Debug helper to prove the audio callbacks run without heap allocations.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__ALLOCATION_TRACKER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__ALLOCATION_TRACKER_H_
+
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Called by operator new and by sonic (see SONIC_ALLOCATION_HOOK) for every
+// allocation, only counts the ones made inside a RealtimeAllocationScope.
+void ogg_opus_count_realtime_allocation(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+#ifdef OGG_OPUS_PLAYER_TRACK_ALLOCATIONS
+
+// Marks the current thread as running realtime audio code for the lifetime
+// of the scope. Allocations made in the scope are counted.
+class RealtimeAllocationScope {
+ public:
+  RealtimeAllocationScope();
+  ~RealtimeAllocationScope();
+};
+
+// Total allocations made inside any RealtimeAllocationScope.
+int64_t realtime_allocation_count();
+
+#else
+
+// user-provided, a defaulted constructor would make every scope an unused
+// variable.
+class RealtimeAllocationScope {
+ public:
+  RealtimeAllocationScope() {}
+  ~RealtimeAllocationScope() {}
+};
+
+// Tracking is not compiled in.
+inline int64_t realtime_allocation_count() { return -1; }
+
+#endif // OGG_OPUS_PLAYER_TRACK_ALLOCATIONS
+
+#endif // __cplusplus
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__ALLOCATION_TRACKER_H_
@@ -0,0 +1,340 @@
+//
+// Process wide software mixer, all players share one SDL output device.
+//
+
+#include "audio_mixer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OGG_OPUS_MIXER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OGG_OPUS_MIXER_NEON
+#include <arm_neon.h>
+#endif
+
+#include "allocation_tracker.h"
+#include "ogg_opus_utils.h"
+#include "polyphase_resampler.h"
+
+namespace {
+
+const int kGainShift = 12;
+const int32_t kUnityGain = 1 << kGainShift;
+const float kMaxGain = 4.0f;
+
+const int kOutputSampleRate = 48000;
+const int kOutputChannels = 2;
+
+inline int16_t SaturateInt16(int32_t value) {
+  return int16_t(std::min<int32_t>(INT16_MAX, std::max<int32_t>(INT16_MIN, value)));
+}
+
+}
+
+AudioSource::~AudioSource() = default;
+
+void MixSaturating(int16_t *dst, const int16_t *src, int count, int32_t gain) {
+  int i = 0;
+#if defined(OGG_OPUS_MIXER_SSE2)
+  if (gain == kUnityGain) {
+    for (; i + 8 <= count; i += 8) {
+      auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+      auto b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_adds_epi16(a, b));
+    }
+  } else {
+    // 16x16 -> 32 bit products from the low and high halves, shifted back
+    // to Q0 and packed with saturation.
+    const auto g = _mm_set1_epi16(int16_t(gain));
+    for (; i + 8 <= count; i += 8) {
+      auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+      auto b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+      auto lo = _mm_mullo_epi16(b, g);
+      auto hi = _mm_mulhi_epi16(b, g);
+      auto p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), kGainShift);
+      auto p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), kGainShift);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                       _mm_adds_epi16(a, _mm_packs_epi32(p0, p1)));
+    }
+  }
+#elif defined(OGG_OPUS_MIXER_NEON)
+  if (gain == kUnityGain) {
+    for (; i + 8 <= count; i += 8) {
+      vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(dst + i), vld1q_s16(src + i)));
+    }
+  } else {
+    auto g = int16_t(gain);
+    for (; i + 8 <= count; i += 8) {
+      auto b = vld1q_s16(src + i);
+      auto lo = vqshrn_n_s32(vmull_n_s16(vget_low_s16(b), g), kGainShift);
+      auto hi = vqshrn_n_s32(vmull_n_s16(vget_high_s16(b), g), kGainShift);
+      vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(dst + i), vcombine_s16(lo, hi)));
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    auto scaled = SaturateInt16((int32_t(src[i]) * gain) >> kGainShift);
+    dst[i] = SaturateInt16(int32_t(dst[i]) + scaled);
+  }
+}
+
+void MixFloat(float *dst, const float *src, int count, float gain) {
+  // simple enough for the compiler to vectorize.
+  for (int i = 0; i < count; ++i) {
+    dst[i] += src[i] * gain;
+  }
+}
+
+AudioMixer *AudioMixer::Instance() {
+  static auto *mixer = new AudioMixer();
+  return mixer;
+}
+
+AudioMixer::AudioMixer()
+    : buffer_size_([this](int frames) { ReopenDevice(frames); }) {
+  for (auto &slot : slots_) {
+    slot.source.store(nullptr, std::memory_order_relaxed);
+    slot.playing.store(false, std::memory_order_relaxed);
+    slot.gain.store(kUnityGain, std::memory_order_relaxed);
+  }
+}
+
+bool AudioMixer::EnsureOpened() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (device_id_ > 0 || offline_) {
+    return true;
+  }
+
+  global_init_sdl2();
+
+  // take the native rate of the device, players resample on their decoder
+  // thread, see PolyphaseResampler. with the float pipeline also take float
+  // or int16, whichever the device runs natively, so SDL does not have to
+  // convert in the callback.
+  auto format = preferred_format_ == SampleFormat::kFloat32 ? AUDIO_F32SYS : AUDIO_S16SYS;
+  auto allowed_changes = SDL_AUDIO_ALLOW_FREQUENCY_CHANGE;
+  if (preferred_format_ == SampleFormat::kFloat32) {
+    allowed_changes |= SDL_AUDIO_ALLOW_FORMAT_CHANGE;
+  }
+  SDL_AudioSpec spec;
+  auto frames = buffer_size_.initial_frames();
+  auto device_id = OpenDevice(format, kOutputSampleRate, frames, allowed_changes, &spec);
+  if (device_id > 0 && ((spec.format != AUDIO_F32SYS && spec.format != AUDIO_S16SYS)
+      || !PolyphaseResampler::IsSupported(kOutputSampleRate, spec.freq))) {
+    SDL_CloseAudioDevice(device_id);
+    device_id = OpenDevice(format, kOutputSampleRate, frames, 0, &spec);
+  }
+  if (device_id <= 0) {
+    std::cout << "SDL_OpenAudioDevice failed: " << SDL_GetError() << std::endl;
+    return false;
+  }
+
+  spec_.sample_rate = spec.freq;
+  spec_.channels = spec.channels;
+  spec_.frames_per_buffer = spec.samples;
+  spec_.format = spec.format == AUDIO_F32SYS ? SampleFormat::kFloat32 : SampleFormat::kInt16;
+  AllocateBuffers();
+  buffer_size_.Opened(spec.samples, spec.freq);
+  device_id_ = device_id;
+  return true;
+}
+
+bool AudioMixer::OpenOffline(const AudioOutputSpec &spec) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (device_id_ > 0 || offline_) {
+    return false;
+  }
+  spec_ = spec;
+  AllocateBuffers();
+  buffer_size_.Opened(spec.frames_per_buffer, spec.sample_rate);
+  offline_ = true;
+  return true;
+}
+
+void AudioMixer::AllocateBuffers() {
+  if (spec_.format == SampleFormat::kFloat32) {
+    float_source_buffer_.resize(spec_.frames_per_buffer * spec_.channels);
+  } else {
+    source_buffer_.resize(spec_.frames_per_buffer * spec_.channels);
+  }
+}
+
+SDL_AudioDeviceID AudioMixer::OpenDevice(SDL_AudioFormat format, int sample_rate, int frames,
+                                         int allowed_changes, SDL_AudioSpec *spec) {
+  SDL_AudioSpec wanted_spec;
+  SDL_zero(wanted_spec);
+  wanted_spec.format = format;
+  wanted_spec.channels = kOutputChannels;
+  wanted_spec.samples = Uint16(frames);
+  wanted_spec.freq = sample_rate;
+  wanted_spec.callback = [](void *userdata, Uint8 *stream, int len) {
+    auto *mixer = static_cast<AudioMixer *>(userdata);
+    if (mixer->spec_.format == SampleFormat::kFloat32) {
+      auto frames = len / int(sizeof(float)) / mixer->spec_.channels;
+      mixer->Mix(reinterpret_cast<float *>(stream), frames);
+    } else {
+      auto frames = len / int(sizeof(int16_t)) / mixer->spec_.channels;
+      mixer->Mix(reinterpret_cast<int16_t *>(stream), frames);
+    }
+  };
+  wanted_spec.userdata = this;
+  return SDL_OpenAudioDevice(nullptr, 0, &wanted_spec, spec, allowed_changes);
+}
+
+bool AudioMixer::SetPreferredFormat(SampleFormat format) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (device_id_ > 0 || offline_) {
+    return false;
+  }
+  preferred_format_ = format;
+  return true;
+}
+
+bool AudioMixer::SetBufferBounds(int min_frames, int max_frames) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (device_id_ > 0 || offline_) {
+    return false;
+  }
+  buffer_size_.SetBounds(min_frames, max_frames);
+  return true;
+}
+
+// Players keep rendering |spec_.frames_per_buffer| frames at a time, the
+// pooled playback contexts and the source buffers stay valid. Only the
+// rate and format the device was opened with are requested, so they do not
+// change either.
+void AudioMixer::ReopenDevice(int frames) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (device_id_ <= 0) {
+    return;
+  }
+  auto previous_frames = buffer_size_.frames();
+  // waits for a callback in flight.
+  SDL_CloseAudioDevice(device_id_);
+  auto format = spec_.format == SampleFormat::kFloat32 ? AUDIO_F32SYS : AUDIO_S16SYS;
+  SDL_AudioSpec spec;
+  device_id_ = OpenDevice(format, spec_.sample_rate, frames, 0, &spec);
+  if (device_id_ <= 0) {
+    std::cout << "AudioMixer: reopen with " << frames << " frames failed: " << SDL_GetError() << std::endl;
+    device_id_ = OpenDevice(format, spec_.sample_rate, previous_frames, 0, &spec);
+  }
+  if (device_id_ <= 0) {
+    std::cout << "AudioMixer: reopen failed: " << SDL_GetError() << std::endl;
+    device_id_ = 0;
+    return;
+  }
+  buffer_size_.Opened(spec.samples, spec.freq);
+  if (playing_count_ > 0) {
+    SDL_PauseAudioDevice(device_id_, 0);
+  }
+}
+
+int AudioMixer::AddSource(AudioSource *source) {
+  for (int i = 0; i < kMaxSources; ++i) {
+    AudioSource *expected = nullptr;
+    auto &slot = slots_[i];
+    // a free slot is never playing, see RemoveSource().
+    if (slot.source.compare_exchange_strong(expected, source, std::memory_order_acq_rel)) {
+      slot.gain.store(kUnityGain, std::memory_order_relaxed);
+      return i;
+    }
+  }
+  std::cerr << "AudioMixer: too many sources" << std::endl;
+  return -1;
+}
+
+void AudioMixer::RemoveSource(int slot) {
+  if (slot < 0 || slot >= kMaxSources) {
+    return;
+  }
+  SetPlaying(slot, false);
+  slots_[slot].source.store(nullptr, std::memory_order_release);
+  // wait for a callback that might still render the source.
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (device_id_ > 0) {
+    SDL_LockAudioDevice(device_id_);
+    SDL_UnlockAudioDevice(device_id_);
+  }
+}
+
+void AudioMixer::SetPlaying(int slot, bool playing) {
+  if (slot < 0 || slot >= kMaxSources) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (slots_[slot].playing.exchange(playing, std::memory_order_acq_rel) == playing) {
+    return;
+  }
+  playing_count_ += playing ? 1 : -1;
+  if (device_id_ > 0 && playing_count_ == (playing ? 1 : 0)) {
+    if (playing) {
+      buffer_size_.Restart();
+    }
+    SDL_PauseAudioDevice(device_id_, playing ? 0 : 1);
+  }
+}
+
+void AudioMixer::SetGain(int slot, float gain) {
+  if (slot < 0 || slot >= kMaxSources) {
+    return;
+  }
+  gain = std::min(kMaxGain, std::max(0.0f, gain));
+  slots_[slot].gain.store(int32_t(gain * kUnityGain + 0.5f), std::memory_order_relaxed);
+}
+
+void AudioMixer::Mix(int16_t *output, int frames) {
+  RealtimeAllocationScope realtime_scope;
+  callback_started_at_ = SDL_GetPerformanceCounter();
+  callback_frames_ = frames;
+  buffer_size_.OnCallback();
+
+  auto channels = spec_.channels;
+  memset(output, 0, frames * channels * sizeof(int16_t));
+
+  auto buffer_frames = int(source_buffer_.size()) / channels;
+  for (auto &slot : slots_) {
+    auto *source = slot.source.load(std::memory_order_acquire);
+    if (!source || !slot.playing.load(std::memory_order_acquire)) {
+      continue;
+    }
+    for (int offset = 0; offset < frames; offset += buffer_frames) {
+      auto count = std::min(buffer_frames, frames - offset);
+      source->Render(source_buffer_.data(), count, channels);
+      // after the render, which may apply a volume command.
+      auto gain = slot.gain.load(std::memory_order_relaxed);
+      MixSaturating(output + offset * channels, source_buffer_.data(), count * channels, gain);
+    }
+  }
+}
+
+void AudioMixer::Mix(float *output, int frames) {
+  RealtimeAllocationScope realtime_scope;
+  callback_started_at_ = SDL_GetPerformanceCounter();
+  callback_frames_ = frames;
+  buffer_size_.OnCallback();
+
+  auto channels = spec_.channels;
+  memset(output, 0, frames * channels * sizeof(float));
+
+  auto buffer_frames = int(float_source_buffer_.size()) / channels;
+  for (auto &slot : slots_) {
+    auto *source = slot.source.load(std::memory_order_acquire);
+    if (!source || !slot.playing.load(std::memory_order_acquire)) {
+      continue;
+    }
+    for (int offset = 0; offset < frames; offset += buffer_frames) {
+      auto count = std::min(buffer_frames, frames - offset);
+      source->Render(float_source_buffer_.data(), count, channels);
+      auto gain = float(slot.gain.load(std::memory_order_relaxed)) / kUnityGain;
+      MixFloat(output + offset * channels, float_source_buffer_.data(), count * channels, gain);
+    }
+  }
+  // saturate once after all sources, like the int16 mix does per source.
+  for (int i = 0; i < frames * channels; ++i) {
+    output[i] = std::min(1.0f, std::max(-1.0f, output[i]));
+  }
+}
@@ -0,0 +1,149 @@
+//
+// Process wide software mixer, all players share one SDL output device.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__AUDIO_MIXER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__AUDIO_MIXER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "SDL.h"
+
+#include "adaptive_buffer_size.h"
+
+// Produces the samples of one player for the mixer.
+class AudioSource {
+ public:
+  virtual ~AudioSource();
+
+  // Runs on the audio thread, must not block or allocate. Write |frames|
+  // interleaved frames of |channels| channels to |output|. The mixer only
+  // calls the overload matching AudioOutputSpec::format.
+  virtual void Render(int16_t *output, int frames, int channels) = 0;
+  virtual void Render(float *output, int frames, int channels) = 0;
+};
+
+enum class SampleFormat {
+  kInt16,
+  kFloat32,
+};
+
+struct AudioOutputSpec {
+  int sample_rate = 0;
+  int channels = 0;
+  int frames_per_buffer = 0;
+  SampleFormat format = SampleFormat::kInt16;
+};
+
+class AudioMixer {
+
+ public:
+  static const int kMaxSources = 32;
+
+  static AudioMixer *Instance();
+
+  // Open the output device, only the first call touches the OS device.
+  // return false if the device could not be opened.
+  bool EnsureOpened();
+
+  // Run without an OS device, the caller pulls the output with Mix() on a
+  // single thread of its own, e.g. for benchmarks. return false if the
+  // device is already open.
+  bool OpenOffline(const AudioOutputSpec &spec);
+
+  const AudioOutputSpec &spec() const { return spec_; }
+
+  // Ask for a float device on the next EnsureOpened(), the device may still
+  // settle on int16 if that is its native format. return false if the device
+  // is already open.
+  bool SetPreferredFormat(SampleFormat format);
+
+  // Low latency mode, see AdaptiveBufferSize. Open the device with a buffer
+  // of |min_frames| and grow it up to |max_frames| when callbacks come late.
+  // return false if the device is already open.
+  bool SetBufferBounds(int min_frames, int max_frames);
+
+  // Any thread. the buffer size the device runs with, and its latency in
+  // seconds. Players always render |spec().frames_per_buffer| frames at a
+  // time, the size the device was opened with first.
+  int device_buffer_frames() const { return buffer_size_.frames(); }
+  double device_latency() const { return buffer_size_.latency(); }
+
+  // Attach |source| paused, return its slot or -1 if every slot is taken.
+  // Does not touch the OS device.
+  int AddSource(AudioSource *source);
+
+  // Detach the source in |slot|, once this returns the audio thread no
+  // longer uses it.
+  void RemoveSource(int slot);
+
+  void SetPlaying(int slot, bool playing);
+
+  // Linear gain of the source in |slot|, clamped to [0, 4]. Wait-free, a
+  // source may call it from its Render() to change the gain of that buffer.
+  void SetGain(int slot, float gain);
+
+  // Mix |frames| frames of every playing source into |output|. Called by the
+  // SDL callback, public for offline rendering.
+  void Mix(int16_t *output, int frames);
+  void Mix(float *output, int frames);
+
+  // Audio thread only. Performance counter value at the start of the Mix()
+  // that is running, and the frames it mixes.
+  uint64_t callback_started_at() const { return callback_started_at_; }
+  int callback_frames() const { return callback_frames_; }
+
+ private:
+  AudioMixer();
+
+  struct Slot {
+    std::atomic<AudioSource *> source;
+    std::atomic<bool> playing;
+    // Q12 fixed point, see kUnityGain.
+    std::atomic<int32_t> gain;
+  };
+
+  Slot slots_[kMaxSources];
+
+  // guards the device and |playing_count_| against concurrent control calls.
+  std::mutex mutex_;
+
+  SDL_AudioDeviceID device_id_ = 0;
+  bool offline_ = false;
+  AudioOutputSpec spec_;
+
+  // the device runs only while at least one source is playing.
+  int playing_count_ = 0;
+
+  SampleFormat preferred_format_ = SampleFormat::kInt16;
+
+  uint64_t callback_started_at_ = 0;
+  int callback_frames_ = 0;
+
+  AdaptiveBufferSize buffer_size_;
+
+  // audio thread only, one device buffer a source renders into.
+  std::vector<int16_t> source_buffer_;
+  std::vector<float> float_source_buffer_;
+
+  SDL_AudioDeviceID OpenDevice(SDL_AudioFormat format, int sample_rate, int frames,
+                               int allowed_changes, SDL_AudioSpec *spec);
+
+  // helper thread of |buffer_size_|, reopen the device with a larger buffer.
+  void ReopenDevice(int frames);
+
+  // size the source buffers for |spec_|.
+  void AllocateBuffers();
+
+};
+
+// dst[i] = saturate(dst[i] + src[i] * gain), |gain| in Q12.
+void MixSaturating(int16_t *dst, const int16_t *src, int count, int32_t gain);
+
+// dst[i] += src[i] * gain.
+void MixFloat(float *dst, const float *src, int count, float gain);
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__AUDIO_MIXER_H_
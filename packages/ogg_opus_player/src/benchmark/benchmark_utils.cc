@@ -0,0 +1,79 @@
+//
+// Shared helpers for the ogg_opus_player benchmarks.
+//
+
+#include "benchmark_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include "../ogg/opusenc.h"
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+}
+
+int GenerateOggOpusFile(const std::string &path, int seconds, int channels) {
+  const int sample_rate = 48000;
+  const int frames_per_chunk = sample_rate / 50;
+
+  auto *comments = ope_comments_create();
+  if (!comments) {
+    return -1;
+  }
+  int error = OPE_OK;
+  auto *encoder = ope_encoder_create_file(path.c_str(), comments, sample_rate, channels, 0, &error);
+  if (error != OPE_OK || !encoder) {
+    std::cerr << "ope_encoder_create_file failed: " << error << std::endl;
+    ope_comments_destroy(comments);
+    return -1;
+  }
+  ope_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(0));
+  ope_encoder_ctl(encoder, OPUS_SET_BITRATE(16 * 1024));
+
+  // a pitch gliding tone with a syllable like envelope, so that sonic finds
+  // pitch periods and silence detection does not kick in.
+  std::vector<opus_int16> chunk(frames_per_chunk * channels);
+  double phase = 0;
+  int64_t frame = 0;
+  const int64_t total_frames = int64_t(seconds) * sample_rate;
+  while (frame < total_frames) {
+    for (int i = 0; i < frames_per_chunk; ++i, ++frame) {
+      auto t = double(frame) / sample_rate;
+      auto pitch = 140.0 + 60.0 * std::sin(2 * kPi * 0.3 * t);
+      auto envelope = 0.5 + 0.5 * std::sin(2 * kPi * 3.0 * t);
+      phase += 2 * kPi * pitch / sample_rate;
+      auto value = opus_int16(8000.0 * envelope * (std::sin(phase) + 0.3 * std::sin(3 * phase)));
+      for (int c = 0; c < channels; ++c) {
+        chunk[i * channels + c] = value;
+      }
+    }
+    if (ope_encoder_write(encoder, chunk.data(), frames_per_chunk) != OPE_OK) {
+      std::cerr << "ope_encoder_write failed" << std::endl;
+      break;
+    }
+  }
+  ope_encoder_drain(encoder);
+  ope_encoder_destroy(encoder);
+  ope_comments_destroy(comments);
+  return frame >= total_frames ? 0 : -1;
+}
+
+void PrintPercentiles(const char *name, std::vector<double> &samples,
+                      double scale, const char *unit) {
+  if (samples.empty()) {
+    printf("%-28s no samples\n", name);
+    return;
+  }
+  std::sort(samples.begin(), samples.end());
+  auto at = [&](double percentile) {
+    auto index = size_t(percentile * double(samples.size() - 1) + 0.5);
+    return samples[index] * scale;
+  };
+  printf("%-28s min %9.3f  p50 %9.3f  p95 %9.3f  p99 %9.3f  max %9.3f %s (n=%zu)\n",
+         name, at(0), at(0.5), at(0.95), at(0.99), at(1), unit, samples.size());
+}
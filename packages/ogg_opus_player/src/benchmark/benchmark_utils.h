@@ -0,0 +1,28 @@
+//
+// Shared helpers for the ogg_opus_player benchmarks.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__BENCHMARK_UTILS_H_
+#define OGG_OPUS_PLAYER_LIBRARY__BENCHMARK_UTILS_H_
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Encode |seconds| of a synthetic voice-like signal to an ogg opus file at
+// |path|. Uses the lowest encoder complexity, so an hour long file is
+// generated in a reasonable time. Return 0 on success.
+int GenerateOggOpusFile(const std::string &path, int seconds, int channels);
+
+// Nanoseconds elapsed since |start|.
+inline double ElapsedNanoseconds(std::chrono::steady_clock::time_point start) {
+  return double(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count());
+}
+
+// Print min/median/p95/p99/max of |samples| (sorted in place), scaled by
+// |scale| and suffixed with |unit|.
+void PrintPercentiles(const char *name, std::vector<double> &samples,
+                      double scale, const char *unit);
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__BENCHMARK_UTILS_H_
@@ -0,0 +1,89 @@
+//
+// Compares the peak / rms kernels of the recorder against the scalar loop,
+// in the block sizes the waveform and the encoder thread measure. The same
+// second of audio is measured over and over, the encoder thread measures
+// samples it just read from the capture ring, which are in the cache too.
+//
+// usage: ogg_opus_levels_benchmark [seconds of audio]
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "../sample_levels.h"
+
+namespace {
+
+const int kSampleRate = 16000;
+
+bool SameLevels(const SampleLevels &a, const SampleLevels &b) {
+  return a.min == b.min && a.max == b.max && a.square_sum == b.square_sum;
+}
+
+// return nanoseconds spent per second of audio, |block_times| gets the time
+// of every pass over |samples| in nanoseconds per block.
+double Run(LevelKernel kernel, const std::vector<int16_t> &samples, int block, int passes,
+           std::vector<double> &block_times) {
+  int64_t checksum = 0;
+  auto blocks = int(samples.size()) / block;
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; ++pass) {
+    auto pass_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < blocks; ++i) {
+      auto levels = MeasureLevels(kernel, samples.data() + size_t(i) * block, block);
+      checksum += levels.square_sum + levels.Peak();
+    }
+    block_times.push_back(ElapsedNanoseconds(pass_start) / blocks);
+  }
+  auto elapsed = ElapsedNanoseconds(start);
+  if (checksum == 0) {
+    printf("no output\n");
+  }
+  return elapsed * kSampleRate / (double(blocks) * block * passes);
+}
+
+}
+
+int main(int argc, char **argv) {
+  auto seconds = argc > 1 ? atoi(argv[1]) : 600;
+  std::vector<int16_t> samples(kSampleRate);
+  srand(1);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    auto voice = 20000 * std::sin(0.07 * double(i)) * std::sin(0.0003 * double(i));
+    samples[i] = int16_t(voice + rand() % 2001 - 1000);
+  }
+  // full scale excursions of both polarities.
+  samples[samples.size() / 3] = INT16_MIN;
+  samples[samples.size() / 2] = INT16_MAX;
+
+  printf("dispatching to %s\n", LevelKernelName(BestLevelKernel()));
+  for (auto block : {100, 320, 1024, 4096}) {
+    double scalar = 0;
+    for (auto kernel : {LevelKernel::kScalar, LevelKernel::kSse2, LevelKernel::kAvx2}) {
+      if (!IsLevelKernelSupported(kernel)) {
+        printf("%d samples, %s: not supported\n", block, LevelKernelName(kernel));
+        continue;
+      }
+      for (size_t offset = 0; offset + block <= samples.size(); offset += samples.size() / 7) {
+        auto expected = MeasureLevels(LevelKernel::kScalar, samples.data() + offset, block);
+        if (!SameLevels(MeasureLevels(kernel, samples.data() + offset, block), expected)) {
+          printf("%d samples, %s: levels differ from the scalar loop\n", block, LevelKernelName(kernel));
+          return 1;
+        }
+      }
+      std::vector<double> block_times;
+      auto per_second = Run(kernel, samples, block, seconds, block_times);
+      if (kernel == LevelKernel::kScalar) {
+        scalar = per_second;
+      }
+      printf("%d samples, %s: %.1f us per second of audio, %.1fx the scalar loop\n",
+             block, LevelKernelName(kernel), per_second / 1e3, scalar / per_second);
+      PrintPercentiles("  per block", block_times, 1, "ns");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,245 @@
+//
+// Renders players offline through the shared mixer, without a sound card,
+// and measures the exact playback pipeline: decoder thread, sonic and the
+// mixer callback, at playback rates from 0.5x to 3x.
+//
+// Reports per rate the realtime factor, a histogram of the time spent per
+// callback, allocations per callback and the cpu time per stream.
+//
+// usage: ogg_opus_render_benchmark [file.ogg] [streams] [--float]
+//            [--sample-rate=44100] [--pace=10]
+// without a file, a two minute stereo file is generated in the temp
+// directory. --pace renders at most that many times faster than realtime,
+// which leaves the decoder thread room to keep up, by default the callback
+// is pulled as fast as possible.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "../audio_mixer.h"
+#include "../ogg_opus_player.h"
+#include "../ogg_opus_reader.h"
+#include "dart_api_dl.h"
+
+namespace {
+
+const int kMaxStreams = AudioMixer::kMaxSources;
+
+// messages of ogg_opus_player.cc, see DartPortMessage and PlayerEventKind.
+const int64_t kPlayerReachEnded = 0;
+const int64_t kPlayerEventPlayback = 0;
+
+// players post to port |stream index + 1|.
+std::atomic<bool> stream_ended[kMaxStreams + 1];
+std::atomic<int64_t> stream_underruns[kMaxStreams + 1];
+
+bool PostInteger(Dart_Port_DL port, int64_t message) {
+  if (port > 0 && port <= kMaxStreams && message == kPlayerReachEnded) {
+    stream_ended[port].store(true, std::memory_order_release);
+  }
+  return true;
+}
+
+// keeps the underrun count of the playback events.
+bool PostCObject(Dart_Port_DL port, Dart_CObject *message) {
+  if (port <= 0 || port > kMaxStreams || message->type != Dart_CObject_kArray
+      || message->value.as_array.length < 6) {
+    return true;
+  }
+  auto **values = message->value.as_array.values;
+  if (values[0]->value.as_int64 == kPlayerEventPlayback) {
+    stream_underruns[port].store(values[4]->value.as_int64, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+// callback durations in power of two buckets of microseconds.
+void PrintHistogram(const std::vector<double> &nanoseconds) {
+  const int kBuckets = 16;
+  int counts[kBuckets] = {};
+  for (auto value : nanoseconds) {
+    auto bucket = 0;
+    for (auto limit = 1000.0; value >= limit && bucket < kBuckets - 1; limit *= 2) {
+      bucket++;
+    }
+    counts[bucket]++;
+  }
+  auto peak = *std::max_element(counts, counts + kBuckets);
+  for (int i = 0; i < kBuckets; ++i) {
+    if (counts[i] == 0) {
+      continue;
+    }
+    auto bar = int(40.0 * counts[i] / peak + 0.5);
+    printf("    %6d-%-6d us %8d %s\n", i == 0 ? 0 : 1 << (i - 1), 1 << i, counts[i],
+           std::string(size_t(std::max(1, bar)), '#').c_str());
+  }
+}
+
+struct RenderResult {
+  double audio_seconds = 0;
+  double wall_seconds = 0;
+  double cpu_seconds = 0;
+  int64_t callbacks = 0;
+  int64_t allocations = 0;
+  int64_t underruns = 0;
+  double deadline_margin_min_us = 0;
+  std::vector<double> callback_times;
+};
+
+template<typename T>
+RenderResult Render(const std::string &path, int streams, double rate, double pace, double max_seconds) {
+  auto *mixer = AudioMixer::Instance();
+  const auto &spec = mixer->spec();
+  std::vector<T> output(spec.frames_per_buffer * spec.channels);
+
+  std::vector<void *> players;
+  for (int i = 1; i <= streams; ++i) {
+    stream_ended[i].store(false);
+    stream_underruns[i].store(0);
+    auto *player = ogg_opus_player_create(path.c_str(), i);
+    if (!player) {
+      printf("failed to create a player for %s\n", path.c_str());
+      exit(1);
+    }
+    ogg_opus_player_set_playback_rate(player, rate);
+    ogg_opus_player_set_event_interval(player, 10);
+    players.push_back(player);
+  }
+  // like a device that starts a moment after play, let the decoders fill
+  // their buffers once.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  for (auto *player : players) {
+    ogg_opus_player_play(player);
+  }
+
+  RenderResult result;
+  auto buffer_seconds = double(spec.frames_per_buffer) / spec.sample_rate;
+  auto allocations = ogg_opus_player_get_realtime_allocation_count();
+  auto cpu_start = std::clock();
+  auto start = std::chrono::steady_clock::now();
+  while (result.audio_seconds < max_seconds) {
+    auto ended = std::all_of(stream_ended + 1, stream_ended + 1 + streams,
+                             [](const std::atomic<bool> &value) { return value.load(std::memory_order_acquire); });
+    if (ended) {
+      break;
+    }
+    if (pace > 0) {
+      auto due = start + std::chrono::duration<double>(result.audio_seconds / pace);
+      std::this_thread::sleep_until(due);
+    }
+    auto callback_start = std::chrono::steady_clock::now();
+    mixer->Mix(output.data(), spec.frames_per_buffer);
+    result.callback_times.push_back(ElapsedNanoseconds(callback_start));
+    result.callbacks++;
+    result.audio_seconds += buffer_seconds;
+  }
+  result.wall_seconds = ElapsedNanoseconds(start) / 1e9;
+  result.cpu_seconds = double(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  result.allocations = ogg_opus_player_get_realtime_allocation_count() - allocations;
+
+  // the last events are posted at most 10ms late.
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  for (int i = 1; i <= streams; ++i) {
+    result.underruns += stream_underruns[i].load(std::memory_order_relaxed);
+  }
+  result.deadline_margin_min_us = 1e9;
+  for (auto *player : players) {
+    OggOpusPlayerStats stats;
+    ogg_opus_player_get_stats(player, &stats);
+    result.deadline_margin_min_us = std::min(result.deadline_margin_min_us, stats.deadline_margin_min_us);
+    ogg_opus_player_dispose(player);
+  }
+  return result;
+}
+
+}
+
+int main(int argc, char **argv) {
+  std::string path;
+  int streams = 1;
+  bool use_float = false;
+  int sample_rate = kOpusSampleRate;
+  double pace = 0;
+  for (int i = 1, positional = 0; i < argc; ++i) {
+    if (strcmp(argv[i], "--float") == 0) {
+      use_float = true;
+    } else if (strncmp(argv[i], "--sample-rate=", 14) == 0) {
+      sample_rate = atoi(argv[i] + 14);
+    } else if (strncmp(argv[i], "--pace=", 7) == 0) {
+      pace = atof(argv[i] + 7);
+    } else if (positional++ == 0) {
+      path = argv[i];
+    } else {
+      streams = std::min(kMaxStreams, std::max(1, atoi(argv[i])));
+    }
+  }
+  if (path.empty()) {
+    path = "ogg_opus_render_benchmark_2m.ogg";
+    if (FILE *file = fopen(path.c_str(), "rb")) {
+      fclose(file);
+    } else {
+      printf("generating a two minute file: %s\n", path.c_str());
+      if (GenerateOggOpusFile(path, 2 * 60, 2) != 0) {
+        return 1;
+      }
+    }
+  }
+
+  OggOpusReader reader(path.c_str());
+  auto duration = double(reader.GetTotalFrames()) / kOpusSampleRate;
+  if (duration <= 0) {
+    printf("failed to open %s\n", path.c_str());
+    return 1;
+  }
+
+  // no dart vm here, count the messages the players post instead.
+  Dart_PostInteger_DL = PostInteger;
+  Dart_PostCObject_DL = PostCObject;
+
+  AudioOutputSpec spec;
+  spec.sample_rate = sample_rate;
+  spec.channels = 2;
+  spec.frames_per_buffer = 1024;
+  spec.format = use_float ? SampleFormat::kFloat32 : SampleFormat::kInt16;
+  AudioMixer::Instance()->OpenOffline(spec);
+  ogg_opus_player_warm_up(streams, reader.GetChannelCount());
+
+  printf("file: %s, %.1f seconds, %d channels, %d streams, mixer %d Hz %s, %d frames per callback\n",
+         path.c_str(), duration, reader.GetChannelCount(), streams, spec.sample_rate,
+         use_float ? "float" : "int16", spec.frames_per_buffer);
+  if (ogg_opus_player_get_realtime_allocation_count() < 0) {
+    printf("allocation tracking is not compiled in\n");
+  }
+
+  for (auto rate : {0.5, 1.0, 1.5, 2.0, 3.0}) {
+    // twice the expected output, in case a stream never reports its end.
+    auto max_seconds = 2 * duration / rate + 1;
+    auto result = use_float ? Render<float>(path, streams, rate, pace, max_seconds)
+                            : Render<int16_t>(path, streams, rate, pace, max_seconds);
+    printf("\n%.1fx: %.1f s of audio in %.3f s, %.0fx realtime, %lld callbacks, %lld underruns\n",
+           rate, result.audio_seconds, result.wall_seconds, result.audio_seconds / result.wall_seconds,
+           (long long) result.callbacks, (long long) result.underruns);
+    printf("  cpu per stream: %.3f ms per second of audio, %.2f%% of a core at realtime\n",
+           1e3 * result.cpu_seconds / result.audio_seconds / streams,
+           100 * result.cpu_seconds / result.audio_seconds / streams);
+    if (result.allocations >= 0) {
+      printf("  allocations per callback: %.3f (%lld total)\n",
+             double(result.allocations) / std::max<int64_t>(1, result.callbacks), (long long) result.allocations);
+    }
+    printf("  smallest deadline margin of a stream: %.1f us\n", result.deadline_margin_min_us);
+    PrintPercentiles("  callback", result.callback_times, 1e-3, "us");
+    PrintHistogram(result.callback_times);
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+//
+// Measures the cost of the polyphase resampler per second of audio, for the
+// device rates it is selected for, in the chunks the decoder thread uses.
+//
+// usage: ogg_opus_resampler_benchmark [seconds of audio]
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "../polyphase_resampler.h"
+
+namespace {
+
+const int kInputRate = 48000;
+const int kChunkFrames = kInputRate / 50;
+
+template<typename T>
+T Sample(double value);
+
+template<>
+int16_t Sample<int16_t>(double value) {
+  return int16_t(value * 32767);
+}
+
+template<>
+float Sample<float>(double value) {
+  return float(value);
+}
+
+// return nanoseconds spent per second of audio, |chunk_times| gets the time
+// of every chunk in microseconds.
+template<typename T>
+double Run(int output_rate, int channels, int seconds, std::vector<double> &chunk_times) {
+  PolyphaseResampler resampler(kInputRate, output_rate, channels);
+  std::vector<T> input(kChunkFrames * channels);
+  std::vector<T> output(resampler.MaxOutputFrames(kChunkFrames) * channels);
+  for (int i = 0; i < kChunkFrames; ++i) {
+    for (int c = 0; c < channels; ++c) {
+      input[i * channels + c] = Sample<T>(0.5 * std::sin(0.05 * i * (c + 1)));
+    }
+  }
+
+  auto chunks = seconds * kInputRate / kChunkFrames;
+  long long written = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < chunks; ++i) {
+    auto chunk_start = std::chrono::steady_clock::now();
+    written += resampler.Process(input.data(), kChunkFrames, output.data());
+    chunk_times.push_back(ElapsedNanoseconds(chunk_start));
+  }
+  auto elapsed = ElapsedNanoseconds(start);
+  if (written <= 0) {
+    printf("no output\n");
+  }
+  return elapsed / seconds;
+}
+
+template<typename T>
+void Report(const char *format, int output_rate, int channels, int seconds) {
+  std::vector<double> chunk_times;
+  auto per_second = Run<T>(output_rate, channels, seconds, chunk_times);
+  printf("48000 -> %d Hz, %d ch, %s: %.3f ms per second of audio, %.0fx realtime\n",
+         output_rate, channels, format, per_second / 1e6, 1e9 / per_second);
+  PrintPercentiles("  per 20ms chunk", chunk_times, 1e-3, "us");
+}
+
+}
+
+int main(int argc, char **argv) {
+  auto seconds = argc > 1 ? atoi(argv[1]) : 60;
+  for (auto output_rate : {44100, 96000, 88200, 32000, 22050, 16000}) {
+    if (!PolyphaseResampler::IsSupported(kInputRate, output_rate)) {
+      printf("48000 -> %d Hz is left to SDL\n", output_rate);
+      continue;
+    }
+    for (auto channels : {1, 2}) {
+      Report<int16_t>("int16", output_rate, channels, seconds);
+      Report<float>("float", output_rate, channels, seconds);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,104 @@
+//
+// Measures the latency of random seeks in a long ogg opus file, from the
+// seek request until the first pcm of the new position is decoded, with
+// opusfile bisecting the file and with a seek index.
+//
+// usage: ogg_opus_seek_benchmark [file.ogg] [seek count]
+// without a file, an hour long file is generated in the temp directory.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "../ogg_opus_reader.h"
+#include "../pcm_cache.h"
+#include "../seek_index.h"
+
+namespace {
+
+int RunSeeks(const std::string &path, int seek_count, const char *label) {
+  auto open_start = std::chrono::steady_clock::now();
+  OggOpusReader reader(path.c_str());
+  auto open_time = ElapsedNanoseconds(open_start);
+  auto total_frames = reader.GetTotalFrames();
+  if (total_frames <= 0) {
+    printf("failed to open %s\n", path.c_str());
+    return 1;
+  }
+  printf("%s: %s, %.1f seconds, %d channels, opened in %.3f ms\n",
+         label, path.c_str(), double(total_frames) / kOpusSampleRate,
+         reader.GetChannelCount(), open_time / 1e6);
+
+  std::vector<opus_int16> pcm(kOpusSampleRate / 50 * reader.GetChannelCount());
+  std::mt19937_64 random(42);
+  std::uniform_int_distribution<int64_t> distribution(0, total_frames - 1);
+
+  std::vector<double> seek_times;
+  std::vector<double> first_sample_times;
+  for (int i = 0; i < seek_count; ++i) {
+    auto target = distribution(random);
+    auto start = std::chrono::steady_clock::now();
+    if (reader.Seek(target) < 0) {
+      printf("seek to %lld failed\n", (long long) target);
+      return 1;
+    }
+    seek_times.push_back(ElapsedNanoseconds(start));
+    reader.ReadPcmData(pcm.data(), kOpusSampleRate / 50);
+    first_sample_times.push_back(ElapsedNanoseconds(start));
+  }
+
+  // scrubbing: many small forward and backward steps around one position.
+  std::vector<double> scrub_times;
+  auto position = total_frames / 2;
+  for (int i = 0; i < seek_count; ++i) {
+    position += (i % 2 == 0 ? 1 : -1) * int64_t(i % 10) * kOpusSampleRate / 4;
+    auto start = std::chrono::steady_clock::now();
+    reader.Seek(position);
+    reader.ReadPcmData(pcm.data(), kOpusSampleRate / 50);
+    scrub_times.push_back(ElapsedNanoseconds(start));
+  }
+
+  PrintPercentiles("random seek", seek_times, 1e-6, "ms");
+  PrintPercentiles("random seek + first pcm", first_sample_times, 1e-6, "ms");
+  PrintPercentiles("scrub seek + first pcm", scrub_times, 1e-6, "ms");
+  return 0;
+}
+
+}
+
+int main(int argc, char **argv) {
+  std::string path;
+  if (argc > 1) {
+    path = argv[1];
+  } else {
+    path = "ogg_opus_seek_benchmark_1h.ogg";
+    if (FILE *file = fopen(path.c_str(), "rb")) {
+      fclose(file);
+    } else {
+      printf("generating an hour long file: %s\n", path.c_str());
+      if (GenerateOggOpusFile(path, 60 * 60, 1) != 0) {
+        return 1;
+      }
+    }
+  }
+  auto seek_count = argc > 2 ? atoi(argv[2]) : 500;
+  // measure opusfile, not replays of cached pcm.
+  PcmCache::Instance()->SetCapacity(0);
+
+  if (RunSeeks(path, seek_count, "bisection") != 0) {
+    return 1;
+  }
+  auto index_start = std::chrono::steady_clock::now();
+  auto index = SeekIndexRegistry::Instance()->Build(path.c_str(), nullptr);
+  if (!index) {
+    printf("failed to index %s\n", path.c_str());
+    return 1;
+  }
+  printf("indexed %zu pages in %.3f ms\n", index->size(), ElapsedNanoseconds(index_start) / 1e6);
+  return RunSeeks(path, seek_count, "seek index");
+}
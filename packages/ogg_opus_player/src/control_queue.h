@@ -0,0 +1,130 @@
+//
+// Control commands from the dart thread to the audio callback.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__CONTROL_QUEUE_H_
+#define OGG_OPUS_PLAYER_LIBRARY__CONTROL_QUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+
+enum class ControlCommand {
+  // play or pause, argument 1 or 0.
+  kTransport,
+  kPlaybackRate,
+  kVolume,
+  // target in seconds.
+  kSeek,
+};
+
+// A queue holding the latest command of each kind, wait-free for its
+// consumers.
+//
+// Any thread may post, posting stores the argument and bumps the count of
+// the kind. Each kind has exactly one consumer, which takes the command at a
+// point of its choosing, the audio callback at the start of a buffer. A
+// command the consumer did not take yet is replaced by the next one of the
+// same kind, so the queue never fills up, e.g. while the mixer skips a paused
+// player, and only the latest rate or volume is applied.
+//
+// Each post is taken exactly once, a seek taken twice would seek twice. The
+// count of a kind is odd while a post writes its argument, the consumer only
+// takes an argument the count did not move around. Concurrent posts of one
+// kind wait for each other.
+class ControlQueue {
+
+ public:
+  ControlQueue();
+
+  // Any thread.
+  void Post(ControlCommand command, double argument);
+
+  // Consumer of |command| only. return true if |command| was posted since the
+  // last call, its latest argument is stored to |argument|.
+  bool Take(ControlCommand command, double *argument);
+
+  // Consumer of |command| only. count of |command| taken so far, comparable
+  // to PostedCount().
+  uint32_t TakenCount(ControlCommand command) const;
+
+  // Any thread.
+  uint32_t PostedCount(ControlCommand command) const;
+
+  // Any thread. argument of the latest |command|, |fallback| if none was
+  // posted.
+  double Argument(ControlCommand command, double fallback) const;
+
+ private:
+  static const int kCommandCount = int(ControlCommand::kSeek) + 1;
+
+  struct Slot {
+    std::atomic<double> argument;
+    // twice the count of posts, plus one while a post writes |argument|.
+    std::atomic<uint32_t> posted;
+    // |posted| as of the last take.
+    uint32_t taken;
+  };
+
+  Slot slots_[kCommandCount];
+
+};
+
+inline ControlQueue::ControlQueue() {
+  for (auto &slot : slots_) {
+    slot.argument.store(0, std::memory_order_relaxed);
+    slot.posted.store(0, std::memory_order_relaxed);
+    slot.taken = 0;
+  }
+}
+
+inline void ControlQueue::Post(ControlCommand command, double argument) {
+  auto &slot = slots_[int(command)];
+  auto posted = slot.posted.load(std::memory_order_relaxed);
+  do {
+    // another post of this kind is writing, posts are rare and short.
+    while (posted & 1) {
+      posted = slot.posted.load(std::memory_order_relaxed);
+    }
+  } while (!slot.posted.compare_exchange_weak(posted, posted + 1, std::memory_order_acquire,
+                                              std::memory_order_relaxed));
+  // release, a consumer that reads the new argument also sees the odd count.
+  slot.argument.store(argument, std::memory_order_release);
+  slot.posted.store(posted + 2, std::memory_order_release);
+}
+
+inline bool ControlQueue::Take(ControlCommand command, double *argument) {
+  auto &slot = slots_[int(command)];
+  auto posted = slot.posted.load(std::memory_order_acquire);
+  // nothing new, or a post is writing its argument right now, it is taken
+  // on the next call.
+  if (posted == slot.taken || (posted & 1)) {
+    return false;
+  }
+  // acquire, so the count is read again after the argument. a post started
+  // after |posted| may have replaced the argument already.
+  auto value = slot.argument.load(std::memory_order_acquire);
+  if (slot.posted.load(std::memory_order_relaxed) != posted) {
+    return false;
+  }
+  *argument = value;
+  slot.taken = posted;
+  return true;
+}
+
+inline uint32_t ControlQueue::TakenCount(ControlCommand command) const {
+  return slots_[int(command)].taken / 2;
+}
+
+inline uint32_t ControlQueue::PostedCount(ControlCommand command) const {
+  return slots_[int(command)].posted.load(std::memory_order_acquire) / 2;
+}
+
+inline double ControlQueue::Argument(ControlCommand command, double fallback) const {
+  const auto &slot = slots_[int(command)];
+  if (slot.posted.load(std::memory_order_acquire) < 2) {
+    return fallback;
+  }
+  return slot.argument.load(std::memory_order_relaxed);
+}
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__CONTROL_QUEUE_H_
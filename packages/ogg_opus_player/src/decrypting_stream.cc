@@ -0,0 +1,189 @@
+//
+// Decrypts an AES encrypted ogg opus stream while opusfile reads it.
+//
+
+#include "decrypting_stream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// opusfile reads up to 64 KiB at a time, a larger read returns early, which
+// also bounds |blocks_|.
+const int kMaxReadBytes = 64 * 1024;
+
+}
+
+DecryptingStream::DecryptingStream(std::unique_ptr<OggOpusStream> ciphertext, CipherMode mode,
+                                   const uint8_t *key, size_t key_length, const uint8_t *iv)
+    : ciphertext_(std::move(ciphertext)), mode_(mode) {
+  if (!ciphertext_ || !ciphertext_->IsSeekable()) {
+    return;
+  }
+  if (mode_ != CipherMode::kAesCtr && mode_ != CipherMode::kAesCbc) {
+    return;
+  }
+  if (!cipher_.SetKey(key, key_length)) {
+    return;
+  }
+  memcpy(iv_, iv, kBlockSize);
+
+  if (ciphertext_->Seek(0, SEEK_END) != 0) {
+    return;
+  }
+  auto ciphertext_size = ciphertext_->Tell();
+  ciphertext_position_ = ciphertext_size;
+  if (ciphertext_size < 0) {
+    return;
+  }
+  size_ = mode_ == CipherMode::kAesCtr ? ciphertext_size : UnpaddedSize(ciphertext_size);
+}
+
+DecryptingStream::~DecryptingStream() {
+  SecureZero(iv_, sizeof(iv_));
+  SecureZero(blocks_.data(), blocks_.size());
+}
+
+int DecryptingStream::Read(unsigned char *buffer, int size) {
+  auto count = int(std::min<int64_t>(std::min(size, kMaxReadBytes), size_ - position_));
+  if (count <= 0) {
+    return 0;
+  }
+
+  if (mode_ == CipherMode::kAesCtr) {
+    // the keystream does not depend on the ciphertext, it is decrypted in
+    // place.
+    if (!ReadCiphertext(position_, buffer, count)) {
+      return -1;
+    }
+    DecryptCtr(position_, buffer, count);
+  } else {
+    auto first = position_ / kBlockSize;
+    auto last = (position_ + count - 1) / kBlockSize;
+    if (!DecryptCbc(first, int(last - first + 1))) {
+      return -1;
+    }
+    auto *plaintext = blocks_.data() + kBlockSize + (position_ - first * kBlockSize);
+    memcpy(buffer, plaintext, size_t(count));
+    SecureZero(blocks_.data(), blocks_.size());
+  }
+  position_ += count;
+  return count;
+}
+
+int DecryptingStream::Seek(int64_t offset, int whence) {
+  int64_t base;
+  switch (whence) {
+    case SEEK_SET:
+      base = 0;
+      break;
+    case SEEK_CUR:
+      base = position_;
+      break;
+    case SEEK_END:
+      base = size_;
+      break;
+    default:
+      return -1;
+  }
+  auto position = base + offset;
+  if (position < 0) {
+    return -1;
+  }
+  // nothing is decrypted until the next Read(), any block is a valid start.
+  position_ = position;
+  return 0;
+}
+
+bool DecryptingStream::ReadCiphertext(int64_t offset, uint8_t *data, int size) {
+  if (ciphertext_position_ != offset) {
+    if (ciphertext_->Seek(offset, SEEK_SET) != 0) {
+      ciphertext_position_ = -1;
+      return false;
+    }
+    ciphertext_position_ = offset;
+  }
+  while (size > 0) {
+    auto read = ciphertext_->Read(data, size);
+    if (read <= 0) {
+      ciphertext_position_ = -1;
+      return false;
+    }
+    data += read;
+    size -= read;
+    ciphertext_position_ += read;
+  }
+  return true;
+}
+
+void DecryptingStream::DecryptCtr(int64_t offset, uint8_t *data, int size) {
+  uint8_t counter[kBlockSize];
+  uint8_t keystream[kBlockSize];
+  auto block = uint64_t(offset / kBlockSize);
+  auto skip = int(offset % kBlockSize);
+  while (size > 0) {
+    // the counter of |block| is |iv_| + |block| as a 128 bit big endian
+    // integer, the carry may run into the upper half.
+    unsigned carry = 0;
+    auto addend = block;
+    for (int i = kBlockSize - 1; i >= 0; --i) {
+      auto sum = unsigned(iv_[i]) + unsigned(addend & 0xff) + carry;
+      counter[i] = uint8_t(sum);
+      carry = sum >> 8;
+      addend >>= 8;
+    }
+    cipher_.EncryptBlock(counter, keystream);
+
+    auto count = std::min(size, kBlockSize - skip);
+    for (int i = 0; i < count; ++i) {
+      data[i] ^= keystream[skip + i];
+    }
+    data += count;
+    size -= count;
+    skip = 0;
+    ++block;
+  }
+  SecureZero(keystream, sizeof(keystream));
+}
+
+bool DecryptingStream::DecryptCbc(int64_t first, int count) {
+  blocks_.resize(size_t(count + 1) * kBlockSize);
+  auto *blocks = blocks_.data();
+  if (first == 0) {
+    memcpy(blocks, iv_, kBlockSize);
+    if (!ReadCiphertext(0, blocks + kBlockSize, count * kBlockSize)) {
+      return false;
+    }
+  } else if (!ReadCiphertext((first - 1) * kBlockSize, blocks, (count + 1) * kBlockSize)) {
+    return false;
+  }
+  // back to front, each block is xored with the ciphertext before it.
+  for (int i = count; i > 0; --i) {
+    auto *block = blocks + i * kBlockSize;
+    cipher_.DecryptBlock(block, block);
+    for (int j = 0; j < kBlockSize; ++j) {
+      block[j] ^= block[j - kBlockSize];
+    }
+  }
+  return true;
+}
+
+int64_t DecryptingStream::UnpaddedSize(int64_t ciphertext_size) {
+  if (ciphertext_size < kBlockSize || ciphertext_size % kBlockSize != 0) {
+    return -1;
+  }
+  if (!DecryptCbc(ciphertext_size / kBlockSize - 1, 1)) {
+    return -1;
+  }
+  // PKCS#7, 1 to kBlockSize bytes each holding the padding length.
+  auto *last = blocks_.data() + kBlockSize;
+  auto padding = int(last[kBlockSize - 1]);
+  auto valid = padding >= 1 && padding <= kBlockSize;
+  for (int i = kBlockSize - padding; valid && i < kBlockSize; ++i) {
+    valid = last[i] == padding;
+  }
+  SecureZero(blocks_.data(), blocks_.size());
+  return valid ? ciphertext_size - padding : -1;
+}
@@ -0,0 +1,79 @@
+//
+// Decrypts an AES encrypted ogg opus stream while opusfile reads it.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__DECRYPTING_STREAM_H_
+#define OGG_OPUS_PLAYER_LIBRARY__DECRYPTING_STREAM_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "aes_cipher.h"
+#include "ogg_opus_reader.h"
+
+// Values of OGG_OPUS_CIPHER_AES_CTR and OGG_OPUS_CIPHER_AES_CBC.
+enum class CipherMode {
+  // SP 800-38A counter mode, the iv is the initial 128 bit big endian
+  // counter, no padding.
+  kAesCtr = 0,
+  // SP 800-38A cipher block chaining with PKCS#7 padding.
+  kAesCbc = 1,
+};
+
+// Serves the plaintext of a seekable ciphertext stream. Only the blocks
+// opusfile asks for are decrypted, straight into its buffer, so seeking
+// costs at most one extra block and plaintext never reaches the disk.
+class DecryptingStream : public OggOpusStream {
+
+ public:
+  // |key| is 16, 24 or 32 bytes, |iv| kBlockSize bytes, both are copied.
+  DecryptingStream(std::unique_ptr<OggOpusStream> ciphertext, CipherMode mode,
+                   const uint8_t *key, size_t key_length, const uint8_t *iv);
+
+  ~DecryptingStream() override;
+
+  // false if the key, the mode or the ciphertext is invalid, e.g. a cbc
+  // stream with broken padding.
+  bool IsValid() const { return size_ >= 0; }
+
+  int Read(unsigned char *buffer, int size) override;
+
+  bool IsSeekable() const override { return true; }
+
+  int Seek(int64_t offset, int whence) override;
+
+  int64_t Tell() override { return position_; }
+
+ private:
+  static const int kBlockSize = AesCipher::kBlockSize;
+
+  std::unique_ptr<OggOpusStream> ciphertext_;
+  CipherMode mode_;
+  AesCipher cipher_;
+  uint8_t iv_[kBlockSize] = {};
+
+  // plaintext size, negative if invalid.
+  int64_t size_ = -1;
+  int64_t position_ = 0;
+  // read position of |ciphertext_|, sequential reads skip its Seek().
+  int64_t ciphertext_position_ = -1;
+
+  // cbc only, the ciphertext of one Read() and the block before it.
+  std::vector<uint8_t> blocks_;
+
+  // read exactly |size| ciphertext bytes at |offset|.
+  bool ReadCiphertext(int64_t offset, uint8_t *data, int size);
+
+  void DecryptCtr(int64_t offset, uint8_t *data, int size);
+
+  // decrypt the plaintext of ciphertext blocks [|first|, |first| + |count|)
+  // into |blocks_|, after the block before them.
+  bool DecryptCbc(int64_t first, int count);
+
+  // cbc only, the plaintext size once the padding is stripped.
+  int64_t UnpaddedSize(int64_t ciphertext_size);
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__DECRYPTING_STREAM_H_
@@ -0,0 +1,76 @@
+//
+// Posts periodic events to dart from one process wide helper thread.
+//
+
+#include "event_dispatcher.h"
+
+#include <algorithm>
+
+EventSource::~EventSource() = default;
+
+EventDispatcher *EventDispatcher::Instance() {
+  static auto *dispatcher = new EventDispatcher();
+  return dispatcher;
+}
+
+void EventDispatcher::SetInterval(EventSource *source, int interval_milliseconds) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(entries_.begin(), entries_.end(),
+                         [source](const Entry &entry) { return entry.source == source; });
+  if (interval_milliseconds <= 0) {
+    if (it != entries_.end()) {
+      entries_.erase(it);
+    }
+    return;
+  }
+  auto interval = std::chrono::milliseconds(interval_milliseconds);
+  auto deadline = std::chrono::steady_clock::now() + interval;
+  if (it != entries_.end()) {
+    it->interval = interval;
+    it->deadline = std::min(it->deadline, deadline);
+  } else {
+    entries_.push_back({source, interval, deadline});
+  }
+  if (!thread_.joinable()) {
+    // lives as long as the process, like the dispatcher itself.
+    thread_ = std::thread(&EventDispatcher::Run, this);
+  }
+  condition_.notify_one();
+}
+
+void EventDispatcher::Wake(EventSource *source) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &entry : entries_) {
+    if (entry.source == source) {
+      entry.deadline = std::chrono::steady_clock::now();
+      condition_.notify_one();
+      return;
+    }
+  }
+}
+
+void EventDispatcher::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    if (entries_.empty()) {
+      condition_.wait(lock);
+      continue;
+    }
+    auto now = std::chrono::steady_clock::now();
+    auto next_deadline = std::chrono::steady_clock::time_point::max();
+    for (auto &entry : entries_) {
+      if (entry.deadline <= now) {
+        entry.source->PostEvents();
+        // keep the cadence, but do not try to catch up after a stall.
+        entry.deadline += entry.interval;
+        if (entry.deadline <= now) {
+          entry.deadline = now + entry.interval;
+        }
+      }
+      next_deadline = std::min(next_deadline, entry.deadline);
+    }
+    if (next_deadline > now) {
+      condition_.wait_until(lock, next_deadline);
+    }
+  }
+}
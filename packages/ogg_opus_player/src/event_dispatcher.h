@@ -0,0 +1,102 @@
+//
+// Posts periodic events to dart from one process wide helper thread.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__EVENT_DISPATCHER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__EVENT_DISPATCHER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dart_api_dl.h"
+
+// Produces the events of one player or recorder, see EventDispatcher.
+class EventSource {
+ public:
+  virtual ~EventSource();
+
+  // Runs on the dispatcher thread, post whatever changed since the last call.
+  // Must not call back into the EventDispatcher.
+  virtual void PostEvents() = 0;
+};
+
+// Calls every registered EventSource at its own interval on one helper
+// thread, so posting to dart, which may allocate and lock, never happens on
+// the audio thread, and players need no timer thread of their own.
+class EventDispatcher {
+
+ public:
+  static EventDispatcher *Instance();
+
+  // Call |source| every |interval_milliseconds|, 0 removes it. Once this
+  // returns |source| is no longer called with the old interval, and never
+  // again after removing it.
+  void SetInterval(EventSource *source, int interval_milliseconds);
+
+  // Call |source| as soon as possible, e.g. after a state change. Does
+  // nothing if |source| is not registered.
+  void Wake(EventSource *source);
+
+ private:
+  EventDispatcher() = default;
+
+  struct Entry {
+    EventSource *source;
+    std::chrono::milliseconds interval;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  void Run();
+
+  // guards |entries_|, also held while a source posts, so removing a source
+  // waits for a PostEvents() in flight.
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::vector<Entry> entries_;
+  std::thread thread_;
+
+};
+
+// A flat list of numbers posted to dart as one Dart_CObject array, built on
+// the stack without allocations. Dart receives a List of int and double.
+template<int kCapacity>
+class DartNumberList {
+
+ public:
+  void AddInt(int64_t value) {
+    auto &object = Next();
+    object.type = Dart_CObject_kInt64;
+    object.value.as_int64 = value;
+  }
+
+  void AddDouble(double value) {
+    auto &object = Next();
+    object.type = Dart_CObject_kDouble;
+    object.value.as_double = value;
+  }
+
+  bool Post(Dart_Port_DL port) {
+    Dart_CObject message;
+    message.type = Dart_CObject_kArray;
+    message.value.as_array.length = length_;
+    message.value.as_array.values = items_;
+    return Dart_PostCObject_DL(port, &message);
+  }
+
+ private:
+  Dart_CObject values_[kCapacity];
+  Dart_CObject *items_[kCapacity];
+  int length_ = 0;
+
+  Dart_CObject &Next() {
+    items_[length_] = &values_[length_];
+    return values_[length_++];
+  }
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__EVENT_DISPATCHER_H_
@@ -0,0 +1,59 @@
+//
+// Identity of a file on disk, used to tell whether data derived from it is
+// still valid.
+//
+
+#include "file_identity.h"
+
+#include <vector>
+
+#if _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#if _WIN32
+
+bool GetFileIdentity(const char *file_path, FileIdentity *identity) {
+  auto length = MultiByteToWideChar(CP_UTF8, 0, file_path, -1, nullptr, 0);
+  if (length <= 0) {
+    return false;
+  }
+  std::vector<wchar_t> wide_path(size_t(length), 0);
+  MultiByteToWideChar(CP_UTF8, 0, file_path, -1, wide_path.data(), length);
+
+  WIN32_FILE_ATTRIBUTE_DATA attributes;
+  if (!GetFileAttributesExW(wide_path.data(), GetFileExInfoStandard, &attributes)
+      || (attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+    return false;
+  }
+  // 100ns intervals, the epoch does not matter for comparisons.
+  auto write_time = (int64_t(attributes.ftLastWriteTime.dwHighDateTime) << 32)
+      | attributes.ftLastWriteTime.dwLowDateTime;
+  identity->path = file_path;
+  identity->modified_at = write_time * 100;
+  identity->size = (int64_t(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+  return true;
+}
+
+#else
+
+bool GetFileIdentity(const char *file_path, FileIdentity *identity) {
+  struct stat status;
+  if (stat(file_path, &status) != 0 || !S_ISREG(status.st_mode)) {
+    return false;
+  }
+  identity->path = file_path;
+  identity->modified_at = int64_t(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+  identity->size = status.st_size;
+  return true;
+}
+
+#endif
@@ -0,0 +1,28 @@
+//
+// Identity of a file on disk, used to tell whether data derived from it is
+// still valid.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__FILE_IDENTITY_H_
+#define OGG_OPUS_PLAYER_LIBRARY__FILE_IDENTITY_H_
+
+#include <cstdint>
+#include <string>
+
+// A file on disk as it is now. A file rewritten in place gets a new
+// modification time or size, so data derived from the old file is dropped.
+struct FileIdentity {
+  std::string path;
+  // nanoseconds since the epoch.
+  int64_t modified_at = 0;
+  int64_t size = 0;
+
+  bool operator==(const FileIdentity &other) const {
+    return path == other.path && modified_at == other.modified_at && size == other.size;
+  }
+};
+
+// false if |file_path| does not exist or is not a regular file.
+bool GetFileIdentity(const char *file_path, FileIdentity *identity);
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__FILE_IDENTITY_H_
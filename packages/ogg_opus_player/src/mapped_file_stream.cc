@@ -0,0 +1,213 @@
+//
+// Files read by opusfile through op_open_callbacks, mapped into memory or
+// with stdio.
+//
+
+#include "mapped_file_stream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// prefetched after opening, a few seconds of typical voice and music
+// bitrates, and after a jump, one read of opusfile.
+const int64_t kPrefetchBytes = 256 * 1024;
+const int64_t kJumpPrefetchBytes = 64 * 1024;
+
+std::atomic<bool> mapping_enabled(false);
+
+}
+
+void MappedFileStream::SetEnabled(bool enabled) {
+  mapping_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool MappedFileStream::IsEnabled() {
+  return mapping_enabled.load(std::memory_order_relaxed);
+}
+
+#if _WIN32
+
+MappedFileStream::MappedFileStream(const char *file_path) {
+  // the path is utf-8, like everywhere else in the plugin.
+  auto length = MultiByteToWideChar(CP_UTF8, 0, file_path, -1, nullptr, 0);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<wchar_t> wide_path(size_t(length), 0);
+  MultiByteToWideChar(CP_UTF8, 0, file_path, -1, wide_path.data(), length);
+
+  auto file = CreateFileW(wide_path.data(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                          nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+    CloseHandle(file);
+    return;
+  }
+  // the mapping and its view keep the file open.
+  auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping) {
+    return;
+  }
+  auto *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data) {
+    CloseHandle(mapping);
+    return;
+  }
+  mapping_ = mapping;
+  data_ = static_cast<const unsigned char *>(data);
+  size_ = size.QuadPart;
+}
+
+MappedFileStream::~MappedFileStream() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_) {
+    CloseHandle(mapping_);
+  }
+}
+
+// FILE_FLAG_SEQUENTIAL_SCAN already asked for read-ahead.
+void MappedFileStream::Prefetch(int64_t /*offset*/, int64_t /*length*/) {
+}
+
+#else
+
+MappedFileStream::MappedFileStream(const char *file_path) {
+  auto fd = open(file_path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  struct stat status;
+  if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size <= 0) {
+    close(fd);
+    return;
+  }
+  // the mapping keeps the file open.
+  auto *data = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return;
+  }
+  data_ = static_cast<const unsigned char *>(data);
+  size_ = status.st_size;
+  madvise(data, size_t(size_), MADV_SEQUENTIAL);
+  Prefetch(0, kPrefetchBytes);
+}
+
+MappedFileStream::~MappedFileStream() {
+  if (data_) {
+    munmap(const_cast<unsigned char *>(data_), size_t(size_));
+  }
+}
+
+void MappedFileStream::Prefetch(int64_t offset, int64_t length) {
+  // madvise wants a page aligned address.
+  static const int64_t page_size = sysconf(_SC_PAGESIZE);
+  auto start = offset / page_size * page_size;
+  auto end = std::min(size_, offset + length);
+  if (start >= end) {
+    return;
+  }
+  madvise(const_cast<unsigned char *>(data_) + start, size_t(end - start), MADV_WILLNEED);
+}
+
+#endif
+
+int MappedFileStream::Read(unsigned char *buffer, int size) {
+  auto count = int(std::min<int64_t>(size, size_ - position_));
+  if (count <= 0) {
+    return 0;
+  }
+  memcpy(buffer, data_ + position_, size_t(count));
+  position_ += count;
+  return count;
+}
+
+int MappedFileStream::Seek(int64_t offset, int whence) {
+  int64_t base;
+  switch (whence) {
+    case SEEK_SET:
+      base = 0;
+      break;
+    case SEEK_CUR:
+      base = position_;
+      break;
+    case SEEK_END:
+      base = size_;
+      break;
+    default:
+      return -1;
+  }
+  auto position = base + offset;
+  if (position < 0) {
+    return -1;
+  }
+  // a seek or one of the bisection probes of opusfile, the sequential
+  // read-ahead does not cover it.
+  if (position < position_ || position - position_ > kJumpPrefetchBytes) {
+    Prefetch(position, kJumpPrefetchBytes);
+  }
+  position_ = position;
+  return 0;
+}
+
+FileStream::FileStream(const char *file_path) : file_callbacks_() {
+  file_ = op_fopen(&file_callbacks_, file_path, "rb");
+}
+
+FileStream::~FileStream() {
+  if (file_) {
+    file_callbacks_.close(file_);
+  }
+}
+
+int FileStream::Read(unsigned char *buffer, int size) {
+  return file_callbacks_.read(file_, buffer, size);
+}
+
+int FileStream::Seek(int64_t offset, int whence) {
+  return file_callbacks_.seek(file_, offset, whence);
+}
+
+int64_t FileStream::Tell() {
+  return file_callbacks_.tell(file_);
+}
+
+std::unique_ptr<OggOpusStream> OpenFileStream(const char *file_path) {
+  if (MappedFileStream::IsEnabled()) {
+    auto mapped = std::make_unique<MappedFileStream>(file_path);
+    if (mapped->IsMapped()) {
+      return mapped;
+    }
+  }
+  auto file = std::make_unique<FileStream>(file_path);
+  if (file->IsOpened()) {
+    return file;
+  }
+  return nullptr;
+}
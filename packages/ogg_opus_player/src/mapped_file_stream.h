@@ -0,0 +1,100 @@
+//
+// Files read by opusfile through op_open_callbacks, mapped into memory or
+// with stdio.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__MAPPED_FILE_STREAM_H_
+#define OGG_OPUS_PLAYER_LIBRARY__MAPPED_FILE_STREAM_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "ogg_opus_reader.h"
+
+// Maps a whole file read-only. Reads copy straight from the mapping, and
+// players of the same file share its pages in the page cache. The kernel is
+// told the file is read sequentially, and the pages a seek jumps to are
+// prefetched.
+//
+// The file must not be truncated while it is mapped, reading a page past
+// the new end raises SIGBUS and kills the process, e.g. a recorder writing
+// over a file that is still played. So files are only mapped once the app
+// opted in with SetEnabled(), see ogg_opus_player_set_memory_mapping.
+// Files that are still being written are played with GrowingFileStream.
+class MappedFileStream : public OggOpusStream {
+
+ public:
+  explicit MappedFileStream(const char *file_path);
+
+  // off by default, may be called from any thread. players created after
+  // the call use it.
+  static void SetEnabled(bool enabled);
+
+  static bool IsEnabled();
+
+  ~MappedFileStream() override;
+
+  MappedFileStream(const MappedFileStream &) = delete;
+  MappedFileStream &operator=(const MappedFileStream &) = delete;
+
+  // false if the file could not be opened or mapped, e.g. an empty file or
+  // a pipe.
+  bool IsMapped() const { return data_ != nullptr; }
+
+  int Read(unsigned char *buffer, int size) override;
+
+  bool IsSeekable() const override { return true; }
+
+  int Seek(int64_t offset, int whence) override;
+
+  int64_t Tell() override { return position_; }
+
+ private:
+  const unsigned char *data_ = nullptr;
+  int64_t size_ = 0;
+  int64_t position_ = 0;
+
+#if _WIN32
+  // the file mapping object, |data_| is a view of it.
+  void *mapping_ = nullptr;
+#endif
+
+  // hint that |length| bytes from |offset| on are read soon.
+  void Prefetch(int64_t offset, int64_t length);
+
+};
+
+// A file read with stdio, opened with op_fopen. Truncating the file while
+// it is read only ends the stream early.
+class FileStream : public OggOpusStream {
+
+ public:
+  explicit FileStream(const char *file_path);
+
+  ~FileStream() override;
+
+  FileStream(const FileStream &) = delete;
+  FileStream &operator=(const FileStream &) = delete;
+
+  // false if the file could not be opened.
+  bool IsOpened() const { return file_ != nullptr; }
+
+  int Read(unsigned char *buffer, int size) override;
+
+  bool IsSeekable() const override { return true; }
+
+  int Seek(int64_t offset, int whence) override;
+
+  int64_t Tell() override;
+
+ private:
+  void *file_ = nullptr;
+  OpusFileCallbacks file_callbacks_;
+
+};
+
+// open |file_path| mapped if MappedFileStream::IsEnabled() and it can be
+// mapped, with stdio otherwise. null if it can not be opened at all.
+std::unique_ptr<OggOpusStream> OpenFileStream(const char *file_path);
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__MAPPED_FILE_STREAM_H_
@@ -1,269 +1,1076 @@
 #include "ogg_opus_player.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
-#include <chrono>
 #include <cstring>
-
-#include "ogg/opus.h"
-#include "ogg/opusfile.h"
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "dart_api_dl.h"
 #include "SDL.h"
 
+#include "allocation_tracker.h"
+#include "audio_mixer.h"
+#include "control_queue.h"
+#include "decrypting_stream.h"
+#include "event_dispatcher.h"
+#include "mapped_file_stream.h"
+#include "ogg_opus_reader.h"
 #include "ogg_opus_utils.h"
+#include "pcm_cache.h"
+#include "playback_clock.h"
+#include "playback_context.h"
+#include "playback_stats.h"
+#include "progressive_stream.h"
+#include "seek_index.h"
 #include "sonic.h"
+#include "spsc_ring_buffer.h"
 
 //#define _OPUS_OGG_PLAYER_LOG
 
 namespace {
 
-class OggOpusReader {
-
- private:
-  const char *file_path_;
-  OggOpusFile *opus_file_;
+// Upper bound for the decoder thread to sleep when the ring buffer is full,
+// the audio callback wakes it up earlier once it consumed some data.
+const Uint32 kDecoderIdleWaitMilliseconds = 20;
 
-  bool ended_ = false;
+// Decoded tracks the audio callback did not reach yet, see |track_ends_|.
+const size_t kMaxPendingTracks = 16;
 
+class Player {
  public:
+  virtual void Play() = 0;
+  virtual void Pause() = 0;
 
-  explicit OggOpusReader(const char *file_path);
+  virtual ~Player();
+
+  virtual double CurrentTime() = 0;
+
+  virtual void SetPlaybackRate(double rate) = 0;
 
-  ~OggOpusReader();
+  virtual void Seek(double seconds) = 0;
 
-  int ReadPcmData(opus_int16 *data, int length);
+  virtual void SetVolume(double volume) = 0;
 
-  int GetChannelCount() const;
+  virtual void AppendData(const uint8_t *data, size_t length) = 0;
 
+  virtual void EndOfData() = 0;
+
+  virtual double StartupLatency() const = 0;
+
+  virtual void SetEventInterval(int milliseconds) = 0;
+
+  virtual void Enqueue(std::unique_ptr<OggOpusReader> reader) = 0;
+
+  virtual void GetStats(OggOpusPlayerStats *stats) = 0;
 };
 
-OggOpusReader::OggOpusReader(const char *file_path) : file_path_(file_path), opus_file_(nullptr) {
-  int result;
-  auto opus_file = op_open_file(file_path, &result);
-  if (result == 0 && opus_file) {
-    opus_file_ = opus_file;
-  } else {
-    std::cerr << "open opus file failed" << result << std::endl;
-  }
-}
+Player::~Player() = default;
 
-OggOpusReader::~OggOpusReader() {
-  if (opus_file_) {
-    op_free(opus_file_);
+enum DartPortMessage {
+  PLAYER_REACH_ENDED = 0,
+  // a progressive stream ran out of downloaded bytes during playback, and
+  // playback continued once more bytes arrived.
+  PLAYER_BUFFERING = 2,
+  PLAYER_BUFFERING_ENDED = 3
+};
+
+// First element of the number lists posted to dart, see
+// ogg_opus_player_set_event_interval.
+enum PlayerEventKind {
+  PLAYER_EVENT_PLAYBACK = 0,
+  PLAYER_EVENT_TRACK_CHANGED = 1,
+  // the player no longer reads from a source, e.g. a memory buffer handed
+  // over by dart can be freed. see ogg_opus_player_enqueue_memory.
+  PLAYER_EVENT_SOURCE_RELEASED = 2
+};
+
+enum PlayerEventState {
+  PLAYER_EVENT_STATE_PAUSED = 0,
+  PLAYER_EVENT_STATE_PLAYING = 1,
+  PLAYER_EVENT_STATE_BUFFERING = 2,
+  PLAYER_EVENT_STATE_ENDED = 3
+};
+
+// Largest absolute sample value of |count| samples.
+int32_t PeakAbs(const int16_t *samples, int count) {
+  int32_t peak = 0;
+  for (int i = 0; i < count; ++i) {
+    peak = std::max(peak, std::abs(int32_t(samples[i])));
   }
+  return peak;
 }
-int OggOpusReader::ReadPcmData(opus_int16 *data, int length) {
-  if (!opus_file_) {
-    return 0;
-  }
-  auto read = 0;
 
-  auto result = 1;
-  while ((result == OP_HOLE || result > 0) && read < length) {
-    result = op_read(opus_file_, data + read,
-                     length - read, nullptr);
-    if (result >= 0) {
-      read += result;
-    }
+// same as above, |samples| in [-1, 1] scaled to the int16 range.
+int32_t PeakAbs(const float *samples, int count) {
+  float peak = 0;
+  for (int i = 0; i < count; ++i) {
+    peak = std::max(peak, std::fabs(samples[i]));
   }
+  return int32_t(std::min(peak, 1.0f) * 32767);
+}
 
-  if (result < 0) {
-    return 0;
-  }
+// sonic read and write for both sample types.
+int SonicRead(sonicStream stream, opus_int16 *samples, int frames) {
+  return sonicReadShortFromStream(stream, samples, frames);
+}
 
-  if (result == 0) {
-    ended_ = true;
-  }
+int SonicRead(sonicStream stream, float *samples, int frames) {
+  return sonicReadFloatFromStream(stream, samples, frames);
+}
 
-  return read;
+void SonicWrite(sonicStream stream, opus_int16 *samples, int frames, int /*channels*/) {
+  sonicWriteShortToStream(stream, samples, frames);
 }
-int OggOpusReader::GetChannelCount() const {
-  if (!opus_file_) {
-    return 1;
+
+// sonic stores floats as int16 without clamping, opus may decode slightly
+// beyond full scale, which would wrap around.
+void SonicWrite(sonicStream stream, float *samples, int frames, int channels) {
+  for (int i = 0; i < frames * channels; ++i) {
+    samples[i] = std::min(1.0f, std::max(-1.0f, samples[i]));
   }
-  return op_channel_count(opus_file_, -1);
+  sonicWriteFloatToStream(stream, samples, frames);
 }
 
-class Player {
+// Forwards to the callbacks of ogg_opus_player_create_from_callbacks.
+class CallbacksStream : public OggOpusStream {
  public:
-  virtual void Play() = 0;
-  virtual void Pause() = 0;
+  CallbacksStream(const OggOpusPlayerCallbacks &callbacks, void *user_data)
+      : callbacks_(callbacks), user_data_(user_data) {}
 
-  virtual ~Player();
+  ~CallbacksStream() override {
+    if (callbacks_.close) {
+      callbacks_.close(user_data_);
+    }
+  }
 
-  virtual double CurrentTime() = 0;
+  int Read(unsigned char *buffer, int size) override {
+    return callbacks_.read(user_data_, buffer, size);
+  }
 
-  virtual void SetPlaybackRate(double rate) = 0;
-};
+  bool IsSeekable() const override {
+    return callbacks_.seek && callbacks_.tell;
+  }
 
-Player::~Player() = default;
+  int Seek(int64_t offset, int whence) override {
+    return callbacks_.seek(user_data_, offset, whence);
+  }
 
-enum DartPortMessage {
-  PLAYER_REACH_ENDED = 0
+  int64_t Tell() override {
+    return callbacks_.tell(user_data_);
+  }
+
+ private:
+  OggOpusPlayerCallbacks callbacks_;
+  void *user_data_;
 };
 
-class SdlOggOpusPlayer : public Player {
+// Map |frames| interleaved frames from |src_channels| to |dst_channels|.
+// mono is duplicated to every output channel, downmixing to mono averages.
+template<typename T>
+void ConvertChannels(const T *src, int src_channels,
+                     T *dst, int dst_channels, int frames) {
+  using Sum = typename std::conditional<std::is_floating_point<T>::value, T, int32_t>::type;
+  for (int i = 0; i < frames; ++i) {
+    const auto *in = src + i * src_channels;
+    auto *out = dst + i * dst_channels;
+    if (dst_channels == 1) {
+      Sum sum = 0;
+      for (int c = 0; c < src_channels; ++c) {
+        sum += in[c];
+      }
+      out[0] = T(sum / src_channels);
+      continue;
+    }
+    for (int c = 0; c < dst_channels; ++c) {
+      out[c] = src_channels == 1 ? in[0] : (c < src_channels ? in[c] : 0);
+    }
+  }
+}
+
+class SdlOggOpusPlayer : public Player, public AudioSource, public EventSource {
 
  public:
-  SdlOggOpusPlayer(const char *file_path, Dart_Port_DL send_port);
+  SdlOggOpusPlayer(std::unique_ptr<OggOpusReader> reader, Dart_Port_DL send_port);
+
+  // the reader is opened on the decoder thread once the first pages of
+  // |stream| arrived, playback stays silent until then.
+  SdlOggOpusPlayer(std::unique_ptr<ProgressiveStream> stream, Dart_Port_DL send_port);
+
   ~SdlOggOpusPlayer() override;
 
+  // attach to the mixer, then start the decoder thread. return -1 if the
+  // output can not be opened or every mixer slot is taken.
+  int Initialize();
+
   void Play() override;
   void Pause() override;
   double CurrentTime() override;
 
   void SetPlaybackRate(double rate) override;
 
+  void Seek(double seconds) override;
+
+  void SetVolume(double volume) override;
+
+  void AppendData(const uint8_t *data, size_t length) override;
+
+  void EndOfData() override;
+
+  void Render(int16_t *output, int frames, int channels) override;
+
+  void Render(float *output, int frames, int channels) override;
+
+  void PostEvents() override;
+
+  void SetEventInterval(int milliseconds) override;
+
+  void GetStats(OggOpusPlayerStats *stats) override;
+
+  void Enqueue(std::unique_ptr<OggOpusReader> reader) override;
+
+  // the create call started at |started_at| and returned now, performance
+  // counter values.
+  void MarkCreated(uint64_t started_at);
+
+  // seconds from the start of the create call to the first audio callback
+  // that rendered the player, negative if there was none yet.
+  double StartupLatency() const override;
+
  private:
   std::unique_ptr<OggOpusReader> reader_;
 
-  SDL_AudioDeviceID audio_device_id_ = -1;
+  // a progressive stream, opened by the decoder thread. the player owns it
+  // for its whole lifetime, the reader of the first track only borrows it,
+  // so appending still works once that track was played and dropped.
+  std::unique_ptr<ProgressiveStream> progressive_stream_;
+
+  // set once |context_| is attached, see OpenPipeline().
+  std::atomic<bool> ready_;
 
-  double current_time_ = 0;
+  // play, pause, rate, volume and seek posted by the control calls. the
+  // audio callback applies them at the start of a buffer, the seek is taken
+  // by the decoder thread, see |seek_handled_|.
+  ControlQueue controls_;
 
-  int64_t last_update_time_ = 0;
+  // slot in the shared AudioMixer, -1 if not attached.
+  int mixer_slot_ = -1;
 
-  bool paused_ = true;
+  int channels_ = 1;
+  int device_sample_rate_ = kOpusSampleRate;
+  // source frames per frame in the pcm buffer, which holds device rate pcm
+  // if the context resamples.
+  double source_frames_per_frame_ = 1;
+
+  // the state requested by Play() and Pause(), for the event stream.
+  std::atomic<bool> playing_;
+
+  PlaybackClock clock_;
+
+  // audio thread only. source frames handed to sonic, and the source frames
+  // sonic has turned into device frames so far.
+  double frames_fed_ = 0;
+  double frames_played_ = 0;
+  int64_t frames_published_ = 0;
 
   Dart_Port_DL dart_port_dl_;
 
-  sonicStream sonic_stream_;
+  // sonic and the pcm buffers, taken from the PlaybackContextPool.
+  std::unique_ptr<PlaybackContext> context_;
+
+  std::thread decoder_thread_;
+  SDL_sem *decoder_semaphore_ = nullptr;
+  std::atomic<bool> decoder_running_;
+  std::atomic<bool> decoder_ended_;
+
+  // set by the audio callback once all samples were played. the message to
+  // dart is posted from the decoder thread, posting may allocate.
+  std::atomic<bool> reach_ended_;
 
-  int Initialize();
+  // set by the audio callback when it ran out of pcm before the end of the
+  // stream, reported to dart by the decoder thread.
+  std::atomic<bool> starving_;
+  std::atomic<bool> buffering_;
+
+  // set by the decoder thread once the end of the stream was reported.
+  std::atomic<bool> ended_;
 
-  void ReadAudioData(uint16_t *stream, int len);
+  // published for the event stream. source frames the decoder thread has
+  // decoded, and the largest sample the audio callback rendered since the
+  // last event.
+  std::atomic<int64_t> decoded_position_;
+  std::atomic<int32_t> peak_;
+
+  // audio callback instrumentation, see ogg_opus_player_get_stats. the audio
+  // callback keeps the start of the previous render to measure the period.
+  PlaybackStats stats_;
+  uint64_t last_render_at_ = 0;
+
+  // gapless queue. readers waiting to be decoded, guarded by |queue_mutex_|.
+  std::mutex queue_mutex_;
+  std::deque<std::unique_ptr<OggOpusReader>> queued_readers_;
+
+  // decoder thread only. readers fully decoded whose audio is still playing,
+  // and the count of track ends written to |track_ends_| and reported to dart.
+  std::deque<std::unique_ptr<OggOpusReader>> played_readers_;
+  uint32_t tracks_written_ = 0;
+  uint32_t tracks_popped_ = 0;
+  int64_t track_index_ = 0;
+
+  // sources handed to the player, the one it was created with and each
+  // enqueued track, guarded by |queue_mutex_|. sources are released in that
+  // order, |sources_released_| is the decoder thread's count.
+  int64_t sources_ = 1;
+  int64_t sources_released_ = 0;
+
+  // end of each decoded track in source frames, written by the decoder
+  // thread in order. the audio callback bumps |tracks_applied_| once the
+  // track ended, |pending_track_end_| is the end it waits for, -1 if none.
+  SpscRingBuffer<int64_t> track_ends_;
+  std::atomic<uint32_t> tracks_applied_;
+  int64_t pending_track_end_ = -1;
+
+  // event dispatcher thread only, skips events while nothing changes.
+  int last_event_state_ = -1;
+  double last_event_position_ = -1;
+
+  // startup instrumentation, see ogg_opus_player_set_startup_hook.
+  uint64_t create_started_at_ = 0;
+  uint64_t create_finished_at_ = 0;
+  std::atomic<uint64_t> first_callback_at_;
+  bool startup_reported_ = false;
+
+  bool sonic_flushed_ = false;
+
+  // seek handshake. the caller posts ControlCommand::kSeek, the decoder
+  // thread takes it, seeks the reader, remembers where the new pcm starts in
+  // the pcm buffer and bumps |seek_decoded_|. the audio callback then drops
+  // the stale pcm, flushes sonic and resets the clock in one go, and bumps
+  // |seek_applied_|. |seek_handled_| is the count of seeks the decoder thread
+  // took, stored even if the seek failed.
+  std::atomic<uint32_t> seek_handled_;
+  std::atomic<int64_t> seek_position_;
+  std::atomic<size_t> seek_buffer_position_;
+  std::atomic<uint32_t> seek_decoded_;
+  std::atomic<uint32_t> seek_applied_;
+  // drop the track ends written before the seek, too.
+  std::atomic<size_t> seek_track_ends_position_;
+  std::atomic<uint32_t> seek_tracks_written_;
+
+  explicit SdlOggOpusPlayer(Dart_Port_DL send_port);
+
+  void OpenPipeline();
+
+  void UpdateBufferingState();
+
+  void ReportStartupLatency();
+
+  void ApplyCommands();
+
+  // the int16 or float pipeline, whichever the mixer runs with.
+  template<typename T>
+  void RenderPcm(T *output, int frames, int channels);
+
+  // return true if it ran out of decoded pcm.
+  template<typename T>
+  bool ReadAudioData(T *stream, int frames);
+
+  void DecodeLoop();
+
+  void ApplySeek(uint64_t now);
+
+  template<typename T>
+  int DecodeChunk();
+
+  template<typename T>
+  void FlushResampler();
+
+  bool HasQueuedTrack();
+
+  bool SwitchToNextTrack();
+
+  void PopPlayedTracks();
+
+  void PostSourceReleased();
+
+  void HandleSeek(int64_t target, uint32_t seek_handled);
+
+  void ApplyTrackTransitions(uint64_t now);
 
 };
 
-SdlOggOpusPlayer::SdlOggOpusPlayer(const char *file_path, Dart_Port_DL send_port)
-    : reader_(std::make_unique<OggOpusReader>(file_path)),
+SdlOggOpusPlayer::SdlOggOpusPlayer(Dart_Port_DL send_port)
+    : ready_(false),
+      playing_(false),
       dart_port_dl_(send_port),
-      sonic_stream_(nullptr) {
+      decoder_running_(false),
+      decoder_ended_(false),
+      reach_ended_(false),
+      starving_(false),
+      buffering_(false),
+      ended_(false),
+      decoded_position_(0),
+      peak_(0),
+      track_ends_(kMaxPendingTracks),
+      tracks_applied_(0),
+      first_callback_at_(0),
+      seek_handled_(0),
+      seek_position_(0),
+      seek_buffer_position_(0),
+      seek_decoded_(0),
+      seek_applied_(0),
+      seek_track_ends_position_(0),
+      seek_tracks_written_(0) {
 #ifdef _OPUS_OGG_PLAYER_LOG
-  std::cout << "SdlOggOpusPlayer: " << file_path << " port: " << send_port << std::endl;
+  std::cout << "SdlOggOpusPlayer: port: " << send_port << std::endl;
 #endif
-  Initialize();
 }
 
+SdlOggOpusPlayer::SdlOggOpusPlayer(std::unique_ptr<OggOpusReader> reader, Dart_Port_DL send_port)
+    : SdlOggOpusPlayer(send_port) {
+  reader_ = std::move(reader);
+}
+
+SdlOggOpusPlayer::SdlOggOpusPlayer(std::unique_ptr<ProgressiveStream> stream, Dart_Port_DL send_port)
+    : SdlOggOpusPlayer(send_port) {
+  progressive_stream_ = std::move(stream);
+  progressive_stream_->SetWaitingCallback([this]() { UpdateBufferingState(); });
+}
+
+// The mixer samples the playing flag of the slot once per buffer, so play
+// and pause take effect on a buffer boundary. The clock of a paused player
+// stops at the end of the last buffer it rendered.
 void SdlOggOpusPlayer::Play() {
-  if (audio_device_id_ > 0) {
-    paused_ = false;
-    SDL_PauseAudioDevice(audio_device_id_, 0);
+  if (mixer_slot_ >= 0) {
+    controls_.Post(ControlCommand::kTransport, 1);
+    playing_.store(true, std::memory_order_release);
+    AudioMixer::Instance()->SetPlaying(mixer_slot_, true);
+    EventDispatcher::Instance()->Wake(this);
   }
 }
 void SdlOggOpusPlayer::Pause() {
-  if (audio_device_id_ > 0) {
-    SDL_PauseAudioDevice(audio_device_id_, 1);
-    paused_ = true;
-    auto offset = std::chrono::system_clock::now().time_since_epoch().count() - last_update_time_;
-    current_time_ += double(offset) / 1000000000.0;
-    last_update_time_ = 0;
+  if (mixer_slot_ >= 0) {
+    controls_.Post(ControlCommand::kTransport, 0);
+    AudioMixer::Instance()->SetPlaying(mixer_slot_, false);
+    playing_.store(false, std::memory_order_release);
+    EventDispatcher::Instance()->Wake(this);
+  }
+}
+
+void SdlOggOpusPlayer::SetVolume(double volume) {
+  controls_.Post(ControlCommand::kVolume, volume);
+}
+
+void SdlOggOpusPlayer::AppendData(const uint8_t *data, size_t length) {
+  if (progressive_stream_) {
+    progressive_stream_->Append(data, length);
+  }
+}
+
+void SdlOggOpusPlayer::EndOfData() {
+  if (progressive_stream_) {
+    progressive_stream_->Finish();
   }
 }
 
-void SdlOggOpusPlayer::ReadAudioData(uint16_t *stream, int len) {
-  if (!sonic_stream_) {
-    memset(stream, 0, len * sizeof(uint16_t));
+// Runs on the audio thread, called by the mixer.
+void SdlOggOpusPlayer::Render(int16_t *output, int frames, int channels) {
+  RenderPcm(output, frames, channels);
+}
+
+void SdlOggOpusPlayer::Render(float *output, int frames, int channels) {
+  RenderPcm(output, frames, channels);
+}
+
+// Runs on the audio thread at the start of every buffer the player renders,
+// applies the commands posted since the previous one.
+void SdlOggOpusPlayer::ApplyCommands() {
+  double argument;
+  if (controls_.Take(ControlCommand::kTransport, &argument)) {
+    // playback (re)started, the pause in between is no callback period.
+    last_render_at_ = 0;
+  }
+  if (controls_.Take(ControlCommand::kVolume, &argument)) {
+    // the mixer reads the gain after the render, it applies to this buffer.
+    AudioMixer::Instance()->SetGain(mixer_slot_, float(argument));
+  }
+  // sonic is attached once the pipeline is ready, OpenPipeline() sets the
+  // rate posted before.
+  if (ready_.load(std::memory_order_acquire) && controls_.Take(ControlCommand::kPlaybackRate, &argument)) {
+    sonicSetSpeed(context_->sonic_stream, float(argument));
+  }
+}
+
+template<typename T>
+void SdlOggOpusPlayer::RenderPcm(T *output, int frames, int channels) {
+  ApplyCommands();
+  if (!ready_.load(std::memory_order_acquire)) {
+    memset(output, 0, frames * channels * sizeof(T));
+    starving_.store(true, std::memory_order_relaxed);
+    return;
+  }
+  auto started_at = SDL_GetPerformanceCounter();
+  if (first_callback_at_.load(std::memory_order_relaxed) == 0) {
+    first_callback_at_.store(started_at, std::memory_order_release);
+  }
+  auto &buffers = context_->Buffers<T>();
+  auto starving = false;
+  if (channels == channels_) {
+    starving = ReadAudioData(output, frames);
+  } else {
+    auto buffer_frames = int(buffers.render_buffer.size()) / channels_;
+    for (int offset = 0; offset < frames; offset += buffer_frames) {
+      auto count = std::min(buffer_frames, frames - offset);
+      starving |= ReadAudioData(buffers.render_buffer.data(), count);
+      ConvertChannels(buffers.render_buffer.data(), channels_, output + offset * channels, channels, count);
+    }
+  }
+  auto peak = PeakAbs(output, frames * channels);
+  if (peak > peak_.load(std::memory_order_relaxed)) {
+    peak_.store(peak, std::memory_order_relaxed);
+  }
+
+  auto finished_at = SDL_GetPerformanceCounter();
+  auto ticks_per_microsecond = double(SDL_GetPerformanceFrequency()) / 1e6;
+  auto period = last_render_at_ > 0 ? double(started_at - last_render_at_) / ticks_per_microsecond : -1;
+  last_render_at_ = started_at;
+  // the deadline is the end of the whole device buffer, which the mixer may
+  // render in several chunks.
+  auto *mixer = AudioMixer::Instance();
+  auto budget = 1e6 * mixer->callback_frames() / device_sample_rate_;
+  auto since_callback = double(finished_at - mixer->callback_started_at()) / ticks_per_microsecond;
+  auto fill = 1e3 * double(buffers.pcm_buffer.ReadAvailable() / channels_) / device_sample_rate_;
+  stats_.RecordCallback(double(finished_at - started_at) / ticks_per_microsecond, period, budget - since_callback, fill);
+  if (starving) {
+    stats_.RecordUnderrun();
+  }
+}
+
+void SdlOggOpusPlayer::Enqueue(std::unique_ptr<OggOpusReader> reader) {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    queued_readers_.push_back(std::move(reader));
+    sources_++;
+  }
+  SDL_SemPost(decoder_semaphore_);
+}
+
+void SdlOggOpusPlayer::SetEventInterval(int milliseconds) {
+  EventDispatcher::Instance()->SetInterval(this, milliseconds);
+}
+
+void SdlOggOpusPlayer::GetStats(OggOpusPlayerStats *stats) {
+  double capacity = 0;
+  if (ready_.load(std::memory_order_acquire)) {
+    capacity = 1e3 * double(context_->PcmCapacity() / channels_) / device_sample_rate_;
+  }
+  stats_.Snapshot(stats, capacity);
+  auto cache = PcmCache::Instance()->Stats();
+  stats->pcm_cache_hits = cache.hits;
+  stats->pcm_cache_misses = cache.misses;
+  stats->pcm_cache_evictions = cache.evictions;
+  stats->pcm_cache_bytes = cache.bytes;
+  stats->pcm_cache_capacity_bytes = cache.capacity_bytes;
+}
+
+// Runs on the event dispatcher thread.
+void SdlOggOpusPlayer::PostEvents() {
+  int state = PLAYER_EVENT_STATE_PAUSED;
+  if (ended_.load(std::memory_order_acquire)) {
+    state = PLAYER_EVENT_STATE_ENDED;
+  } else if (playing_.load(std::memory_order_acquire)) {
+    state = buffering_.load(std::memory_order_relaxed)
+            ? PLAYER_EVENT_STATE_BUFFERING : PLAYER_EVENT_STATE_PLAYING;
+  }
+  auto position = CurrentTime();
+  auto moving = state == PLAYER_EVENT_STATE_PLAYING || state == PLAYER_EVENT_STATE_BUFFERING;
+  if (!moving && state == last_event_state_ && position == last_event_position_) {
+    return;
+  }
+  last_event_state_ = state;
+  last_event_position_ = position;
+
+  auto *mixer = AudioMixer::Instance();
+  DartNumberList<8> event;
+  event.AddInt(PLAYER_EVENT_PLAYBACK);
+  event.AddDouble(position);
+  event.AddDouble(double(decoded_position_.load(std::memory_order_relaxed)) / kOpusSampleRate);
+  event.AddDouble(double(peak_.exchange(0, std::memory_order_relaxed)) / 32768.0);
+  event.AddInt(stats_.underruns());
+  event.AddInt(state);
+  event.AddInt(mixer->device_buffer_frames());
+  event.AddDouble(mixer->device_latency());
+  event.Post(dart_port_dl_);
+}
+
+// Decoder thread, posts the buffering messages of progressive streams. Also
+// called while the stream waits for more bytes.
+void SdlOggOpusPlayer::UpdateBufferingState() {
+  if (!progressive_stream_) {
     return;
   }
+  auto starving = starving_.load(std::memory_order_relaxed) && playing_.load(std::memory_order_acquire);
+  if (starving != buffering_.load(std::memory_order_relaxed)) {
+    buffering_.store(starving, std::memory_order_relaxed);
+    Dart_PostInteger_DL(dart_port_dl_, starving ? PLAYER_BUFFERING : PLAYER_BUFFERING_ENDED);
+    EventDispatcher::Instance()->Wake(this);
+  }
+}
+
+std::atomic<ogg_opus_player_startup_hook> startup_hook(nullptr);
+
+int64_t TicksToMicroseconds(uint64_t ticks) {
+  return int64_t(double(ticks) * 1000000.0 / double(SDL_GetPerformanceFrequency()));
+}
+
+void SdlOggOpusPlayer::MarkCreated(uint64_t started_at) {
+  create_started_at_ = started_at;
+  create_finished_at_ = SDL_GetPerformanceCounter();
+}
+
+double SdlOggOpusPlayer::StartupLatency() const {
+  auto first_callback_at = first_callback_at_.load(std::memory_order_acquire);
+  if (first_callback_at == 0) {
+    return -1;
+  }
+  return double(first_callback_at - create_started_at_) / double(SDL_GetPerformanceFrequency());
+}
+
+// Decoder thread, calls the startup hook once after the first callback.
+void SdlOggOpusPlayer::ReportStartupLatency() {
+  if (startup_reported_) {
+    return;
+  }
+  auto first_callback_at = first_callback_at_.load(std::memory_order_acquire);
+  if (first_callback_at == 0) {
+    return;
+  }
+  startup_reported_ = true;
+  auto hook = startup_hook.load(std::memory_order_acquire);
+  if (hook) {
+    Player *player = this;
+    hook(player, TicksToMicroseconds(create_finished_at_ - create_started_at_),
+         TicksToMicroseconds(first_callback_at - create_started_at_));
+  }
+}
+
+void SdlOggOpusPlayer::DecodeLoop() {
+  if (!reader_) {
+    // blocks until the stream headers arrived.
+    reader_ = std::make_unique<OggOpusReader>(std::make_unique<BorrowedStream>(progressive_stream_.get()));
+    OpenPipeline();
+  }
+  while (decoder_running_.load(std::memory_order_acquire)) {
+    double seek_target;
+    if (controls_.Take(ControlCommand::kSeek, &seek_target)) {
+      HandleSeek(int64_t(seek_target * kOpusSampleRate), controls_.TakenCount(ControlCommand::kSeek));
+    }
+    PopPlayedTracks();
+    UpdateBufferingState();
+    ReportStartupLatency();
+    if (decoder_ended_.load(std::memory_order_relaxed)) {
+      if (HasQueuedTrack()) {
+        // a track was queued after the last one was decoded, continue with it.
+        ended_.store(false, std::memory_order_release);
+        decoder_ended_.store(false, std::memory_order_release);
+        continue;
+      }
+      // do not report the end of the stream before a pending seek reached
+      // the audio callback.
+      if (!ended_.load(std::memory_order_relaxed) && reach_ended_.load(std::memory_order_acquire)
+          && seek_applied_.load(std::memory_order_acquire) == seek_decoded_.load(std::memory_order_relaxed)) {
+        ended_.store(true, std::memory_order_release);
+        Dart_PostInteger_DL(dart_port_dl_, PLAYER_REACH_ENDED);
+        EventDispatcher::Instance()->Wake(this);
+      }
+      SDL_SemWaitTimeout(decoder_semaphore_, kDecoderIdleWaitMilliseconds);
+      continue;
+    }
+    auto frames = context_->IsFloat() ? DecodeChunk<float>() : DecodeChunk<opus_int16>();
+    if (frames < 0) {
+      SDL_SemWaitTimeout(decoder_semaphore_, kDecoderIdleWaitMilliseconds);
+      continue;
+    }
+    if (frames > 0) {
+      decoded_position_.fetch_add(frames, std::memory_order_relaxed);
+    } else if (!SwitchToNextTrack()) {
+      if (context_->IsFloat()) {
+        FlushResampler<float>();
+      } else {
+        FlushResampler<opus_int16>();
+      }
+      decoder_ended_.store(true, std::memory_order_release);
+    }
+  }
+}
+
+// Decoder thread. Decode up to kDecodeChunkFrames frames of |reader_| into
+// the pcm buffer, converted to the channel count and the sample rate of the
+// pipeline, which was set up for the first track. return the count of source
+// frames decoded, -1 if the pcm buffer is full.
+template<typename T>
+int SdlOggOpusPlayer::DecodeChunk() {
+  auto &buffers = context_->Buffers<T>();
+  if (buffers.pcm_buffer.WriteSpace() < std::max(buffers.decode_buffer.size(), buffers.resample_buffer.size())) {
+    return -1;
+  }
+  auto reader_channels = reader_->GetChannelCount();
+  int frames;
+  if (reader_channels == channels_) {
+    frames = reader_->ReadPcmData(buffers.decode_buffer.data(), kDecodeChunkFrames);
+  } else {
+    // not the audio thread, allocating here is fine.
+    buffers.track_buffer.resize(kDecodeChunkFrames * reader_channels);
+    frames = reader_->ReadPcmData(buffers.track_buffer.data(), kDecodeChunkFrames);
+    ConvertChannels(buffers.track_buffer.data(), reader_channels, buffers.decode_buffer.data(), channels_, frames);
+  }
+  if (context_->resampler) {
+    auto resampled = context_->resampler->Process(buffers.decode_buffer.data(), frames, buffers.resample_buffer.data());
+    buffers.pcm_buffer.Write(buffers.resample_buffer.data(), resampled * channels_);
+  } else {
+    buffers.pcm_buffer.Write(buffers.decode_buffer.data(), frames * channels_);
+  }
+  return frames;
+}
+
+// Decoder thread. The last track is fully decoded, write the frames the
+// resampler still holds back. DecodeChunk() checked for room just before.
+template<typename T>
+void SdlOggOpusPlayer::FlushResampler() {
+  if (!context_->resampler) {
+    return;
+  }
+  auto &buffers = context_->Buffers<T>();
+  auto frames = context_->resampler->Flush(buffers.resample_buffer.data());
+  buffers.pcm_buffer.Write(buffers.resample_buffer.data(), frames * channels_);
+}
+
+bool SdlOggOpusPlayer::HasQueuedTrack() {
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  return !queued_readers_.empty();
+}
+
+// Decoder thread. |reader_| is fully decoded, continue with the next queued
+// track in the same pcm buffer, so the audio callback plays both without a
+// gap. The audio callback learns where the track ends from |track_ends_|.
+bool SdlOggOpusPlayer::SwitchToNextTrack() {
+  if (track_ends_.WriteSpace() == 0) {
+    // many tiny tracks pending, try again once the audio callback caught up.
+    return true;
+  }
+  std::unique_ptr<OggOpusReader> next;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (queued_readers_.empty()) {
+      return false;
+    }
+    next = std::move(queued_readers_.front());
+    queued_readers_.pop_front();
+  }
+  auto track_end = decoded_position_.load(std::memory_order_relaxed);
+  track_ends_.Write(&track_end, 1);
+  tracks_written_++;
+  // keep the reader until its audio was played, a seek might still need it.
+  played_readers_.push_back(std::move(reader_));
+  reader_ = std::move(next);
+  decoded_position_.store(0, std::memory_order_relaxed);
+  return true;
+}
+
+// Decoder thread. Drop the readers of tracks the audio callback finished
+// and report each transition to dart.
+void SdlOggOpusPlayer::PopPlayedTracks() {
+  auto tracks_applied = tracks_applied_.load(std::memory_order_acquire);
+  while (tracks_popped_ != tracks_applied) {
+    tracks_popped_++;
+    if (!played_readers_.empty()) {
+      played_readers_.pop_front();
+      PostSourceReleased();
+    }
+    track_index_++;
+    // tracks after the one that is playing now: the rest of the decoded
+    // tracks, the one being decoded if another one plays, and the queue.
+    size_t queued;
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      queued = queued_readers_.size() + played_readers_.size();
+    }
+    DartNumberList<3> event;
+    event.AddInt(PLAYER_EVENT_TRACK_CHANGED);
+    event.AddInt(track_index_);
+    event.AddInt(int64_t(queued));
+    event.Post(dart_port_dl_);
+  }
+}
+
+// Decoder thread, or the destructor once the thread exited. Readers are
+// destroyed in the order their sources were handed over.
+void SdlOggOpusPlayer::PostSourceReleased() {
+  DartNumberList<2> event;
+  event.AddInt(PLAYER_EVENT_SOURCE_RELEASED);
+  event.AddInt(sources_released_++);
+  event.Post(dart_port_dl_);
+}
+
+// Decoder thread. Seek in the track that is playing. Tracks after it that
+// were already decoded ahead go back to the front of the queue.
+void SdlOggOpusPlayer::HandleSeek(int64_t target, uint32_t seek_handled) {
+  PopPlayedTracks();
+  if (!played_readers_.empty()) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    played_readers_.push_back(std::move(reader_));
+    while (played_readers_.size() > 1) {
+      auto &track = played_readers_.back();
+      track->Seek(0);
+      queued_readers_.push_front(std::move(track));
+      played_readers_.pop_back();
+    }
+    reader_ = std::move(played_readers_.front());
+    played_readers_.clear();
+  }
+  auto position = reader_->Seek(target);
+  if (position >= 0) {
+    if (context_->resampler) {
+      context_->resampler->Reset();
+    }
+    ended_.store(false, std::memory_order_release);
+    decoder_ended_.store(false, std::memory_order_relaxed);
+    decoded_position_.store(position, std::memory_order_relaxed);
+    tracks_popped_ = tracks_written_;
+    seek_position_.store(position, std::memory_order_relaxed);
+    seek_buffer_position_.store(context_->PcmWritePosition(), std::memory_order_relaxed);
+    seek_track_ends_position_.store(track_ends_.WritePosition(), std::memory_order_relaxed);
+    seek_tracks_written_.store(tracks_written_, std::memory_order_relaxed);
+    seek_decoded_.store(seek_handled, std::memory_order_release);
+  }
+  seek_handled_.store(seek_handled, std::memory_order_release);
+}
+
+// Runs on the audio thread, must not block on decoding or file io,
+// and must not allocate.
+template<typename T>
+bool SdlOggOpusPlayer::ReadAudioData(T *stream, int frames) {
+  auto &buffers = context_->Buffers<T>();
+
+  auto now = SDL_GetPerformanceCounter();
+  if (seek_decoded_.load(std::memory_order_acquire) != seek_applied_.load(std::memory_order_relaxed)) {
+    ApplySeek(now);
+  }
 
   auto read = 0;
-  auto pcm_read = 0;
-  while (read < len) {
-    auto result = sonicReadShortFromStream(
-        sonic_stream_, reinterpret_cast<short *>(stream + read),
-        len - read
-    );
+  while (read < frames) {
+    auto result = SonicRead(context_->sonic_stream, stream + read * channels_, frames - read);
     if (result > 0) {
       read += result;
-    } else if (result == 0) {
-      auto buffer = static_cast<opus_int16 *>(malloc(len * sizeof(opus_int16)));
-      auto data = reader_->ReadPcmData(buffer, 500);
-      if (data > 0) {
-        sonicWriteShortToStream(sonic_stream_, buffer, data);
-        pcm_read += data;
-      } else {
-        break;
+      continue;
+    }
+    auto available = buffers.pcm_buffer.ReadAvailable() / channels_ * channels_;
+    if (available > 0) {
+      auto samples = buffers.pcm_buffer.Read(buffers.callback_buffer.data(),
+                                             std::min(available, buffers.callback_buffer.size()));
+      SDL_SemPost(decoder_semaphore_);
+      SonicWrite(context_->sonic_stream, buffers.callback_buffer.data(), int(samples) / channels_, channels_);
+      frames_fed_ += double(samples / channels_) * source_frames_per_frame_;
+      // a track queued after the end was reached.
+      sonic_flushed_ = false;
+    } else if (decoder_ended_.load(std::memory_order_acquire) && !sonic_flushed_) {
+      // check the ring buffer again, the decoder might have written its last chunk
+      // between the read above and the ended flag.
+      if (buffers.pcm_buffer.ReadAvailable() > 0) {
+        continue;
       }
-      free(buffer);
+      sonicFlushStream(context_->sonic_stream);
+      sonic_flushed_ = true;
+    } else {
+      // decoder underrun or end of stream.
+      break;
     }
   }
 
-  current_time_ = current_time_ + pcm_read / 48000.0;
-  last_update_time_ = std::chrono::system_clock::now().time_since_epoch().count();
-  if (read <= 0) {
-    Dart_PostInteger_DL(dart_port_dl_, PLAYER_REACH_ENDED);
+  if (read < frames) {
+    memset(stream + read * channels_, 0, (frames - read) * channels_ * sizeof(T));
+  }
+  auto starving = read < frames && !sonic_flushed_;
+  starving_.store(starving, std::memory_order_relaxed);
+
+  // sonic consumes |speed| source frames for every frame it outputs. it can
+  // never have played more than it was fed, and once flushed everything fed
+  // has been played.
+  frames_played_ += read * double(sonicGetSpeed(context_->sonic_stream)) * source_frames_per_frame_;
+  if (frames_played_ > frames_fed_ || (sonic_flushed_ && read < frames)) {
+    frames_played_ = frames_fed_;
+  }
+  ApplyTrackTransitions(now);
+  auto played = int64_t(frames_played_);
+  clock_.Advance(played - frames_published_, now,
+                 SDL_GetPerformanceFrequency() * read / device_sample_rate_);
+  frames_published_ = played;
+
+  if (read <= 0 && sonic_flushed_ && !reach_ended_.load(std::memory_order_relaxed)) {
+    reach_ended_.store(true, std::memory_order_release);
+    SDL_SemPost(decoder_semaphore_);
+  } else if (read > 0 && reach_ended_.load(std::memory_order_relaxed)) {
+    reach_ended_.store(false, std::memory_order_relaxed);
+  }
+  return starving;
+}
+
+// Runs on the audio thread. Once the last frame of a track was played,
+// rebase the position on the start of the next track. Its first frames
+// already went through sonic right after the last frames of the previous
+// track, so the switch is sample accurate.
+void SdlOggOpusPlayer::ApplyTrackTransitions(uint64_t now) {
+  while (true) {
+    if (pending_track_end_ < 0 && track_ends_.Read(&pending_track_end_, 1) == 0) {
+      pending_track_end_ = -1;
+      return;
+    }
+    if (frames_played_ < double(pending_track_end_)) {
+      return;
+    }
+    frames_fed_ -= pending_track_end_;
+    frames_played_ -= double(pending_track_end_);
+    frames_published_ = 0;
+    clock_.Reset(0, now);
+    pending_track_end_ = -1;
+    tracks_applied_.fetch_add(1, std::memory_order_release);
+    SDL_SemPost(decoder_semaphore_);
   }
 }
 
+// Runs on the audio thread, drops everything decoded before the seek.
+void SdlOggOpusPlayer::ApplySeek(uint64_t now) {
+  auto seek_decoded = seek_decoded_.load(std::memory_order_acquire);
+  context_->DiscardPcmUntil(seek_buffer_position_.load(std::memory_order_relaxed));
+  auto position = seek_position_.load(std::memory_order_relaxed);
+
+  context_->DrainSonicStream();
+  sonic_flushed_ = false;
+
+  frames_fed_ = position;
+  frames_played_ = double(position);
+  frames_published_ = position;
+  clock_.Reset(position, now);
+
+  track_ends_.DiscardUntil(seek_track_ends_position_.load(std::memory_order_relaxed));
+  pending_track_end_ = -1;
+  tracks_applied_.store(seek_tracks_written_.load(std::memory_order_relaxed), std::memory_order_release);
+
+  reach_ended_.store(false, std::memory_order_relaxed);
+  seek_applied_.store(seek_decoded, std::memory_order_release);
+  SDL_SemPost(decoder_semaphore_);
+}
+
 bool global_init = false;
 
 int SdlOggOpusPlayer::Initialize() {
-  global_init_sdl2();
-
-  SDL_AudioSpec wanted_spec, spec;
-  wanted_spec.silence = 0;
-  wanted_spec.format = AUDIO_S16SYS;
-  wanted_spec.channels = reader_->GetChannelCount();
-  wanted_spec.samples = 1024;
-  wanted_spec.freq = 48000;
-  wanted_spec.callback = [](void *userdata, Uint8 *stream, int len) {
-    auto *player = static_cast<SdlOggOpusPlayer *>(userdata);
-    auto *data = reinterpret_cast<Uint16 *>(stream);
-    player->ReadAudioData(data, len / 2);
-  };
-  wanted_spec.userdata = this;
-
-  audio_device_id_ = SDL_OpenAudioDevice(nullptr, 0,
-                                         &wanted_spec, &spec,
-                                         0);
-  if (audio_device_id_ <= 0) {
-    std::cout << "SDL_OpenAudioDevice failed: " << SDL_GetError() << std::endl;
+  auto *mixer = AudioMixer::Instance();
+  if (!mixer->EnsureOpened()) {
     return -1;
   }
+  if (reader_) {
+    OpenPipeline();
+  }
+  decoder_semaphore_ = SDL_CreateSemaphore(0);
 
-  sonic_stream_ = sonicCreateStream(spec.freq, spec.channels);
-
-  if (spec.format != AUDIO_S16SYS) {
-    std::cout << "SDL_OpenAudioDevice failed: spec format" << std::endl;
+  // a player without a slot would never be rendered, take one before the
+  // decoder thread starts filling the pipeline.
+  mixer_slot_ = mixer->AddSource(this);
+  if (mixer_slot_ < 0) {
     return -1;
   }
 
+  decoder_running_.store(true, std::memory_order_release);
+  decoder_thread_ = std::thread(&SdlOggOpusPlayer::DecodeLoop, this);
+
 #ifdef _OPUS_OGG_PLAYER_LOG
-  std::cout << "SDL_OpenAudioDevice spec: "
-            << "\n  freq: " << spec.freq
-            << "\n  format: " << spec.format
-            << "\n  channels: " << int(spec.channels)
-            << "\n  samples: " << spec.samples
+  const auto &spec = mixer->spec();
+  std::cout << "SdlOggOpusPlayer mixer spec: "
+            << "\n  freq: " << spec.sample_rate
+            << "\n  channels: " << spec.channels
+            << "\n  samples: " << spec.frames_per_buffer
             << std::endl;
 #endif
 
   return 0;
 }
 
+// Attach sonic and the pcm buffers for the channel count of |reader_|.
+// Runs before the player is attached to the mixer, or on the decoder thread
+// for progressive streams, the audio callback skips the player until
+// |ready_| is set.
+void SdlOggOpusPlayer::OpenPipeline() {
+  const auto &spec = AudioMixer::Instance()->spec();
+
+  channels_ = reader_->GetChannelCount();
+
+  device_sample_rate_ = spec.sample_rate;
+  source_frames_per_frame_ = double(kOpusSampleRate) / device_sample_rate_;
+  context_ = PlaybackContextPool::Instance()->Acquire(channels_);
+
+  sonicSetSpeed(context_->sonic_stream, float(controls_.Argument(ControlCommand::kPlaybackRate, 1)));
+  ready_.store(true, std::memory_order_release);
+}
+
 SdlOggOpusPlayer::~SdlOggOpusPlayer() {
-  if (audio_device_id_ > 0) {
-    SDL_CloseAudioDevice(audio_device_id_);
+  EventDispatcher::Instance()->SetInterval(this, 0);
+  if (mixer_slot_ >= 0) {
+    AudioMixer::Instance()->RemoveSource(mixer_slot_);
+  }
+  if (progressive_stream_) {
+    progressive_stream_->Cancel();
+  }
+  if (decoder_thread_.joinable()) {
+    decoder_running_.store(false, std::memory_order_release);
+    SDL_SemPost(decoder_semaphore_);
+    decoder_thread_.join();
+  }
+  if (decoder_semaphore_) {
+    SDL_DestroySemaphore(decoder_semaphore_);
   }
-  if (sonic_stream_) {
-    sonicDestroyStream(sonic_stream_);
+  if (context_) {
+    PlaybackContextPool::Instance()->Release(std::move(context_));
+  }
+  reader_.reset();
+  played_readers_.clear();
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  queued_readers_.clear();
+  while (sources_released_ < sources_) {
+    PostSourceReleased();
   }
 }
 
 double SdlOggOpusPlayer::CurrentTime() {
-  if (last_update_time_ == 0 || paused_) {
-    return current_time_;
+  // report the target of a seek the audio callback did not pick up yet,
+  // e.g. while paused.
+  if (controls_.PostedCount(ControlCommand::kSeek) != seek_handled_.load(std::memory_order_acquire)
+      || seek_decoded_.load(std::memory_order_acquire) != seek_applied_.load(std::memory_order_acquire)) {
+    return controls_.Argument(ControlCommand::kSeek, 0);
   }
-  auto time = std::chrono::system_clock::now().time_since_epoch().count() - last_update_time_;
-  auto speed = sonic_stream_ ? sonicGetSpeed(sonic_stream_) : 1.0f;
-  return current_time_ + ((double) time / 1000000000.0) * speed;
+  // while paused the clock holds at the end of the last rendered buffer.
+  return double(clock_.Position(SDL_GetPerformanceCounter())) / kOpusSampleRate;
 }
 
+// sonic is only primed for rates in [kMinPlaybackRate, kMaxPlaybackRate],
+// others would make it reallocate in the audio callback.
 void SdlOggOpusPlayer::SetPlaybackRate(double rate) {
-  if (sonic_stream_) {
-    sonicSetSpeed(sonic_stream_, float(rate));
+  auto clamped = std::min(double(kMaxPlaybackRate), std::max(double(kMinPlaybackRate), rate));
+  controls_.Post(ControlCommand::kPlaybackRate, clamped);
+}
+
+void SdlOggOpusPlayer::Seek(double seconds) {
+  if (!decoder_thread_.joinable()) {
+    return;
   }
+  controls_.Post(ControlCommand::kSeek, std::max(0.0, seconds));
+  SDL_SemPost(decoder_semaphore_);
 }
 
 }
@@ -275,9 +1082,92 @@ void global_init_sdl2() {
   }
 }
 
+namespace {
+
+// return null if |player| can not play, the dart side reports
+// PlayerState.error then.
+void *PlayerCreated(SdlOggOpusPlayer *player, uint64_t started_at) {
+  if (player->Initialize() < 0) {
+    std::cerr << "ogg_opus_player: can not attach the player to the audio output" << std::endl;
+    delete player;
+    return nullptr;
+  }
+  player->MarkCreated(started_at);
+  return static_cast<Player *>(player);
+}
+
+}
+
 void *ogg_opus_player_create(const char *file_path, Dart_Port_DL send_port) {
-  auto *player = new SdlOggOpusPlayer(file_path, send_port);
-  return player;
+  auto started_at = SDL_GetPerformanceCounter();
+  auto *player = new SdlOggOpusPlayer(std::make_unique<OggOpusReader>(file_path), send_port);
+  return PlayerCreated(player, started_at);
+}
+
+void *ogg_opus_player_create_from_memory(const uint8_t *data, int64_t length, Dart_Port_DL send_port) {
+  auto started_at = SDL_GetPerformanceCounter();
+  auto reader = std::make_unique<OggOpusReader>(data, size_t(std::max<int64_t>(0, length)));
+  auto *player = new SdlOggOpusPlayer(std::move(reader), send_port);
+  return PlayerCreated(player, started_at);
+}
+
+void *ogg_opus_player_create_streaming(Dart_Port_DL send_port) {
+  auto started_at = SDL_GetPerformanceCounter();
+  auto *player = new SdlOggOpusPlayer(std::make_unique<ByteQueueStream>(), send_port);
+  return PlayerCreated(player, started_at);
+}
+
+void *ogg_opus_player_create_from_growing_file(const char *file_path, Dart_Port_DL send_port) {
+  auto started_at = SDL_GetPerformanceCounter();
+  auto *player = new SdlOggOpusPlayer(std::make_unique<GrowingFileStream>(file_path), send_port);
+  return PlayerCreated(player, started_at);
+}
+
+void ogg_opus_player_append_data(void *player, const uint8_t *data, int64_t length) {
+  auto *p = static_cast<Player *>(player);
+  if (length > 0) {
+    p->AppendData(data, size_t(length));
+  }
+}
+
+void ogg_opus_player_end_of_data(void *player) {
+  auto *p = static_cast<Player *>(player);
+  p->EndOfData();
+}
+
+void *ogg_opus_player_create_from_callbacks(const OggOpusPlayerCallbacks *callbacks,
+                                            void *user_data, Dart_Port_DL send_port) {
+  if (!callbacks || !callbacks->read) {
+    std::cerr << "ogg_opus_player_create_from_callbacks: read callback is required" << std::endl;
+    return nullptr;
+  }
+  auto started_at = SDL_GetPerformanceCounter();
+  auto stream = std::make_unique<CallbacksStream>(*callbacks, user_data);
+  auto *player = new SdlOggOpusPlayer(std::make_unique<OggOpusReader>(std::move(stream)), send_port);
+  return PlayerCreated(player, started_at);
+}
+
+void *ogg_opus_player_create_encrypted(const char *file_path, int32_t mode,
+                                       const uint8_t *key, int32_t key_length,
+                                       const uint8_t *iv, Dart_Port_DL send_port) {
+  if (!key || !iv || key_length <= 0) {
+    std::cerr << "ogg_opus_player_create_encrypted: key and iv are required" << std::endl;
+    return nullptr;
+  }
+  auto started_at = SDL_GetPerformanceCounter();
+  auto file = OpenFileStream(file_path);
+  if (!file) {
+    std::cerr << "ogg_opus_player_create_encrypted: open file failed: " << file_path << std::endl;
+    return nullptr;
+  }
+  auto stream = std::make_unique<DecryptingStream>(std::move(file), CipherMode(mode),
+                                                   key, size_t(key_length), iv);
+  if (!stream->IsValid()) {
+    std::cerr << "ogg_opus_player_create_encrypted: invalid key, mode or ciphertext" << std::endl;
+    return nullptr;
+  }
+  auto *player = new SdlOggOpusPlayer(std::make_unique<OggOpusReader>(std::move(stream)), send_port);
+  return PlayerCreated(player, started_at);
 }
 
 void ogg_opus_player_pause(void *player) {
@@ -308,3 +1198,94 @@ void ogg_opus_player_set_playback_rate(void *player, double rate) {
   auto *p = static_cast<Player *>(player);
   p->SetPlaybackRate(rate);
 }
+
+void ogg_opus_player_seek(void *player, double seconds) {
+  auto *p = static_cast<Player *>(player);
+  p->Seek(seconds);
+}
+
+void ogg_opus_player_set_volume(void *player, double volume) {
+  auto *p = static_cast<Player *>(player);
+  p->SetVolume(volume);
+}
+
+int64_t ogg_opus_player_get_realtime_allocation_count() {
+  return realtime_allocation_count();
+}
+
+int ogg_opus_player_warm_up(int32_t count, int32_t channels) {
+  return PlaybackContextPool::Instance()->WarmUp(count, channels) ? 0 : -1;
+}
+
+int ogg_opus_player_set_float_pipeline(int32_t enabled) {
+  auto format = enabled ? SampleFormat::kFloat32 : SampleFormat::kInt16;
+  return AudioMixer::Instance()->SetPreferredFormat(format) ? 0 : -1;
+}
+
+int ogg_opus_player_set_latency_mode(int32_t min_frames, int32_t max_frames) {
+  return AudioMixer::Instance()->SetBufferBounds(min_frames, max_frames) ? 0 : -1;
+}
+
+void ogg_opus_player_set_pcm_cache_size(int64_t bytes) {
+  PcmCache::Instance()->SetCapacity(bytes);
+}
+
+void ogg_opus_player_set_memory_mapping(int32_t enabled) {
+  MappedFileStream::SetEnabled(enabled != 0);
+}
+
+int32_t ogg_opus_player_build_seek_index(const char *file_path, const char *index_path) {
+  auto index = SeekIndexRegistry::Instance()->Build(file_path, index_path);
+  if (!index) {
+    std::cerr << "ogg_opus_player_build_seek_index: can not index " << file_path << std::endl;
+    return -1;
+  }
+  return int32_t(index->size());
+}
+
+double ogg_opus_player_get_output_latency(int32_t *buffer_frames) {
+  auto *mixer = AudioMixer::Instance();
+  if (buffer_frames) {
+    *buffer_frames = mixer->device_buffer_frames();
+  }
+  return mixer->device_latency();
+}
+
+void ogg_opus_player_set_startup_hook(ogg_opus_player_startup_hook hook) {
+  startup_hook.store(hook, std::memory_order_release);
+}
+
+double ogg_opus_player_get_startup_latency(void *player) {
+  auto *p = static_cast<Player *>(player);
+  return p->StartupLatency();
+}
+
+void ogg_opus_player_set_event_interval(void *player, int32_t milliseconds) {
+  auto *p = static_cast<Player *>(player);
+  p->SetEventInterval(milliseconds);
+}
+
+void ogg_opus_player_get_stats(void *player, OggOpusPlayerStats *stats) {
+  auto *p = static_cast<Player *>(player);
+  p->GetStats(stats);
+}
+
+int ogg_opus_player_enqueue_file(void *player, const char *file_path) {
+  auto reader = std::make_unique<OggOpusReader>(file_path);
+  if (!reader->IsOpened()) {
+    return -1;
+  }
+  auto *p = static_cast<Player *>(player);
+  p->Enqueue(std::move(reader));
+  return 0;
+}
+
+int ogg_opus_player_enqueue_memory(void *player, const uint8_t *data, int64_t length) {
+  auto reader = std::make_unique<OggOpusReader>(data, size_t(std::max<int64_t>(0, length)));
+  if (!reader->IsOpened()) {
+    return -1;
+  }
+  auto *p = static_cast<Player *>(player);
+  p->Enqueue(std::move(reader));
+  return 0;
+}
@@ -1,3 +1,6 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_PLAYER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_PLAYER_H_
+
 #if _WIN32
 #include <Windows.h>
 #else
@@ -17,8 +20,70 @@ extern "C" {
 #define FFI_PLUGIN_EXPORT
 #endif
 
+// Play an ogg opus file. This and the other create functions return NULL if
+// the audio output can not be opened or 32 players already exist, the
+// players share one output with a slot for each.
 FFI_PLUGIN_EXPORT void *ogg_opus_player_create(const char *file_path, int64_t send_port);
 
+// Play an ogg opus stream held in memory. |data| is not copied, it must stay
+// valid until the player posts [2, 0] to |send_port| or
+// ogg_opus_player_dispose returns, whichever comes first, see
+// ogg_opus_player_enqueue_memory.
+FFI_PLUGIN_EXPORT void *ogg_opus_player_create_from_memory(const uint8_t *data, int64_t length, int64_t send_port);
+
+// Play an ogg opus stream that is still being downloaded, its bytes are pushed
+// with ogg_opus_player_append_data. Playback starts once the first pages
+// arrived. If the player runs out of bytes it posts 2 to |send_port| and keeps
+// waiting instead of ending, 3 is posted once playback continues.
+FFI_PLUGIN_EXPORT void *ogg_opus_player_create_streaming(int64_t send_port);
+
+// Like ogg_opus_player_create_streaming, but the bytes are read from a file
+// another writer is still appending to. The file does not need to exist yet.
+FFI_PLUGIN_EXPORT void *ogg_opus_player_create_from_growing_file(const char *file_path, int64_t send_port);
+
+// Append |length| bytes to a player created by ogg_opus_player_create_streaming,
+// the bytes are copied.
+FFI_PLUGIN_EXPORT void ogg_opus_player_append_data(void *player, const uint8_t *data, int64_t length);
+
+// No more bytes will arrive for a streaming or growing file player, playback
+// ends normally once the remaining bytes were played.
+FFI_PLUGIN_EXPORT void ogg_opus_player_end_of_data(void *player);
+
+// Byte source for ogg_opus_player_create_from_callbacks. The functions are
+// called from the player's decoder thread, never from the audio callback.
+typedef struct OggOpusPlayerCallbacks {
+  // Read at most |size| bytes into |buffer|, return the count of bytes read,
+  // 0 at the end of the stream or negative on error.
+  int (*read)(void *user_data, uint8_t *buffer, int size);
+  // fseek() semantics, return 0 on success or -1. May be NULL together with
+  // |tell| if the source can not seek, the player can not seek either then.
+  int (*seek)(void *user_data, int64_t offset, int whence);
+  int64_t (*tell)(void *user_data);
+  // Called once the player no longer uses the source. May be NULL.
+  void (*close)(void *user_data);
+} OggOpusPlayerCallbacks;
+
+// Play an ogg opus stream read through |callbacks|, which are copied.
+// |user_data| is passed to every callback.
+FFI_PLUGIN_EXPORT void *ogg_opus_player_create_from_callbacks(const OggOpusPlayerCallbacks *callbacks,
+                                                              void *user_data, int64_t send_port);
+
+#define OGG_OPUS_CIPHER_AES_CTR 0
+#define OGG_OPUS_CIPHER_AES_CBC 1
+
+// Play an AES encrypted ogg opus file. |mode| is OGG_OPUS_CIPHER_AES_CTR, the
+// |iv| is the initial big endian counter, or OGG_OPUS_CIPHER_AES_CBC with
+// PKCS#7 padding. |key| is 16, 24 or 32 bytes and |iv| 16 bytes, both are
+// copied and may be wiped once the call returns. Pages are decrypted in
+// memory as they are decoded, seeking only decrypts the blocks it reads.
+// Return NULL if the key, the mode or the file is invalid.
+FFI_PLUGIN_EXPORT void *ogg_opus_player_create_encrypted(const char *file_path, int32_t mode,
+                                                         const uint8_t *key, int32_t key_length,
+                                                         const uint8_t *iv, int64_t send_port);
+
+// Control calls do not block on the audio thread. They post a command the
+// audio callback applies at the start of its next buffer, a later command
+// of the same kind replaces one that was not applied yet.
 FFI_PLUGIN_EXPORT void ogg_opus_player_pause(void *player);
 
 FFI_PLUGIN_EXPORT void ogg_opus_player_play(void *player);
@@ -27,10 +92,152 @@ FFI_PLUGIN_EXPORT void ogg_opus_player_dispose(void *player);
 
 FFI_PLUGIN_EXPORT double ogg_opus_player_get_current_time(void *player);
 
+// |rate| is clamped to [0.5, 3], 1 is normal speed.
 FFI_PLUGIN_EXPORT void ogg_opus_player_set_playback_rate(void *player, double rate);
 
+// Seek to |seconds|. Takes effect on the next audio callback, until then
+// ogg_opus_player_get_current_time reports the target position.
+FFI_PLUGIN_EXPORT void ogg_opus_player_seek(void *player, double seconds);
+
+// Linear gain of the player in the shared mixer, 1.0 is unchanged, clamped
+// to [0, 4].
+FFI_PLUGIN_EXPORT void ogg_opus_player_set_volume(void *player, double volume);
+
+// Queue a file to play right after the current stream and everything queued
+// before it, without a gap. It is opened right away and decoded ahead while
+// the previous track plays. Each transition posts a list [1, track_index,
+// queued_tracks] to the send port, |track_index| counts from 0, the stream
+// the player was created with. A seek applies to the track that is playing.
+// Return 0 on success, -1 if the file could not be opened.
+FFI_PLUGIN_EXPORT int ogg_opus_player_enqueue_file(void *player, const char *file_path);
+
+// Like ogg_opus_player_enqueue_file, for a stream in memory. |data| is not
+// copied, it must stay valid until the player posts [2, track_index] to the
+// send port or ogg_opus_player_dispose returns. |track_index| of the first
+// track enqueued is 1. The list is posted for every track, once the track
+// after it started playing, and for the remaining ones during dispose.
+FFI_PLUGIN_EXPORT int ogg_opus_player_enqueue_memory(void *player, const uint8_t *data, int64_t length);
+
+// Post playback events to the player's send port every |milliseconds| while
+// it plays, and right after each state change. 0, the default, stops them.
+// Events are posted from a helper thread, never from the audio callback.
+// Each event is a list [0, position, buffered_position, peak, underruns, state,
+// buffer_frames, latency]:
+// |position| and |buffered_position|, the end of the decoded pcm, in seconds,
+// |peak| the largest absolute sample since the last event in [0, 1],
+// |underruns| the count of audio callbacks that ran out of decoded pcm,
+// |state| 0 paused, 1 playing, 2 buffering, 3 ended,
+// |buffer_frames| and |latency| as ogg_opus_player_get_output_latency.
+FFI_PLUGIN_EXPORT void ogg_opus_player_set_event_interval(void *player, int32_t milliseconds);
+
+#define OGG_OPUS_PLAYER_STATS_BUCKETS 16
+
+// Audio callback instrumentation of a player since it was created, durations
+// in microseconds. Histogram bucket 0 counts values below 1us, bucket i the
+// values in [2^(i-1), 2^i) us, the last bucket everything above.
+typedef struct OggOpusPlayerStats {
+  // audio callbacks that rendered the player, and the ones that produced
+  // fewer frames than requested because the decoder fell behind.
+  int64_t callbacks;
+  int64_t underruns;
+  // time spent rendering the player, and between two renders.
+  double callback_duration_mean_us;
+  double callback_duration_max_us;
+  double callback_period_mean_us;
+  double callback_period_max_us;
+  // smallest time left in the device buffer once the player was rendered,
+  // measured from the start of the mixer callback. negative means missed.
+  double deadline_margin_min_us;
+  // decoded audio ahead of the callback after the last render, its minimum
+  // and the capacity of the decode-ahead buffer, in milliseconds.
+  double buffer_fill_ms;
+  double buffer_fill_min_ms;
+  double buffer_capacity_ms;
+  int64_t callback_duration_histogram[OGG_OPUS_PLAYER_STATS_BUCKETS];
+  int64_t callback_period_histogram[OGG_OPUS_PLAYER_STATS_BUCKETS];
+  int64_t deadline_margin_histogram[OGG_OPUS_PLAYER_STATS_BUCKETS];
+  // the process wide decoded pcm cache, see ogg_opus_player_set_pcm_cache_size.
+  // lookups of files that hit and missed, entries evicted to stay within the
+  // budget, the bytes held and the budget.
+  int64_t pcm_cache_hits;
+  int64_t pcm_cache_misses;
+  int64_t pcm_cache_evictions;
+  int64_t pcm_cache_bytes;
+  int64_t pcm_cache_capacity_bytes;
+} OggOpusPlayerStats;
+
+// Copy the instrumentation of |player| to |stats|. Cheap and lock-free, may
+// be polled from any thread.
+FFI_PLUGIN_EXPORT void ogg_opus_player_get_stats(void *player, OggOpusPlayerStats *stats);
+
 FFI_PLUGIN_EXPORT void ogg_opus_player_initialize_dart(void *native_port);
 
+// Open the shared output device paused and prepare |count| idle playback
+// contexts for streams with |channels| channels, so the next players only
+// have to open their reader. Disposed players return their context to the
+// pool as well. Return 0 on success, -1 if the device could not be opened.
+FFI_PLUGIN_EXPORT int ogg_opus_player_warm_up(int32_t count, int32_t channels);
+
+// Decode, time stretch and mix in float and open the shared output device with
+// float samples if it supports them, instead of int16. Must be called before
+// the first player is created or warmed up. Return 0 on success, -1 if the
+// device is already open.
+FFI_PLUGIN_EXPORT int ogg_opus_player_set_float_pipeline(int32_t enabled);
+
+// Low latency mode of the shared output device: open it with a buffer of
+// |min_frames| frames and double the buffer, up to |max_frames|, whenever
+// an audio callback came late. 0 for both restores the fixed 1024 frames.
+// Must be called before the first player is created or warmed up. Return 0
+// on success, -1 if the device is already open.
+FFI_PLUGIN_EXPORT int ogg_opus_player_set_latency_mode(int32_t min_frames, int32_t max_frames);
+
+// Byte budget of the process wide cache of decoded pcm, keyed by path,
+// modification time and size. A file is cached once a player decoded it from
+// start to end, later players of the file and seeks of that player are
+// served from memory without decoding. Least recently used files are evicted
+// first. 0 disables the cache, the default is 32 MiB.
+FFI_PLUGIN_EXPORT void ogg_opus_player_set_pcm_cache_size(int64_t bytes);
+
+// Map files into memory instead of reading them with stdio, players of the
+// same file then share its page cache pages. Off by default: truncating or
+// rewriting a mapped file in place, e.g. recording over a file that is still
+// played, raises SIGBUS on Linux and crashes the app. Only enable it if the
+// played files never change. Players created after the call use it.
+FFI_PLUGIN_EXPORT void ogg_opus_player_set_memory_mapping(int32_t enabled);
+
+// Scan |file_path| once and record the byte offset of every ogg page with
+// its granule position, players of the file then seek with a single jump
+// instead of bisecting the file. If |index_path| is not null, the index is
+// loaded from it if it still matches the file and written back, so it
+// survives restarts. The part of a file that grew since it was indexed is
+// scanned incrementally, also when a player of the file is created. Chained
+// files are not indexed. Return the count of checkpoints, or -1 on error.
+FFI_PLUGIN_EXPORT int32_t ogg_opus_player_build_seek_index(const char *file_path, const char *index_path);
+
+// Latency of the shared output device buffer in seconds, its size in frames
+// is stored to |buffer_frames| if it is not null.
+FFI_PLUGIN_EXPORT double ogg_opus_player_get_output_latency(int32_t *buffer_frames);
+
+// Startup latency of a player in microseconds: |create_us| spent in the create
+// call, |first_callback_us| from the start of the create call to the first
+// audio callback that rendered the player.
+typedef void (*ogg_opus_player_startup_hook)(void *player, int64_t create_us, int64_t first_callback_us);
+
+// Called once per player on its decoder thread after its first audio callback.
+// Pass NULL to remove the hook.
+FFI_PLUGIN_EXPORT void ogg_opus_player_set_startup_hook(ogg_opus_player_startup_hook hook);
+
+// Seconds from the start of the create call to the first audio callback that
+// rendered |player|, negative if there was none yet.
+FFI_PLUGIN_EXPORT double ogg_opus_player_get_startup_latency(void *player);
+
+// Count of heap allocations made on the audio callbacks since the library was
+// loaded, -1 if the library was built without OGG_OPUS_PLAYER_TRACK_ALLOCATIONS.
+// Should stay constant during steady state playback.
+FFI_PLUGIN_EXPORT int64_t ogg_opus_player_get_realtime_allocation_count();
+
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_PLAYER_H_
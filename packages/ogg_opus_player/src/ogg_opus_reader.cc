@@ -0,0 +1,288 @@
+//
+// Decodes an ogg opus file to pcm with opusfile.
+//
+
+#include "ogg_opus_reader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+#include "mapped_file_stream.h"
+
+namespace {
+
+int ReadStream(void *stream, unsigned char *ptr, int nbytes) {
+  return static_cast<OggOpusStream *>(stream)->Read(ptr, nbytes);
+}
+
+int SeekStream(void *stream, opus_int64 offset, int whence) {
+  return static_cast<OggOpusStream *>(stream)->Seek(offset, whence);
+}
+
+opus_int64 TellStream(void *stream) {
+  return static_cast<OggOpusStream *>(stream)->Tell();
+}
+
+// largest opus packet, 120ms.
+const int kMaxDiscardFrames = 5760;
+
+// pcm cached in the other sample type, e.g. cached by a float pipeline
+// player and replayed by an int16 one.
+void ConvertSample(float sample, opus_int16 *out) {
+  *out = opus_int16(std::max(-32768L, std::min(32767L, lrintf(sample * 32768.0f))));
+}
+
+void ConvertSample(opus_int16 sample, float *out) {
+  *out = float(sample) / 32768.0f;
+}
+
+template<typename From, typename To>
+void CopySamples(const From *from, To *to, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    ConvertSample(from[i], &to[i]);
+  }
+}
+
+template<typename T>
+void CopySamples(const T *from, T *to, size_t count) {
+  memcpy(to, from, count * sizeof(T));
+}
+
+}
+
+OggOpusStream::~OggOpusStream() = default;
+
+OggOpusReader::OggOpusReader(const char *file_path) : opus_file_(nullptr) {
+  if (GetFileIdentity(file_path, &identity_)) {
+    cached_pcm_ = PcmCache::Instance()->Lookup(identity_);
+    if (cached_pcm_) {
+      return;
+    }
+    cacheable_ = true;
+    recording_ = std::make_unique<DecodedPcm>();
+    seek_index_ = SeekIndexRegistry::Instance()->Lookup(identity_);
+  }
+  if (MappedFileStream::IsEnabled()) {
+    auto mapped = std::make_unique<MappedFileStream>(file_path);
+    if (mapped->IsMapped()) {
+      OpenStream(std::move(mapped));
+      return;
+    }
+  }
+  int result;
+  auto opus_file = op_open_file(file_path, &result);
+  if (result == 0 && opus_file) {
+    opus_file_ = opus_file;
+  } else {
+    std::cerr << "open opus file failed" << result << std::endl;
+  }
+}
+
+OggOpusReader::OggOpusReader(const unsigned char *data, size_t length) : opus_file_(nullptr) {
+  int result;
+  auto opus_file = op_open_memory(data, length, &result);
+  if (result == 0 && opus_file) {
+    opus_file_ = opus_file;
+  } else {
+    std::cerr << "open opus memory failed" << result << std::endl;
+  }
+}
+
+OggOpusReader::OggOpusReader(std::unique_ptr<OggOpusStream> stream) : opus_file_(nullptr) {
+  OpenStream(std::move(stream));
+}
+
+void OggOpusReader::OpenStream(std::unique_ptr<OggOpusStream> stream) {
+  stream_ = std::move(stream);
+  // the stream is owned by |stream_|, opusfile must not close it.
+  OpusFileCallbacks callbacks = {ReadStream, nullptr, nullptr, nullptr};
+  if (stream_->IsSeekable()) {
+    callbacks.seek = SeekStream;
+    callbacks.tell = TellStream;
+  }
+  int result;
+  auto opus_file = op_open_callbacks(stream_.get(), &callbacks, nullptr, 0, &result);
+  if (result == 0 && opus_file) {
+    opus_file_ = opus_file;
+  } else {
+    std::cerr << "open opus stream failed" << result << std::endl;
+  }
+}
+
+OggOpusReader::~OggOpusReader() {
+  if (opus_file_) {
+    op_free(opus_file_);
+  }
+}
+
+int OggOpusReader::ReadPcmData(opus_int16 *data, int frames) {
+  return ReadPcm(data, frames, op_read);
+}
+
+int OggOpusReader::ReadPcmData(float *data, int frames) {
+  return ReadPcm(data, frames, op_read_float);
+}
+
+template<typename T>
+int OggOpusReader::ReadPcm(T *data, int frames, int (*read_function)(OggOpusFile *, T *, int, int *)) {
+  if (cached_pcm_) {
+    return ReadCachedPcm(data, frames);
+  }
+  if (!opus_file_ || ended_) {
+    return 0;
+  }
+  auto channels = GetChannelCount();
+  auto read = 0;
+
+  auto result = 1;
+  while ((result == OP_HOLE || result > 0) && read < frames) {
+    // op_read takes the buffer size in samples of all channels,
+    // but returns the count of samples per channel.
+    result = read_function(opus_file_, data + read * channels,
+                           (frames - read) * channels, nullptr);
+    if (result >= 0) {
+      read += result;
+    }
+  }
+
+  if (recording_) {
+    RecordPcm(data, read);
+  }
+
+  if (result <= 0 && result != OP_HOLE) {
+    ended_ = true;
+    // only a stream decoded from the first to the last frame is cached. the
+    // reader serves later seeks from the pcm as well.
+    if (recording_ && recording_->frames == GetTotalFrames()) {
+      std::shared_ptr<const DecodedPcm> pcm = std::move(recording_);
+      PcmCache::Instance()->Insert(identity_, pcm);
+      cached_pcm_ = std::move(pcm);
+      cached_position_ = cached_pcm_->frames;
+    }
+    recording_.reset();
+  }
+
+  return read;
+}
+
+template<typename T>
+int OggOpusReader::ReadCachedPcm(T *data, int frames) {
+  const auto &pcm = *cached_pcm_;
+  auto count = int(std::max<int64_t>(0, std::min<int64_t>(frames, pcm.frames - cached_position_)));
+  auto offset = size_t(cached_position_ * pcm.channels);
+  auto samples = size_t(count * pcm.channels);
+  if (pcm.is_float) {
+    CopySamples(pcm.Samples<float>().data() + offset, data, samples);
+  } else {
+    CopySamples(pcm.Samples<opus_int16>().data() + offset, data, samples);
+  }
+  cached_position_ += count;
+  return count;
+}
+
+template<typename T>
+void OggOpusReader::RecordPcm(const T *data, int frames) {
+  auto &samples = recording_->Samples<T>();
+  auto channels = GetChannelCount();
+  if (recording_->frames == 0 && samples.empty()) {
+    // the first read, reserve the whole stream up front so the pcm is not
+    // copied while it grows.
+    auto total = GetTotalFrames();
+    auto bytes = total * channels * int64_t(sizeof(T));
+    if (total <= 0 || !PcmCache::Instance()->Admits(bytes)) {
+      recording_.reset();
+      return;
+    }
+    recording_->channels = channels;
+    recording_->is_float = std::is_same<T, float>::value;
+    samples.reserve(size_t(total * channels));
+  }
+  // a player reads one sample type, and chained links rarely change the
+  // channel count, such streams are not worth caching.
+  if (recording_->is_float != std::is_same<T, float>::value || recording_->channels != channels) {
+    recording_.reset();
+    return;
+  }
+  samples.insert(samples.end(), data, data + size_t(frames) * channels);
+  recording_->frames += frames;
+}
+
+int64_t OggOpusReader::Seek(int64_t frame) {
+  if (cached_pcm_) {
+    cached_position_ = std::max<int64_t>(0, std::min(frame, cached_pcm_->frames));
+    return cached_position_;
+  }
+  if (!opus_file_) {
+    return -1;
+  }
+  auto total = GetTotalFrames();
+  frame = std::max<int64_t>(0, frame);
+  if (total >= 0) {
+    frame = std::min(frame, total);
+  }
+  // a seek back to the start, e.g. a replay, records the stream again, a
+  // seek elsewhere leaves a gap in the recording.
+  if (frame == 0 && cacheable_) {
+    recording_ = std::make_unique<DecodedPcm>();
+  } else if (recording_ && frame != recording_->frames) {
+    recording_.reset();
+  }
+  if (SeekWithIndex(frame)) {
+    ended_ = false;
+    return frame;
+  }
+  auto result = op_pcm_seek(opus_file_, frame);
+  if (result != 0) {
+    std::cerr << "op_pcm_seek failed: " << result << std::endl;
+    return result;
+  }
+  ended_ = false;
+  return frame;
+}
+
+bool OggOpusReader::SeekWithIndex(int64_t frame) {
+  const auto *checkpoint = seek_index_ ? seek_index_->Find(frame) : nullptr;
+  if (!checkpoint || op_raw_seek(opus_file_, checkpoint->offset) != 0) {
+    return false;
+  }
+  // the page starts a packet, so decoding starts at the checkpoint. decode
+  // the preroll and the rest up to |frame| and drop it.
+  auto position = op_pcm_tell(opus_file_);
+  if (position < 0 || position != seek_index_->FrameOf(*checkpoint) || position > frame) {
+    return false;
+  }
+  auto channels = GetChannelCount();
+  discard_buffer_.resize(size_t(kMaxDiscardFrames * channels));
+  while (position < frame) {
+    auto frames = int(std::min<int64_t>(kMaxDiscardFrames, frame - position));
+    auto result = op_read(opus_file_, discard_buffer_.data(), frames * channels, nullptr);
+    if (result == 0 || (result < 0 && result != OP_HOLE)) {
+      return false;
+    }
+    position += std::max(0, result);
+  }
+  return true;
+}
+
+int64_t OggOpusReader::GetTotalFrames() const {
+  if (cached_pcm_) {
+    return cached_pcm_->frames;
+  }
+  if (!opus_file_) {
+    return -1;
+  }
+  return op_pcm_total(opus_file_, -1);
+}
+
+int OggOpusReader::GetChannelCount() const {
+  if (cached_pcm_) {
+    return cached_pcm_->channels;
+  }
+  if (!opus_file_) {
+    return 1;
+  }
+  return op_channel_count(opus_file_, -1);
+}
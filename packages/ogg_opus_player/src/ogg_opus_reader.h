@@ -0,0 +1,117 @@
+//
+// Decodes an ogg opus file to pcm with opusfile.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_READER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ogg/opus.h"
+#include "ogg/opusfile.h"
+#include "pcm_cache.h"
+#include "seek_index.h"
+
+// Opus always decodes at 48kHz.
+const int kOpusSampleRate = 48000;
+
+// A byte stream the ogg pages are read from, opened with op_open_callbacks.
+class OggOpusStream {
+ public:
+  virtual ~OggOpusStream();
+
+  // read at most |size| bytes into |buffer|.
+  // return the count of bytes read, 0 at end of stream, negative on error.
+  virtual int Read(unsigned char *buffer, int size) = 0;
+
+  // Seek() and Tell() are only called if IsSeekable() returns true.
+  virtual bool IsSeekable() const { return false; }
+
+  // same semantics as fseek(), return 0 on success, -1 on error.
+  virtual int Seek(int64_t /*offset*/, int /*whence*/) { return -1; }
+
+  virtual int64_t Tell() { return -1; }
+};
+
+class OggOpusReader {
+
+ private:
+  // destroyed after |opus_file_|, see ~OggOpusReader().
+  std::unique_ptr<OggOpusStream> stream_;
+  OggOpusFile *opus_file_;
+
+  bool ended_ = false;
+
+  // a cache hit, the pcm is served from here and |opus_file_| stays null.
+  std::shared_ptr<const DecodedPcm> cached_pcm_;
+  int64_t cached_position_ = 0;
+
+  // a cache miss of a file, the pcm decoded so far from the first frame on,
+  // cached once the stream ended. null after a seek elsewhere or if the pcm
+  // does not fit the cache.
+  FileIdentity identity_;
+  bool cacheable_ = false;
+  std::unique_ptr<DecodedPcm> recording_;
+
+  // checkpoints of the file if the app indexed it, see SeekIndexRegistry.
+  // seeks jump to a checkpoint and decode the rest instead of bisecting.
+  std::shared_ptr<const SeekIndex> seek_index_;
+  std::vector<opus_int16> discard_buffer_;
+
+  // shared by both ReadPcmData(), |read_function| is op_read or op_read_float.
+  template<typename T>
+  int ReadPcm(T *data, int frames, int (*read_function)(OggOpusFile *, T *, int, int *));
+
+  template<typename T>
+  int ReadCachedPcm(T *data, int frames);
+
+  // append |frames| frames just decoded to |recording_|.
+  template<typename T>
+  void RecordPcm(const T *data, int frames);
+
+  // seek to |frame| through |seek_index_|, false if the index does not
+  // cover it and opusfile has to bisect.
+  bool SeekWithIndex(int64_t frame);
+
+  void OpenStream(std::unique_ptr<OggOpusStream> stream);
+
+ public:
+
+  // the file is read with stdio, or mapped into memory if the app enabled
+  // MappedFileStream and it can be mapped. if PcmCache holds the pcm of the
+  // file it is not opened at all.
+  explicit OggOpusReader(const char *file_path);
+
+  // decode from memory, |data| is not copied and must stay valid until the
+  // reader is destroyed.
+  OggOpusReader(const unsigned char *data, size_t length);
+
+  explicit OggOpusReader(std::unique_ptr<OggOpusStream> stream);
+
+  ~OggOpusReader();
+
+  // read at most |frames| interleaved pcm frames into |data|.
+  // return the count of frames read, 0 means end of stream or error.
+  int ReadPcmData(opus_int16 *data, int frames);
+
+  // same as above, decoded straight to float in [-1, 1].
+  int ReadPcmData(float *data, int frames);
+
+  // seek to |frame|, clamped to the stream, return the frame the next
+  // ReadPcmData() starts at, or a negative value on error.
+  int64_t Seek(int64_t frame);
+
+  // total frames of the stream, negative if unknown.
+  int64_t GetTotalFrames() const;
+
+  int GetChannelCount() const;
+
+  // false if the stream could not be opened.
+  bool IsOpened() const { return opus_file_ != nullptr || cached_pcm_ != nullptr; }
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_READER_H_
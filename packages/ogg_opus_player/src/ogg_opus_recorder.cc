@@ -6,29 +6,105 @@
 
 #include "ogg/opusenc.h"
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <iostream>
+#include <thread>
 #include <vector>
 #include <cmath>
 #include <cstring>
+#include <functional>
 
 #include "SDL.h"
+#include "adaptive_buffer_size.h"
+#include "event_dispatcher.h"
+#include "ogg/opusfile.h"
 #include "ogg_opus_utils.h"
+#include "sample_levels.h"
+#include "spsc_ring_buffer.h"
+#include "waveform_pyramid.h"
 
 namespace {
 
+// First element of the lists posted to dart, see
+// ogg_opus_recorder_set_event_interval and ogg_opus_recorder_set_page_streaming.
+enum RecorderEventKind {
+  RECORDER_EVENT_PROGRESS = 0,
+  RECORDER_EVENT_PAGE = 1,
+  RECORDER_EVENT_PAGES_END = 2,
+};
+
+// Captured input the encoder thread may fall behind by before the capture
+// callback drops input.
+const int kCaptureRingMilliseconds = 2000;
+
+// Samples the encoder thread takes out of the ring at a time, 20ms at 16kHz.
+const size_t kEncodeChunkSamples = 320;
+
+// Upper bound for the encoder thread to sleep, the capture callback wakes it
+// up earlier once it pushed some input.
+const Uint32 kEncoderIdleWaitMilliseconds = 20;
+
+// see ogg_opus_recorder_set_latency_mode.
+std::atomic<int> latency_min_frames(0);
+std::atomic<int> latency_max_frames(0);
+
 inline void set_bits(uint8_t *bytes, int32_t bitOffset, int32_t value) {
   bytes += bitOffset / 8;
   bitOffset %= 8;
   *((int32_t *) bytes) |= (value << bitOffset);
 }
 
+// Opus packets the encoder produced so far, their size and duration at
+// 48kHz. The header packets are not counted.
+struct EncodedPackets {
+  std::atomic<int64_t> bytes{0};
+  std::atomic<int64_t> samples{0};
+};
+
+// Levels of the input since they were last taken.
+class LevelMeter {
+
+ public:
+  void Add(const SampleLevels &levels, int count) {
+    peak_ = std::max(peak_, levels.Peak());
+    square_sum_ += levels.square_sum;
+    samples_ += count;
+  }
+
+  // the peak level in [0, 1], the rms level is stored to |rms| if it is not
+  // null. starts over.
+  double Take(double *rms) {
+    auto peak = peak_ / 32768.0;
+    if (rms) {
+      *rms = samples_ > 0 ? std::sqrt(double(square_sum_) / double(samples_)) / 32768.0 : 0;
+    }
+    peak_ = 0;
+    square_sum_ = 0;
+    samples_ = 0;
+    return peak;
+  }
+
+ private:
+  int32_t peak_ = 0;
+  int64_t square_sum_ = 0;
+  int64_t samples_ = 0;
+
+};
+
+// Called with every ogg page written to the file, on the thread whose write
+// or drain completed it, and once with a null page after the last one.
+using OggPageFunc = std::function<void(const unsigned char *page, int32_t length)>;
+
 class OggOpusWriter {
 
  public:
   OggOpusWriter() = default;
 
-  int Init(const char *file_name, int sample_rate);
+  // every opus packet encoded is counted in |packets|, every page written is
+  // handed to |on_page|.
+  int Init(const char *file_name, int sample_rate, EncodedPackets *packets, OggPageFunc on_page);
 
   int Write(const opus_int16 *data, int size);
 
@@ -38,20 +114,68 @@ class OggOpusWriter {
   OggOpusComments *comments_ = nullptr;
   OggOpusEnc *encoder_ = nullptr;
 
+  // the file is written through the encoder callbacks instead of
+  // ope_encoder_create_file, so the pages can be handed out as well.
+  OpusFileCallbacks file_callbacks_;
+  void *file_ = nullptr;
+  OggPageFunc on_page_;
+
 };
 
-int OggOpusWriter::Init(const char *file_name, opus_int32 sample_rate) {
+int OggOpusWriter::Init(const char *file_name, opus_int32 sample_rate, EncodedPackets *packets, OggPageFunc on_page) {
   auto *comments = ope_comments_create();
   if (!comments) {
     return -1;
   }
+  // op_fopen takes utf-8 paths on windows too.
+  file_ = op_fopen(&file_callbacks_, file_name, "wb");
+  if (!file_) {
+    ope_comments_destroy(comments);
+    return -1;
+  }
+  on_page_ = std::move(on_page);
+
+  OpusEncCallbacks callbacks;
+  callbacks.write = [](void *user_data, const unsigned char *page, opus_int32 length) {
+    auto *writer = static_cast<OggOpusWriter *>(user_data);
+    if (fwrite(page, 1, size_t(length), static_cast<FILE *>(writer->file_)) != size_t(length)) {
+      return 1;
+    }
+    writer->on_page_(page, length);
+    return 0;
+  };
+  callbacks.close = [](void *user_data) {
+    auto *writer = static_cast<OggOpusWriter *>(user_data);
+    auto result = writer->file_callbacks_.close(writer->file_);
+    writer->file_ = nullptr;
+    writer->on_page_(nullptr, 0);
+    return result;
+  };
   int error = OPE_OK;
-  auto encoder = ope_encoder_create_file(file_name, comments, sample_rate, 1, 0, &error);
+  auto encoder = ope_encoder_create_callbacks(&callbacks, this, comments, sample_rate, 1, 0, &error);
   if (error != OPE_OK) {
+    // the encoder only closes the streams it created.
+    file_callbacks_.close(file_);
+    file_ = nullptr;
     ope_comments_destroy(comments);
     return -1;
   }
   error = ope_encoder_ctl(encoder, OPUS_SET_BITRATE_REQUEST, 16 * 1024);
+  if (error == OPE_OK) {
+    ope_packet_func on_packet = [](void *user_data, const unsigned char *packet, opus_int32 length, opus_uint32) {
+      if (length >= 8 && (memcmp(packet, "OpusHead", 8) == 0 || memcmp(packet, "OpusTags", 8) == 0)) {
+        return;
+      }
+      auto samples = opus_packet_get_nb_samples(packet, length, 48000);
+      if (samples <= 0) {
+        return;
+      }
+      auto *packets = static_cast<EncodedPackets *>(user_data);
+      packets->bytes.fetch_add(length, std::memory_order_relaxed);
+      packets->samples.fetch_add(samples, std::memory_order_relaxed);
+    };
+    error = ope_encoder_ctl(encoder, OPE_SET_PACKET_CALLBACK(on_packet, static_cast<void *>(packets)));
+  }
   if (error != OPE_OK) {
     ope_encoder_destroy(encoder);
     ope_comments_destroy(comments);
@@ -80,7 +204,7 @@ int OggOpusWriter::Write(const opus_int16 *data, int size) {
   return error;
 }
 
-class SdlOggOpusRecorder {
+class SdlOggOpusRecorder : public EventSource {
 
  private:
   std::unique_ptr<OggOpusWriter> writer_;
@@ -88,110 +212,293 @@ class SdlOggOpusRecorder {
 
   SDL_AudioDeviceID device_id_ = -1;
 
-  std::vector<int16_t> waveform_samples_;
+  // guards |device_id_| and |started_| against the reopen of |buffer_size_|.
+  std::mutex device_mutex_;
+  bool started_ = false;
+
+  // written by the encoder thread, read by the app while recording.
+  std::mutex levels_mutex_;
+  WaveformPyramid waveform_;
+  // input levels since the app last read them, see GetLevel(), and since
+  // the last event.
+  LevelMeter meter_;
+  LevelMeter event_meter_;
+
+  // frames handed to the encoder, and the packets it produced from them.
+  std::atomic<int64_t> encoded_frames_;
+  EncodedPackets packets_;
+
+  Dart_Port_DL dart_port_;
+  // between Start() and Stop(), events are posted while it is set.
+  std::atomic<bool> recording_;
+  // dispatcher thread.
+  double last_event_duration_ = 0;
+
+  // where the pages of the file go as they are written, see
+  // ogg_opus_recorder_set_page_streaming and ogg_opus_recorder_set_page_callback.
+  std::mutex page_sink_mutex_;
+  bool post_pages_ = false;
+  ogg_opus_recorder_page_callback page_callback_ = nullptr;
+  void *page_callback_user_data_ = nullptr;
+
+  // raw input of the capture callback, drained by |encoder_thread_|.
+  std::unique_ptr<SpscRingBuffer<opus_int16>> capture_ring_;
+  std::thread encoder_thread_;
+  SDL_sem *encoder_semaphore_ = nullptr;
+  std::atomic<bool> encoder_running_;
+
+  // input dropped because the ring was full, and the callbacks it happened in.
+  std::atomic<int64_t> dropped_frames_;
+  std::atomic<int64_t> overflows_;
+
+  // declared last, its helper thread reopens the device until it is destroyed.
+  AdaptiveBufferSize buffer_size_;
 
-  int16_t wave_form_peek_ = 0;
-  int32_t wave_form_peek_count_ = 0;
+  SDL_AudioDeviceID OpenDevice(int sample_rate, int frames, SDL_AudioSpec *spec);
 
-  // recorded duration in seconds
-  double duration_ = 0;
+  void ReopenDevice(int frames);
+
+  // capture callback, only queues |stream| for |encoder_thread_|.
+  void PushAudioData(Uint8 *stream, int size);
+
+  // encode the queued input until Stop(), then whatever is left of it.
+  void EncodeLoop();
+
+  // encoder thread.
+  void WriteAudioData(const opus_int16 *samples, int count);
+
+  // average bitrate of the packets encoded so far in bits per second.
+  double GetBitrate() const;
+
+  // encoder thread, or the thread that stops the recorder for the pages of
+  // the drain. a null |page| ends the stream.
+  void OnPage(const unsigned char *page, int32_t length);
+
+  void PostPage(const unsigned char *page, int32_t length);
 
  public:
-  SdlOggOpusRecorder();
+  explicit SdlOggOpusRecorder(Dart_Port_DL send_port);
 
   int Init(const char *file_name);
 
-  void Start() const;
+  void Start();
 
   void Stop();
 
-  double GetDuration() const { return duration_; }
+  double GetDuration() const;
 
-  ~SdlOggOpusRecorder();
+  double GetLatency(int32_t *buffer_frames) const;
+
+  int64_t GetDroppedFrames(int64_t *overflows) const;
 
-  void WriteAudioData(Uint8 *stream, int size);
+  ~SdlOggOpusRecorder();
 
   void MakeWaveData(uint8_t **result, int64_t *size);
 
-};
+  int GetWaveform(int bar_count, double seconds, float *peaks, float *rms);
 
-SdlOggOpusRecorder::SdlOggOpusRecorder() : waveform_samples_() {
+  double GetLevel(double *rms);
 
-}
+  void SetEventInterval(int milliseconds);
 
-int SdlOggOpusRecorder::Init(const char *file_name) {
+  void SetPageStreaming(bool enabled);
 
-  global_init_sdl2();
+  void SetPageCallback(ogg_opus_recorder_page_callback callback, void *user_data);
+
+  void PostEvents() override;
+
+};
+
+SdlOggOpusRecorder::SdlOggOpusRecorder(Dart_Port_DL send_port)
+    : encoded_frames_(0),
+      dart_port_(send_port),
+      recording_(false),
+      encoder_running_(false),
+      dropped_frames_(0),
+      overflows_(0),
+      buffer_size_([this](int frames) { ReopenDevice(frames); }) {
+
+}
 
+SDL_AudioDeviceID SdlOggOpusRecorder::OpenDevice(int sample_rate, int frames, SDL_AudioSpec *spec) {
   SDL_AudioSpec wanted_spec;
-  SDL_AudioSpec spec;
-  wanted_spec.freq = 16000;
+  SDL_zero(wanted_spec);
+  wanted_spec.freq = sample_rate;
   wanted_spec.format = AUDIO_S16SYS;
   wanted_spec.channels = 1;
-  wanted_spec.samples = 1024;
+  wanted_spec.samples = Uint16(frames);
   wanted_spec.callback = [](void *userdata, Uint8 *stream, int len) {
     auto *recoder = static_cast<SdlOggOpusRecorder *>(userdata);
-    recoder->WriteAudioData(stream, len);
+    recoder->buffer_size_.OnCallback();
+    recoder->PushAudioData(stream, len);
   };
   wanted_spec.userdata = this;
-  device_id_ = SDL_OpenAudioDevice(nullptr, 1, &wanted_spec, &spec,
-                                   0);
+  return SDL_OpenAudioDevice(nullptr, 1, &wanted_spec, spec, 0);
+}
+
+int SdlOggOpusRecorder::Init(const char *file_name) {
+
+  global_init_sdl2();
+
+  buffer_size_.SetBounds(latency_min_frames.load(std::memory_order_relaxed),
+                         latency_max_frames.load(std::memory_order_relaxed));
+  SDL_AudioSpec spec;
+  device_id_ = OpenDevice(16000, buffer_size_.initial_frames(), &spec);
   if (device_id_ <= 0) {
     return -1;
   }
+  buffer_size_.Opened(spec.samples, spec.freq);
   sample_rate_ = spec.freq;
   std::cout << "SDL_OpenAudioDevice: spec freq = " << spec.freq << std::endl;
   writer_ = std::make_unique<OggOpusWriter>();
-  return writer_->Init(file_name, sample_rate_);
+  auto on_page = [this](const unsigned char *page, int32_t length) { OnPage(page, length); };
+  if (writer_->Init(file_name, sample_rate_, &packets_, on_page) < 0) {
+    return -1;
+  }
+
+  auto ring_samples = size_t(sample_rate_) * kCaptureRingMilliseconds / 1000;
+  capture_ring_ = std::make_unique<SpscRingBuffer<opus_int16>>(ring_samples);
+  encoder_semaphore_ = SDL_CreateSemaphore(0);
+  encoder_running_.store(true, std::memory_order_release);
+  encoder_thread_ = std::thread(&SdlOggOpusRecorder::EncodeLoop, this);
+  return 0;
 }
 
-void SdlOggOpusRecorder::WriteAudioData(Uint8 *stream, int size) {
-  if (!writer_) {
-    std::cerr << "writer_ is null" << std::endl;
-    return;
+void SdlOggOpusRecorder::PushAudioData(Uint8 *stream, int size) {
+  auto count = size_t(size) / sizeof(opus_int16);
+  auto written = capture_ring_->Write(reinterpret_cast<const opus_int16 *>(stream), count);
+  if (written < count) {
+    dropped_frames_.fetch_add(int64_t(count - written), std::memory_order_relaxed);
+    overflows_.fetch_add(1, std::memory_order_relaxed);
   }
-  writer_->Write(reinterpret_cast<opus_int16 *>(stream), size);
-
-  auto number_of_samples = size / 2;
-  duration_ = duration_ + number_of_samples / 16000.0;
+  SDL_SemPost(encoder_semaphore_);
+}
 
-  // process waveform data
-  if (number_of_samples <= 0) {
-    return;
+void SdlOggOpusRecorder::EncodeLoop() {
+  opus_int16 samples[kEncodeChunkSamples];
+  while (true) {
+    // read the flag before draining, the input pushed before Stop() cleared
+    // it is still encoded by the last pass.
+    auto running = encoder_running_.load(std::memory_order_acquire);
+    size_t count;
+    while ((count = capture_ring_->Read(samples, kEncodeChunkSamples)) > 0) {
+      WriteAudioData(samples, int(count));
+    }
+    if (!running) {
+      break;
+    }
+    SDL_SemWaitTimeout(encoder_semaphore_, kEncoderIdleWaitMilliseconds);
   }
+}
 
-  auto *samples = reinterpret_cast<int16_t *>(stream);
-  for (int i = 0; i < number_of_samples; ++i) {
-    auto sample = samples[i];
-    wave_form_peek_ = std::max(wave_form_peek_, sample);
-    wave_form_peek_count_++;
+void SdlOggOpusRecorder::WriteAudioData(const opus_int16 *samples, int count) {
+  writer_->Write(samples, count * int(sizeof(opus_int16)));
+  encoded_frames_.fetch_add(count, std::memory_order_relaxed);
 
-    if (wave_form_peek_count_ >= 100) {
-      waveform_samples_.push_back(wave_form_peek_);
-      wave_form_peek_ = 0;
-      wave_form_peek_count_ = 0;
-    }
+  auto levels = MeasureLevels(samples, count);
+  std::lock_guard<std::mutex> lock(levels_mutex_);
+  meter_.Add(levels, count);
+  event_meter_.Add(levels, count);
+  waveform_.Push(samples, count);
+}
+
+// Helper thread of |buffer_size_|. The capture device drops the input of
+// the few milliseconds it takes to reopen, it already dropped input when it
+// asked to grow.
+void SdlOggOpusRecorder::ReopenDevice(int frames) {
+  std::lock_guard<std::mutex> lock(device_mutex_);
+  if (device_id_ <= 0) {
+    return;
+  }
+  auto previous_frames = buffer_size_.frames();
+  SDL_CloseAudioDevice(device_id_);
+  SDL_AudioSpec spec;
+  device_id_ = OpenDevice(sample_rate_, frames, &spec);
+  if (device_id_ <= 0) {
+    std::cerr << "recorder: reopen with " << frames << " frames failed: " << SDL_GetError() << std::endl;
+    device_id_ = OpenDevice(sample_rate_, previous_frames, &spec);
+  }
+  if (device_id_ <= 0) {
+    device_id_ = 0;
+    return;
+  }
+  buffer_size_.Opened(spec.samples, spec.freq);
+  if (started_) {
+    SDL_PauseAudioDevice(device_id_, 0);
   }
+}
 
+double SdlOggOpusRecorder::GetLatency(int32_t *buffer_frames) const {
+  if (buffer_frames) {
+    *buffer_frames = buffer_size_.frames();
+  }
+  return buffer_size_.latency();
 }
 
-void SdlOggOpusRecorder::Start() const {
+void SdlOggOpusRecorder::Start() {
+  std::lock_guard<std::mutex> lock(device_mutex_);
+  if (device_id_ <= 0) {
+    return;
+  }
+  started_ = true;
+  recording_.store(true, std::memory_order_release);
+  buffer_size_.Restart();
   SDL_PauseAudioDevice(device_id_, 0);
 }
 
+// The device is closed first, no input is pushed after it. The encoder
+// thread encodes everything queued before it exits, only then the writer
+// drains the encoder and finishes the file.
 void SdlOggOpusRecorder::Stop() {
-  SDL_LockAudioDevice(device_id_);
+  std::lock_guard<std::mutex> lock(device_mutex_);
+  if (device_id_ <= 0) {
+    return;
+  }
+  started_ = false;
   SDL_PauseAudioDevice(device_id_, 1);
-  writer_ = nullptr;
-  SDL_UnlockAudioDevice(device_id_);
   SDL_CloseAudioDevice(device_id_);
   device_id_ = 0;
+  if (encoder_thread_.joinable()) {
+    encoder_running_.store(false, std::memory_order_release);
+    SDL_SemPost(encoder_semaphore_);
+    encoder_thread_.join();
+  }
+  writer_ = nullptr;
+  // one last event with the duration of the finished file.
+  recording_.store(false, std::memory_order_release);
+  EventDispatcher::Instance()->Wake(this);
 }
 
 SdlOggOpusRecorder::~SdlOggOpusRecorder() {
+  EventDispatcher::Instance()->SetInterval(this, 0);
   if (device_id_ > 0) {
     Stop();
   }
+  if (encoder_thread_.joinable()) {
+    // Init() failed after the thread started, or the device failed to reopen.
+    encoder_running_.store(false, std::memory_order_release);
+    SDL_SemPost(encoder_semaphore_);
+    encoder_thread_.join();
+  }
+  if (encoder_semaphore_) {
+    SDL_DestroySemaphore(encoder_semaphore_);
+  }
+  // drains the encoder while |packets_| and the page sink are still alive.
+  writer_ = nullptr;
+}
+
+double SdlOggOpusRecorder::GetDuration() const {
+  if (sample_rate_ <= 0) {
+    return 0;
+  }
+  return double(encoded_frames_.load(std::memory_order_relaxed)) / sample_rate_;
+}
+
+int64_t SdlOggOpusRecorder::GetDroppedFrames(int64_t *overflows) const {
+  if (overflows) {
+    *overflows = overflows_.load(std::memory_order_relaxed);
+  }
+  return dropped_frames_.load(std::memory_order_relaxed);
 }
 
 void SdlOggOpusRecorder::MakeWaveData(uint8_t **result, int64_t *size) {
@@ -199,21 +506,30 @@ void SdlOggOpusRecorder::MakeWaveData(uint8_t **result, int64_t *size) {
   auto *intensities = static_cast<uint8_t *>(malloc(number_of_waveform_intensities));
   memset(intensities, 0, number_of_waveform_intensities);
 
-  int16_t min_raw_sample = INT16_MAX;
-  int16_t max_raw_sample = 0;
+  WaveformBucket bars[number_of_waveform_intensities];
+  {
+    std::lock_guard<std::mutex> lock(levels_mutex_);
+    waveform_.Render(0, waveform_.samples(), number_of_waveform_intensities, bars);
+  }
+
+  // peaks of both polarities, the positive maximum alone misses the bars
+  // whose loudest excursions are negative.
+  int32_t peaks[number_of_waveform_intensities];
+  int32_t min_raw_sample = INT16_MAX + 1;
+  int32_t max_raw_sample = 0;
 
-  for (auto &sample : waveform_samples_) {
-    min_raw_sample = std::min(min_raw_sample, sample);
-    max_raw_sample = std::max(max_raw_sample, sample);
+  for (int i = 0; i < number_of_waveform_intensities; ++i) {
+    peaks[i] = std::max(-int32_t(bars[i].min), int32_t(bars[i].max));
+    min_raw_sample = std::min(min_raw_sample, peaks[i]);
+    max_raw_sample = std::max(max_raw_sample, peaks[i]);
   }
 
   auto range = max_raw_sample - min_raw_sample;
   auto delta = range == 0 ? 0 : float_t(UINT8_MAX) / float_t(range);
 
-  for (int i = 0; i < waveform_samples_.size(); ++i) {
-    auto index = i * number_of_waveform_intensities / waveform_samples_.size();
-    auto intensity = std::min(float_t(UINT8_MAX), float_t(waveform_samples_[i]) * delta);
-    intensities[index] = uint8_t(intensity);
+  for (int i = 0; i < number_of_waveform_intensities; ++i) {
+    auto intensity = std::min(float_t(UINT8_MAX), float_t(peaks[i]) * delta);
+    intensities[i] = uint8_t(intensity);
   }
 
   *result = intensities;
@@ -221,10 +537,141 @@ void SdlOggOpusRecorder::MakeWaveData(uint8_t **result, int64_t *size) {
 
 }
 
+int SdlOggOpusRecorder::GetWaveform(int bar_count, double seconds, float *peaks, float *rms) {
+  if (bar_count <= 0 || sample_rate_ <= 0) {
+    return 0;
+  }
+  std::vector<WaveformBucket> bars(bar_count);
+  {
+    std::lock_guard<std::mutex> lock(levels_mutex_);
+    auto last = waveform_.samples();
+    auto first = seconds > 0 ? std::max<int64_t>(0, last - int64_t(seconds * sample_rate_)) : 0;
+    if (first == last) {
+      return 0;
+    }
+    waveform_.Render(first, last, bar_count, bars.data());
+  }
+  for (int i = 0; i < bar_count; ++i) {
+    auto peak = std::max(-int(bars[i].min), int(bars[i].max));
+    if (peaks) {
+      peaks[i] = std::min(1.0f, float(peak) / 32768.0f);
+    }
+    if (rms) {
+      rms[i] = std::sqrt(bars[i].mean_square);
+    }
+  }
+  return bar_count;
+}
+
+double SdlOggOpusRecorder::GetLevel(double *rms) {
+  std::lock_guard<std::mutex> lock(levels_mutex_);
+  return meter_.Take(rms);
+}
+
+// the encoder holds back up to 2 seconds of input, the bitrate is computed
+// from the duration of the packets instead of the input handed to it.
+double SdlOggOpusRecorder::GetBitrate() const {
+  auto samples = packets_.samples.load(std::memory_order_relaxed);
+  if (samples <= 0) {
+    return 0;
+  }
+  return double(packets_.bytes.load(std::memory_order_relaxed)) * 8 * 48000 / double(samples);
+}
+
+void SdlOggOpusRecorder::SetEventInterval(int milliseconds) {
+  EventDispatcher::Instance()->SetInterval(this, milliseconds);
+}
+
+// Runs on the event dispatcher thread.
+void SdlOggOpusRecorder::PostEvents() {
+  auto recording = recording_.load(std::memory_order_acquire);
+  auto duration = GetDuration();
+  if (!recording && duration == last_event_duration_) {
+    return;
+  }
+  last_event_duration_ = duration;
+
+  double peak, rms;
+  {
+    std::lock_guard<std::mutex> lock(levels_mutex_);
+    peak = event_meter_.Take(&rms);
+  }
+  DartNumberList<6> event;
+  event.AddInt(RECORDER_EVENT_PROGRESS);
+  event.AddDouble(duration);
+  event.AddDouble(peak);
+  event.AddDouble(rms);
+  event.AddInt(dropped_frames_.load(std::memory_order_relaxed));
+  event.AddDouble(GetBitrate());
+  event.Post(dart_port_);
+}
+
+void SdlOggOpusRecorder::SetPageStreaming(bool enabled) {
+  std::lock_guard<std::mutex> lock(page_sink_mutex_);
+  post_pages_ = enabled;
+}
+
+void SdlOggOpusRecorder::SetPageCallback(ogg_opus_recorder_page_callback callback, void *user_data) {
+  std::lock_guard<std::mutex> lock(page_sink_mutex_);
+  page_callback_ = callback;
+  page_callback_user_data_ = user_data;
+}
+
+// A page is completed about once a second, the lock is not contended by
+// anything but the setters above.
+void SdlOggOpusRecorder::OnPage(const unsigned char *page, int32_t length) {
+  std::lock_guard<std::mutex> lock(page_sink_mutex_);
+  if (page_callback_) {
+    page_callback_(page_callback_user_data_, page, length);
+  }
+  if (!post_pages_) {
+    return;
+  }
+  if (page) {
+    PostPage(page, length);
+  } else {
+    DartNumberList<1> end;
+    end.AddInt(RECORDER_EVENT_PAGES_END);
+    end.Post(dart_port_);
+  }
+}
+
+// The encoder reuses its page buffer, dart gets a copy as external typed
+// data. The Uint8List it receives wraps the copy without another one, the
+// copy is freed once that list is garbage collected.
+void SdlOggOpusRecorder::PostPage(const unsigned char *page, int32_t length) {
+  auto *copy = static_cast<uint8_t *>(malloc(size_t(length)));
+  if (!copy) {
+    return;
+  }
+  memcpy(copy, page, size_t(length));
+
+  Dart_CObject kind;
+  kind.type = Dart_CObject_kInt64;
+  kind.value.as_int64 = RECORDER_EVENT_PAGE;
+  Dart_CObject data;
+  data.type = Dart_CObject_kExternalTypedData;
+  data.value.as_external_typed_data.type = Dart_TypedData_kUint8;
+  data.value.as_external_typed_data.length = length;
+  data.value.as_external_typed_data.data = copy;
+  data.value.as_external_typed_data.peer = copy;
+  data.value.as_external_typed_data.callback = [](void *, void *peer) { free(peer); };
+
+  Dart_CObject *values[] = {&kind, &data};
+  Dart_CObject message;
+  message.type = Dart_CObject_kArray;
+  message.value.as_array.length = 2;
+  message.value.as_array.values = values;
+  // the finalizer only runs for messages that were posted.
+  if (!Dart_PostCObject_DL(dart_port_, &message)) {
+    free(copy);
+  }
+}
+
 }
 
 void *ogg_opus_recorder_create(const char *file_path, int64_t send_port) {
-  auto *recoder = new SdlOggOpusRecorder();
+  auto *recoder = new SdlOggOpusRecorder(send_port);
   if (recoder->Init(file_path) < 0) {
     delete recoder;
     return nullptr;
@@ -264,6 +711,22 @@ void ogg_opus_recorder_get_wave_data(void *recoder, uint8_t **wave_data, int64_t
   sdl_recoder->MakeWaveData(wave_data, wave_data_length);
 }
 
+int32_t ogg_opus_recorder_get_waveform(void *recoder, int32_t bar_count, double seconds, float *peaks, float *rms) {
+  if (!recoder) {
+    return 0;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  return sdl_recoder->GetWaveform(bar_count, seconds, peaks, rms);
+}
+
+double ogg_opus_recorder_get_level(void *recoder, double *rms) {
+  if (!recoder) {
+    return 0;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  return sdl_recoder->GetLevel(rms);
+}
+
 double ogg_opus_recorder_get_duration(void *recoder) {
   if (!recoder) {
     return 0;
@@ -271,3 +734,48 @@ double ogg_opus_recorder_get_duration(void *recoder) {
   auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
   return sdl_recoder->GetDuration();
 }
+
+void ogg_opus_recorder_set_latency_mode(int32_t min_frames, int32_t max_frames) {
+  latency_min_frames.store(min_frames, std::memory_order_relaxed);
+  latency_max_frames.store(max_frames, std::memory_order_relaxed);
+}
+
+double ogg_opus_recorder_get_input_latency(void *recoder, int32_t *buffer_frames) {
+  if (!recoder) {
+    return 0;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  return sdl_recoder->GetLatency(buffer_frames);
+}
+
+int64_t ogg_opus_recorder_get_dropped_frames(void *recoder, int64_t *overflows) {
+  if (!recoder) {
+    return 0;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  return sdl_recoder->GetDroppedFrames(overflows);
+}
+
+void ogg_opus_recorder_set_event_interval(void *recoder, int32_t milliseconds) {
+  if (!recoder) {
+    return;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  sdl_recoder->SetEventInterval(milliseconds);
+}
+
+void ogg_opus_recorder_set_page_streaming(void *recoder, int32_t enabled) {
+  if (!recoder) {
+    return;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  sdl_recoder->SetPageStreaming(enabled != 0);
+}
+
+void ogg_opus_recorder_set_page_callback(void *recoder, ogg_opus_recorder_page_callback callback, void *user_data) {
+  if (!recoder) {
+    return;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  sdl_recoder->SetPageCallback(callback, user_data);
+}
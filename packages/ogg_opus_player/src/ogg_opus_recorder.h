@@ -27,8 +27,64 @@ FFI_PLUGIN_EXPORT void ogg_opus_recorder_destroy(void *recoder);
 
 FFI_PLUGIN_EXPORT void ogg_opus_recorder_get_wave_data(void *recoder, uint8_t **wave_data, int64_t *wave_data_length);
 
+// Peak and rms level, in [0, 1], of |bar_count| equal parts of the last
+// |seconds| of the recording, or of all of it if |seconds| is 0. May be
+// called while recording. |peaks| and |rms| hold |bar_count| values, either
+// may be null. return |bar_count|, or 0 if nothing was recorded yet.
+FFI_PLUGIN_EXPORT int32_t ogg_opus_recorder_get_waveform(void *recoder, int32_t bar_count, double seconds,
+                                                         float *peaks, float *rms);
+
+// Peak level, in [0, 1], of the input recorded since the previous call,
+// its rms level is stored to |rms| if it is not null. For live meters.
+FFI_PLUGIN_EXPORT double ogg_opus_recorder_get_level(void *recoder, double *rms);
+
 FFI_PLUGIN_EXPORT double ogg_opus_recorder_get_duration(void *recoder);
 
+// Low latency mode of the recorders created afterwards: open the capture
+// device with a buffer of |min_frames| frames and double the buffer, up to
+// |max_frames|, whenever a callback came late and input was dropped. 0 for
+// both restores the fixed 1024 frames.
+FFI_PLUGIN_EXPORT void ogg_opus_recorder_set_latency_mode(int32_t min_frames, int32_t max_frames);
+
+// Latency of the capture device buffer in seconds, its size in frames is
+// stored to |buffer_frames| if it is not null.
+FFI_PLUGIN_EXPORT double ogg_opus_recorder_get_input_latency(void *recoder, int32_t *buffer_frames);
+
+// Frames of input dropped because the encoder fell behind the capture device
+// by more than 2 seconds, the number of times it happened is stored to
+// |overflows| if it is not null.
+FFI_PLUGIN_EXPORT int64_t ogg_opus_recorder_get_dropped_frames(void *recoder, int64_t *overflows);
+
+// Post progress events to the recorder's send port every |milliseconds|
+// while it records, and once more after it stopped. 0, the default, stops
+// them. Events are posted from a helper thread, never from the capture
+// callback. Each event is a list [0, duration, peak, rms, dropped_frames,
+// bitrate]:
+// |duration| of the audio encoded so far in seconds,
+// |peak| and |rms| the input levels since the last event in [0, 1],
+// |dropped_frames| as ogg_opus_recorder_get_dropped_frames,
+// |bitrate| the average bitrate of the opus packets so far in bits per second.
+FFI_PLUGIN_EXPORT void ogg_opus_recorder_set_event_interval(void *recoder, int32_t milliseconds);
+
+// Post every ogg page of the file to the recorder's send port as soon as the
+// encoder completed it, so the file can be uploaded while it is recorded.
+// Each page is a list [1, page] with |page| a Uint8List backed by native
+// memory, freed once the list is garbage collected. After the last page,
+// when the recorder stops, [2] is posted. Enable it before starting the
+// recorder, the pages written before are not posted.
+FFI_PLUGIN_EXPORT void ogg_opus_recorder_set_page_streaming(void *recoder, int32_t enabled);
+
+// Called with every ogg page of the file as soon as the encoder completed it,
+// on the recorder's encoder thread, or on the thread that stops the recorder
+// for the last pages. |page| is only valid during the call. Called once more
+// with a null |page| after the last page.
+typedef void (*ogg_opus_recorder_page_callback)(void *user_data, const uint8_t *page, int32_t length);
+
+// Set the page callback before starting the recorder, for native upload
+// queues. Pass NULL to remove it.
+FFI_PLUGIN_EXPORT void ogg_opus_recorder_set_page_callback(void *recoder, ogg_opus_recorder_page_callback callback,
+                                                           void *user_data);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,82 @@
+//
+// Process wide cache of decoded pcm, replays of a file skip opusfile.
+//
+
+#include "pcm_cache.h"
+
+#include <algorithm>
+#include <iterator>
+
+PcmCache *PcmCache::Instance() {
+  static auto *cache = new PcmCache();
+  return cache;
+}
+
+void PcmCache::SetCapacity(int64_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_.store(std::max<int64_t>(0, bytes), std::memory_order_relaxed);
+  EvictTo(capacity_.load(std::memory_order_relaxed));
+}
+
+bool PcmCache::Admits(int64_t bytes) const {
+  return bytes <= capacity_.load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<const DecodedPcm> PcmCache::Lookup(const FileIdentity &identity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (capacity_.load(std::memory_order_relaxed) == 0) {
+    return nullptr;
+  }
+  auto it = index_.find(identity.path);
+  if (it == index_.end() || !(it->second->identity == identity)) {
+    if (it != index_.end()) {
+      Erase(it->second);
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  // move the entry to the front without invalidating |index_|.
+  entries_.splice(entries_.begin(), entries_, it->second);
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  return entries_.front().pcm;
+}
+
+void PcmCache::Insert(const FileIdentity &identity, std::shared_ptr<const DecodedPcm> pcm) {
+  auto bytes = pcm->Bytes();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto capacity = capacity_.load(std::memory_order_relaxed);
+  if (bytes > capacity) {
+    return;
+  }
+  auto it = index_.find(identity.path);
+  if (it != index_.end()) {
+    Erase(it->second);
+  }
+  EvictTo(capacity - bytes);
+  entries_.push_front({identity, std::move(pcm)});
+  index_[identity.path] = entries_.begin();
+  bytes_.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+PcmCacheStats PcmCache::Stats() const {
+  PcmCacheStats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  stats.bytes = bytes_.load(std::memory_order_relaxed);
+  stats.capacity_bytes = capacity_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void PcmCache::EvictTo(int64_t capacity) {
+  while (!entries_.empty() && bytes_.load(std::memory_order_relaxed) > capacity) {
+    Erase(std::prev(entries_.end()));
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void PcmCache::Erase(std::list<Entry>::iterator entry) {
+  bytes_.fetch_sub(entry->pcm->Bytes(), std::memory_order_relaxed);
+  index_.erase(entry->identity.path);
+  entries_.erase(entry);
+}
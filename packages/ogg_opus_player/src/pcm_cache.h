@@ -0,0 +1,113 @@
+//
+// Process wide cache of decoded pcm, replays of a file skip opusfile.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__PCM_CACHE_H_
+#define OGG_OPUS_PLAYER_LIBRARY__PCM_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "file_identity.h"
+#include "ogg/opus.h"
+
+// The whole pcm of a stream, in the sample type it was decoded to. Only
+// the vector of that type is filled. Immutable once it is cached.
+struct DecodedPcm {
+  int channels = 1;
+  int64_t frames = 0;
+  bool is_float = false;
+  std::vector<opus_int16> int16_samples;
+  std::vector<float> float_samples;
+
+  template<typename T>
+  std::vector<T> &Samples();
+
+  template<typename T>
+  const std::vector<T> &Samples() const { return const_cast<DecodedPcm *>(this)->Samples<T>(); }
+
+  int64_t Bytes() const {
+    return int64_t(int16_samples.capacity() * sizeof(opus_int16) + float_samples.capacity() * sizeof(float));
+  }
+};
+
+template<>
+inline std::vector<opus_int16> &DecodedPcm::Samples<opus_int16>() { return int16_samples; }
+
+template<>
+inline std::vector<float> &DecodedPcm::Samples<float>() { return float_samples; }
+
+struct PcmCacheStats {
+  int64_t hits;
+  int64_t misses;
+  int64_t evictions;
+  int64_t bytes;
+  int64_t capacity_bytes;
+};
+
+// Least recently used decoded pcm of files, bounded by a byte budget. A miss
+// decodes the file as usual and caches its pcm once it was decoded from the
+// first to the last frame, see OggOpusReader.
+//
+// Entries are shared, an evicted entry stays alive until the readers still
+// playing it are destroyed, the budget only bounds what the cache holds on
+// to by itself.
+class PcmCache {
+
+ public:
+  static const int64_t kDefaultCapacityBytes = 32 * 1024 * 1024;
+
+  static PcmCache *Instance();
+
+  // evicts entries until the cache fits |bytes|, 0 disables the cache.
+  void SetCapacity(int64_t bytes);
+
+  // true if the pcm of a stream of |bytes| may be cached at all, misses do
+  // not keep the pcm of streams that do not fit.
+  bool Admits(int64_t bytes) const;
+
+  // the pcm of |identity|, null on a miss or if the cache is disabled. a
+  // stale entry of the same path is dropped.
+  std::shared_ptr<const DecodedPcm> Lookup(const FileIdentity &identity);
+
+  void Insert(const FileIdentity &identity, std::shared_ptr<const DecodedPcm> pcm);
+
+  // lock-free, may be polled from any thread.
+  PcmCacheStats Stats() const;
+
+ private:
+  PcmCache() = default;
+
+  struct Entry {
+    FileIdentity identity;
+    std::shared_ptr<const DecodedPcm> pcm;
+  };
+
+  std::mutex mutex_;
+  // most recently used first, |index_| maps paths into it.
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+
+  // written with |mutex_| held.
+  std::atomic<int64_t> capacity_{kDefaultCapacityBytes};
+  std::atomic<int64_t> bytes_{0};
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+  std::atomic<int64_t> evictions_{0};
+
+  // |mutex_| held. drop the least recently used entries until |bytes_| fits
+  // |capacity|.
+  void EvictTo(int64_t capacity);
+
+  // |mutex_| held.
+  void Erase(std::list<Entry>::iterator entry);
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__PCM_CACHE_H_
@@ -0,0 +1,103 @@
+//
+// Playback position published by the audio callback.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__PLAYBACK_CLOCK_H_
+#define OGG_OPUS_PLAYER_LIBRARY__PLAYBACK_CLOCK_H_
+
+#include <atomic>
+#include <cstdint>
+
+// The audio callback reports how many source frames it handed to the device
+// and when, any other thread reads the position without taking a lock.
+//
+// The position is interpolated over the duration of the last device buffer
+// and clamped to its end, so it is monotonic and never runs ahead of the
+// samples that were actually produced. Writes are published with a sequence
+// lock, readers retry if they raced with the audio callback.
+class PlaybackClock {
+
+ public:
+  PlaybackClock();
+
+  // Audio thread only. |frames| source frames were handed to the device at
+  // |timestamp|, they take |duration| ticks to play.
+  void Advance(int64_t frames, uint64_t timestamp, uint64_t duration);
+
+  // Audio thread only. Jump to |position| source frames, e.g. after a seek.
+  void Reset(int64_t position, uint64_t timestamp);
+
+  // Any thread. Position in source frames at |now|.
+  int64_t Position(uint64_t now) const;
+
+ private:
+  std::atomic<uint32_t> sequence_;
+
+  // frames played before the last device buffer.
+  std::atomic<int64_t> base_;
+  // frames in the last device buffer.
+  std::atomic<int64_t> frames_;
+  std::atomic<uint64_t> timestamp_;
+  std::atomic<uint64_t> duration_;
+
+  void BeginWrite();
+  void EndWrite();
+
+};
+
+inline PlaybackClock::PlaybackClock()
+    : sequence_(0), base_(0), frames_(0), timestamp_(0), duration_(0) {
+}
+
+inline void PlaybackClock::BeginWrite() {
+  sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+inline void PlaybackClock::EndWrite() {
+  sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+inline void PlaybackClock::Advance(int64_t frames, uint64_t timestamp, uint64_t duration) {
+  BeginWrite();
+  base_.store(base_.load(std::memory_order_relaxed) + frames_.load(std::memory_order_relaxed),
+              std::memory_order_relaxed);
+  frames_.store(frames, std::memory_order_relaxed);
+  timestamp_.store(timestamp, std::memory_order_relaxed);
+  duration_.store(duration, std::memory_order_relaxed);
+  EndWrite();
+}
+
+inline void PlaybackClock::Reset(int64_t position, uint64_t timestamp) {
+  BeginWrite();
+  base_.store(position, std::memory_order_relaxed);
+  frames_.store(0, std::memory_order_relaxed);
+  timestamp_.store(timestamp, std::memory_order_relaxed);
+  duration_.store(0, std::memory_order_relaxed);
+  EndWrite();
+}
+
+inline int64_t PlaybackClock::Position(uint64_t now) const {
+  int64_t base, frames;
+  uint64_t timestamp, duration;
+  uint32_t sequence;
+  do {
+    sequence = sequence_.load(std::memory_order_acquire);
+    base = base_.load(std::memory_order_relaxed);
+    frames = frames_.load(std::memory_order_relaxed);
+    timestamp = timestamp_.load(std::memory_order_relaxed);
+    duration = duration_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((sequence & 1) || sequence != sequence_.load(std::memory_order_relaxed));
+
+  if (now <= timestamp || frames <= 0) {
+    return base;
+  }
+  auto elapsed = now - timestamp;
+  if (elapsed >= duration) {
+    return base + frames;
+  }
+  return base + int64_t(double(frames) * double(elapsed) / double(duration));
+}
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__PLAYBACK_CLOCK_H_
@@ -0,0 +1,146 @@
+//
+// Pre-initialized playback state, pooled to keep player creation cheap.
+//
+
+#include "playback_context.h"
+
+#include <algorithm>
+
+PlaybackContext::PlaybackContext(int channels, const AudioOutputSpec &spec)
+    : channels(channels),
+      spec(spec),
+      sonic_stream(sonicCreateStream(spec.sample_rate, channels)),
+      resampler(spec.sample_rate == kOpusSampleRate
+                ? nullptr : std::make_unique<PolyphaseResampler>(kOpusSampleRate, spec.sample_rate, channels)),
+      int16_buffers(channels, spec, resampler.get(), !IsFloat()),
+      float_buffers(channels, spec, resampler.get(), IsFloat()) {
+  PrimeSonicStream();
+}
+
+PlaybackContext::~PlaybackContext() {
+  if (sonic_stream) {
+    sonicDestroyStream(sonic_stream);
+  }
+}
+
+void PlaybackContext::Reset() {
+  DrainSonicStream();
+  sonicSetSpeed(sonic_stream, 1.0f);
+  if (resampler) {
+    resampler->Reset();
+  }
+  int16_buffers.pcm_buffer.Clear();
+  float_buffers.pcm_buffer.Clear();
+}
+
+bool PlaybackContext::Matches(int channels, const AudioOutputSpec &spec) const {
+  return this->channels == channels
+      && this->spec.sample_rate == spec.sample_rate
+      && this->spec.channels == spec.channels
+      && this->spec.frames_per_buffer == spec.frames_per_buffer
+      && this->spec.format == spec.format;
+}
+
+size_t PlaybackContext::PcmWritePosition() const {
+  return IsFloat() ? float_buffers.pcm_buffer.WritePosition() : int16_buffers.pcm_buffer.WritePosition();
+}
+
+size_t PlaybackContext::PcmCapacity() const {
+  return IsFloat() ? float_buffers.pcm_buffer.Capacity() : int16_buffers.pcm_buffer.Capacity();
+}
+
+void PlaybackContext::DiscardPcmUntil(size_t position) {
+  if (IsFloat()) {
+    float_buffers.pcm_buffer.DiscardUntil(position);
+  } else {
+    int16_buffers.pcm_buffer.DiscardUntil(position);
+  }
+}
+
+void PlaybackContext::DrainSonicStream() {
+  sonicFlushStream(sonic_stream);
+  auto frames = spec.frames_per_buffer;
+  if (IsFloat()) {
+    while (sonicReadFloatFromStream(sonic_stream, float_buffers.callback_buffer.data(), frames) > 0) {
+    }
+  } else {
+    while (sonicReadShortFromStream(sonic_stream, int16_buffers.callback_buffer.data(), frames) > 0) {
+    }
+  }
+}
+
+// sonic grows its internal buffers on demand, which would be a realloc inside
+// the audio callback. push silence through it at the extreme rates with the
+// largest write the callback ever makes, and flush once, so every buffer
+// reaches its steady state size before playback starts.
+void PlaybackContext::PrimeSonicStream() {
+  auto frames = spec.frames_per_buffer;
+  std::vector<opus_int16> silence(frames * channels, 0);
+  for (auto speed : {kMinPlaybackRate, kMaxPlaybackRate, 1.0f}) {
+    sonicSetSpeed(sonic_stream, speed);
+    for (int i = 0; i < 8; ++i) {
+      sonicWriteShortToStream(sonic_stream, silence.data(), frames);
+      while (sonicReadShortFromStream(sonic_stream, silence.data(), frames) > 0) {
+      }
+    }
+    sonicWriteShortToStream(sonic_stream, silence.data(), frames);
+    sonicFlushStream(sonic_stream);
+    while (sonicReadShortFromStream(sonic_stream, silence.data(), frames) > 0) {
+    }
+  }
+}
+
+PlaybackContextPool *PlaybackContextPool::Instance() {
+  static auto *pool = new PlaybackContextPool();
+  return pool;
+}
+
+bool PlaybackContextPool::WarmUp(int count, int channels) {
+  auto *mixer = AudioMixer::Instance();
+  if (!mixer->EnsureOpened()) {
+    return false;
+  }
+  const auto &spec = mixer->spec();
+  count = std::min(count, int(kMaxIdleContexts));
+
+  int idle;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle = int(std::count_if(idle_contexts_.begin(), idle_contexts_.end(),
+                             [&](const std::unique_ptr<PlaybackContext> &context) {
+                               return context->Matches(channels, spec);
+                             }));
+  }
+  // priming sonic takes a while, do it without holding the lock.
+  for (; idle < count; ++idle) {
+    Release(std::make_unique<PlaybackContext>(channels, spec));
+  }
+  return true;
+}
+
+std::unique_ptr<PlaybackContext> PlaybackContextPool::Acquire(int channels) {
+  const auto &spec = AudioMixer::Instance()->spec();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = idle_contexts_.begin(); it != idle_contexts_.end(); ++it) {
+      if ((*it)->Matches(channels, spec)) {
+        auto context = std::move(*it);
+        idle_contexts_.erase(it);
+        return context;
+      }
+    }
+  }
+  return std::make_unique<PlaybackContext>(channels, spec);
+}
+
+void PlaybackContextPool::Release(std::unique_ptr<PlaybackContext> context) {
+  context->Reset();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto idle = std::count_if(idle_contexts_.begin(), idle_contexts_.end(),
+                            [&](const std::unique_ptr<PlaybackContext> &other) {
+                              return other->Matches(context->channels, context->spec);
+                            });
+  if (idle < kMaxIdleContexts) {
+    idle_contexts_.push_back(std::move(context));
+  }
+}
@@ -0,0 +1,146 @@
+//
+// Pre-initialized playback state, pooled to keep player creation cheap.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__PLAYBACK_CONTEXT_H_
+#define OGG_OPUS_PLAYER_LIBRARY__PLAYBACK_CONTEXT_H_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "audio_mixer.h"
+#include "ogg_opus_reader.h"
+#include "polyphase_resampler.h"
+#include "sonic.h"
+#include "spsc_ring_buffer.h"
+
+// How much decoded pcm the decoder thread keeps ahead of the audio callback.
+const int kDecodeAheadMilliseconds = 300;
+
+// Frames decoded by the decoder thread per op_read round, 20ms.
+const int kDecodeChunkFrames = kOpusSampleRate / 50;
+
+// Playback rates sonic is primed for, see PlaybackContext::PrimeSonicStream.
+const float kMinPlaybackRate = 0.5f;
+const float kMaxPlaybackRate = 3.0f;
+
+// The buffers of one sample type, see PlaybackContext. Left empty for the
+// sample type the mixer does not run with.
+template<typename T>
+struct PcmBuffers {
+  PcmBuffers(int channels, const AudioOutputSpec &spec, const PolyphaseResampler *resampler, bool used)
+      : pcm_buffer(used ? size_t(spec.sample_rate) * kDecodeAheadMilliseconds / 1000 * channels : 0),
+        decode_buffer(used ? kDecodeChunkFrames * channels : 0),
+        resample_buffer(used && resampler ? resampler->MaxOutputFrames(kDecodeChunkFrames) * channels : 0),
+        callback_buffer(used ? spec.frames_per_buffer * channels : 0),
+        render_buffer(used ? spec.frames_per_buffer * channels : 0) {}
+
+  // decoded pcm at the device rate, produced by the decoder thread and
+  // consumed by the audio callback.
+  SpscRingBuffer<T> pcm_buffer;
+
+  // |decode_buffer| and |resample_buffer| are only touched by the decoder
+  // thread, the latter is empty if the device runs at the opus rate. |callback_buffer|
+  // moves pcm from |pcm_buffer| to sonic on the audio callback.
+  // |render_buffer| holds the output of sonic if the mixer runs with a
+  // different channel count.
+  std::vector<T> decode_buffer;
+  std::vector<T> resample_buffer;
+  std::vector<T> callback_buffer;
+  std::vector<T> render_buffer;
+
+  // decoder thread only, tracks with a different channel count are decoded
+  // here first. grown on demand.
+  std::vector<T> track_buffer;
+};
+
+// The expensive part of a player: a primed sonic stream and the buffers
+// sized for the mixer spec, so that neither the decoder thread nor the audio
+// callback allocate afterwards.
+class PlaybackContext {
+
+ public:
+  PlaybackContext(int channels, const AudioOutputSpec &spec);
+  ~PlaybackContext();
+
+  PlaybackContext(const PlaybackContext &) = delete;
+  PlaybackContext &operator=(const PlaybackContext &) = delete;
+
+  // Drop the state of the previous player. Only safe while no thread uses
+  // the context.
+  void Reset();
+
+  bool Matches(int channels, const AudioOutputSpec &spec) const;
+
+  bool IsFloat() const { return spec.format == SampleFormat::kFloat32; }
+
+  // the buffers of the sample type of the mixer, opus_int16 or float.
+  template<typename T>
+  PcmBuffers<T> &Buffers();
+
+  // Producer side of the pcm buffer, see SpscRingBuffer.
+  size_t PcmWritePosition() const;
+
+  // samples the pcm buffer holds at most.
+  size_t PcmCapacity() const;
+
+  // Consumer side of the pcm buffer, see SpscRingBuffer.
+  void DiscardPcmUntil(size_t position);
+
+  // flush sonic and throw its output away.
+  void DrainSonicStream();
+
+  const int channels;
+  const AudioOutputSpec spec;
+
+  sonicStream sonic_stream;
+
+  // converts decoded pcm to the device rate on the decoder thread, null if
+  // the device runs at the opus rate.
+  std::unique_ptr<PolyphaseResampler> resampler;
+
+  PcmBuffers<opus_int16> int16_buffers;
+  PcmBuffers<float> float_buffers;
+
+ private:
+  void PrimeSonicStream();
+
+};
+
+template<>
+inline PcmBuffers<opus_int16> &PlaybackContext::Buffers<opus_int16>() { return int16_buffers; }
+
+template<>
+inline PcmBuffers<float> &PlaybackContext::Buffers<float>() { return float_buffers; }
+
+// Process wide pool of idle contexts. Disposed players give their context
+// back, so the next player with the same channel count skips the setup.
+class PlaybackContextPool {
+
+ public:
+  // idle contexts kept per channel count.
+  static const int kMaxIdleContexts = 4;
+
+  static PlaybackContextPool *Instance();
+
+  // Open the mixer device and prepare |count| idle contexts for |channels|.
+  // return false if the device could not be opened.
+  bool WarmUp(int count, int channels);
+
+  // An idle context matching |channels| and the current mixer spec, or a
+  // new one. The mixer device must be open.
+  std::unique_ptr<PlaybackContext> Acquire(int channels);
+
+  // Return a context no thread uses anymore.
+  void Release(std::unique_ptr<PlaybackContext> context);
+
+ private:
+  PlaybackContextPool() = default;
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<PlaybackContext>> idle_contexts_;
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__PLAYBACK_CONTEXT_H_
@@ -0,0 +1,102 @@
+//
+// Lock-free audio callback instrumentation of one player.
+//
+
+#include "playback_stats.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// single writer, a plain load and store is enough and cheaper than a
+// read-modify-write on the audio thread.
+template<typename T>
+inline void Increment(std::atomic<T> &value, T amount) {
+  value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+}
+
+DurationHistogram::DurationHistogram() {
+  for (auto &count : counts_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+}
+
+void DurationHistogram::Add(double microseconds) {
+  auto bucket = 0;
+  for (auto limit = 1.0; microseconds >= limit && bucket < kBuckets - 1; limit *= 2) {
+    bucket++;
+  }
+  Increment(counts_[bucket], 1u);
+}
+
+void DurationHistogram::CopyTo(int64_t *counts) const {
+  for (int i = 0; i < kBuckets; ++i) {
+    counts[i] = counts_[i].load(std::memory_order_relaxed);
+  }
+}
+
+PlaybackStats::PlaybackStats()
+    : callbacks_(0),
+      underruns_(0),
+      periods_(0),
+      duration_sum_(0),
+      duration_max_(0),
+      period_sum_(0),
+      period_max_(0),
+      margin_min_(std::numeric_limits<double>::infinity()),
+      fill_(0),
+      fill_min_(std::numeric_limits<double>::infinity()) {
+}
+
+void PlaybackStats::RecordCallback(double duration_us, double period_us, double margin_us, double fill_ms) {
+  Increment(callbacks_, int64_t(1));
+  Increment(duration_sum_, duration_us);
+  if (duration_us > duration_max_.load(std::memory_order_relaxed)) {
+    duration_max_.store(duration_us, std::memory_order_relaxed);
+  }
+  duration_histogram_.Add(duration_us);
+
+  if (period_us >= 0) {
+    Increment(periods_, int64_t(1));
+    Increment(period_sum_, period_us);
+    if (period_us > period_max_.load(std::memory_order_relaxed)) {
+      period_max_.store(period_us, std::memory_order_relaxed);
+    }
+    period_histogram_.Add(period_us);
+  }
+
+  if (margin_us < margin_min_.load(std::memory_order_relaxed)) {
+    margin_min_.store(margin_us, std::memory_order_relaxed);
+  }
+  margin_histogram_.Add(margin_us);
+
+  fill_.store(fill_ms, std::memory_order_relaxed);
+  if (fill_ms < fill_min_.load(std::memory_order_relaxed)) {
+    fill_min_.store(fill_ms, std::memory_order_relaxed);
+  }
+}
+
+void PlaybackStats::RecordUnderrun() {
+  Increment(underruns_, int64_t(1));
+}
+
+void PlaybackStats::Snapshot(OggOpusPlayerStats *stats, double buffer_capacity_ms) const {
+  auto callbacks = callbacks_.load(std::memory_order_relaxed);
+  auto periods = periods_.load(std::memory_order_relaxed);
+  stats->callbacks = callbacks;
+  stats->underruns = underruns_.load(std::memory_order_relaxed);
+  stats->callback_duration_mean_us = callbacks > 0 ? duration_sum_.load(std::memory_order_relaxed) / callbacks : 0;
+  stats->callback_duration_max_us = duration_max_.load(std::memory_order_relaxed);
+  stats->callback_period_mean_us = periods > 0 ? period_sum_.load(std::memory_order_relaxed) / periods : 0;
+  stats->callback_period_max_us = period_max_.load(std::memory_order_relaxed);
+  stats->deadline_margin_min_us = callbacks > 0 ? margin_min_.load(std::memory_order_relaxed) : 0;
+  stats->buffer_fill_ms = fill_.load(std::memory_order_relaxed);
+  stats->buffer_fill_min_ms = callbacks > 0 ? fill_min_.load(std::memory_order_relaxed) : 0;
+  stats->buffer_capacity_ms = buffer_capacity_ms;
+  duration_histogram_.CopyTo(stats->callback_duration_histogram);
+  period_histogram_.CopyTo(stats->callback_period_histogram);
+  margin_histogram_.CopyTo(stats->deadline_margin_histogram);
+}
@@ -0,0 +1,73 @@
+//
+// Lock-free audio callback instrumentation of one player.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__PLAYBACK_STATS_H_
+#define OGG_OPUS_PLAYER_LIBRARY__PLAYBACK_STATS_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "ogg_opus_player.h"
+
+// Counts durations in power of two buckets of microseconds, see
+// OggOpusPlayerStats. One thread adds, any thread reads.
+class DurationHistogram {
+
+ public:
+  static const int kBuckets = OGG_OPUS_PLAYER_STATS_BUCKETS;
+
+  DurationHistogram();
+
+  // writer thread only, negative durations count as 0.
+  void Add(double microseconds);
+
+  void CopyTo(int64_t *counts) const;
+
+ private:
+  std::atomic<uint32_t> counts_[kBuckets];
+
+};
+
+// Written by the audio callback without locks or read-modify-write
+// operations, read by any thread. A snapshot is not taken atomically, each
+// field is consistent on its own.
+class PlaybackStats {
+
+ public:
+  PlaybackStats();
+
+  // Audio thread only. One render of the player took |duration_us|, |period_us|
+  // after the previous one, and left |margin_us| of the device buffer. The
+  // decoded pcm ahead of the callback was |fill_ms| afterwards. |period_us| is
+  // negative for the first render.
+  void RecordCallback(double duration_us, double period_us, double margin_us, double fill_ms);
+
+  // Audio thread only. The render produced fewer frames than requested.
+  void RecordUnderrun();
+
+  int64_t underruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+  // Any thread.
+  void Snapshot(OggOpusPlayerStats *stats, double buffer_capacity_ms) const;
+
+ private:
+  std::atomic<int64_t> callbacks_;
+  std::atomic<int64_t> underruns_;
+  std::atomic<int64_t> periods_;
+
+  std::atomic<double> duration_sum_;
+  std::atomic<double> duration_max_;
+  std::atomic<double> period_sum_;
+  std::atomic<double> period_max_;
+  std::atomic<double> margin_min_;
+  std::atomic<double> fill_;
+  std::atomic<double> fill_min_;
+
+  DurationHistogram duration_histogram_;
+  DurationHistogram period_histogram_;
+  DurationHistogram margin_histogram_;
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__PLAYBACK_STATS_H_
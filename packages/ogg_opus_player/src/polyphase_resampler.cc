@@ -0,0 +1,250 @@
+//
+// Rational polyphase resampler from the opus rate to the device rate.
+//
+
+#include "polyphase_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OGG_OPUS_RESAMPLER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OGG_OPUS_RESAMPLER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+// input frames deinterleaved per Process() round.
+const int kBlockFrames = 1024;
+
+// passband edge relative to the nyquist frequency of the lower rate, and the
+// kaiser window shape, about 80dB stopband attenuation.
+const double kCutoff = 0.89;
+const double kKaiserBeta = 8.0;
+
+const int kHistoryFrames = PolyphaseResampler::kTapsPerPhase - 1;
+const int kChannelStride = kHistoryFrames + kBlockFrames;
+
+int GreatestCommonDivisor(int a, int b) {
+  while (b != 0) {
+    auto t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+// modified bessel function of the first kind, order 0.
+double BesselI0(double x) {
+  double sum = 1;
+  double term = 1;
+  for (int k = 1; k < 50; ++k) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+    if (term < sum * 1e-12) {
+      break;
+    }
+  }
+  return sum;
+}
+
+// |count| is a multiple of 8.
+inline float DotProduct(const float *a, const float *b, int count) {
+#if defined(OGG_OPUS_RESAMPLER_SSE2)
+  auto sum0 = _mm_setzero_ps();
+  auto sum1 = _mm_setzero_ps();
+  for (int i = 0; i < count; i += 8) {
+    sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  auto sum = _mm_add_ps(sum0, sum1);
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum);
+#elif defined(OGG_OPUS_RESAMPLER_NEON)
+  auto sum0 = vdupq_n_f32(0);
+  auto sum1 = vdupq_n_f32(0);
+  for (int i = 0; i < count; i += 8) {
+    sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+    sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+  auto sum = vaddq_f32(sum0, sum1);
+  auto pair = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+  return vget_lane_f32(vpadd_f32(pair, pair), 0);
+#else
+  float sum = 0;
+  for (int i = 0; i < count; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+#endif
+}
+
+inline float ToFloat(int16_t sample) {
+  return float(sample) * (1.0f / 32768);
+}
+
+inline float ToFloat(float sample) {
+  return sample;
+}
+
+template<typename T>
+inline T FromFloat(float sample);
+
+template<>
+inline int16_t FromFloat<int16_t>(float sample) {
+  auto value = std::lrint(sample * 32768);
+  return int16_t(std::min<long>(INT16_MAX, std::max<long>(INT16_MIN, value)));
+}
+
+template<>
+inline float FromFloat<float>(float sample) {
+  return sample;
+}
+
+}
+
+bool PolyphaseResampler::IsSupported(int input_rate, int output_rate) {
+  if (input_rate <= 0 || output_rate <= 0) {
+    return false;
+  }
+  return output_rate / GreatestCommonDivisor(input_rate, output_rate) <= kMaxPhases;
+}
+
+PolyphaseResampler::PolyphaseResampler(int input_rate, int output_rate, int channels)
+    : channels_(channels),
+      history_(size_t(kChannelStride) * channels, 0) {
+  auto divisor = GreatestCommonDivisor(input_rate, output_rate);
+  up_ = output_rate / divisor;
+  down_ = input_rate / divisor;
+
+  // prototype lowpass at the upsampled rate, |up_| times the input rate.
+  // centered on a whole sample, so Reset() can start exactly at the delay.
+  auto length = kTapsPerPhase * up_;
+  auto center = double((length - 1) / 2);
+  auto cutoff = kCutoff * 0.5 * std::min(input_rate, output_rate) / (double(input_rate) * up_);
+  std::vector<double> prototype(length);
+  for (int n = 0; n < length; ++n) {
+    auto x = n - center;
+    auto sinc = x == 0 ? 1.0 : std::sin(2 * kPi * cutoff * x) / (2 * kPi * cutoff * x);
+    auto r = x / (length / 2.0);
+    auto window = BesselI0(kKaiserBeta * std::sqrt(std::max(0.0, 1 - r * r))) / BesselI0(kKaiserBeta);
+    prototype[n] = 2 * cutoff * sinc * window;
+  }
+
+  // split into phases, each normalized to unity dc gain so the phases do not
+  // modulate the level.
+  filter_bank_.resize(size_t(length));
+  for (int phase = 0; phase < up_; ++phase) {
+    double sum = 0;
+    for (int tap = 0; tap < kTapsPerPhase; ++tap) {
+      sum += prototype[phase + tap * up_];
+    }
+    auto *filter = filter_bank_.data() + phase * kTapsPerPhase;
+    for (int tap = 0; tap < kTapsPerPhase; ++tap) {
+      filter[kTapsPerPhase - 1 - tap] = float(prototype[phase + tap * up_] / sum);
+    }
+  }
+  Reset();
+}
+
+int PolyphaseResampler::MaxOutputFrames(int input_frames) const {
+  auto blocks = (input_frames + kBlockFrames - 1) / kBlockFrames;
+  return int((int64_t(input_frames) * up_ + down_ - 1) / down_) + 2 * std::max(1, blocks);
+}
+
+void PolyphaseResampler::Reset() {
+  std::fill(history_.begin(), history_.end(), 0.0f);
+  // start at the center of the prototype filter, which compensates its delay.
+  auto start = (kTapsPerPhase * up_ - 1) / 2;
+  next_input_ = start / up_;
+  phase_ = start % up_;
+  input_frames_ = 0;
+  output_frames_ = 0;
+}
+
+int PolyphaseResampler::Process(const int16_t *input, int input_frames, int16_t *output) {
+  return ProcessSamples(input, input_frames, output);
+}
+
+int PolyphaseResampler::Process(const float *input, int input_frames, float *output) {
+  return ProcessSamples(input, input_frames, output);
+}
+
+int PolyphaseResampler::Flush(int16_t *output) {
+  return FlushSamples(output);
+}
+
+int PolyphaseResampler::Flush(float *output) {
+  return FlushSamples(output);
+}
+
+template<typename T>
+int PolyphaseResampler::ProcessSamples(const T *input, int input_frames, T *output) {
+  auto written = 0;
+  for (int offset = 0; offset < input_frames; offset += kBlockFrames) {
+    auto count = std::min(kBlockFrames, input_frames - offset);
+    written += ProcessBlock(input + offset * channels_, count, output + written * channels_);
+  }
+  input_frames_ += input_frames;
+  output_frames_ += written;
+  return written;
+}
+
+template<typename T>
+int PolyphaseResampler::FlushSamples(T *output) {
+  // zeros push the frames held back by the delay out of the filter.
+  T silence[kTapsPerPhase / 2 * 8] = {};
+  auto written = 0;
+  auto remaining = kTapsPerPhase / 2 * channels_;
+  while (remaining > 0) {
+    auto samples = std::min<int>(remaining, sizeof(silence) / sizeof(T) / channels_ * channels_);
+    written += ProcessBlock(silence, samples / channels_, output + written * channels_);
+    remaining -= samples;
+  }
+  // the delay is not a whole input frame, the zeros may push out one frame
+  // past the end of the input.
+  auto end = (input_frames_ * up_ + down_ - 1) / down_;
+  written = int(std::max<int64_t>(0, std::min<int64_t>(written, end - output_frames_)));
+  Reset();
+  return written;
+}
+
+// |input_frames| at most kBlockFrames.
+template<typename T>
+int PolyphaseResampler::ProcessBlock(const T *input, int input_frames, T *output) {
+  for (int c = 0; c < channels_; ++c) {
+    auto *history = history_.data() + c * kChannelStride + kHistoryFrames;
+    for (int i = 0; i < input_frames; ++i) {
+      history[i] = ToFloat(input[i * channels_ + c]);
+    }
+  }
+
+  // the window of an output ends at its newest input frame, which sits at
+  // kHistoryFrames + |next_input_| in |history_|.
+  auto written = 0;
+  while (next_input_ < input_frames) {
+    const auto *filter = filter_bank_.data() + phase_ * kTapsPerPhase;
+    for (int c = 0; c < channels_; ++c) {
+      const auto *window = history_.data() + c * kChannelStride + next_input_;
+      output[written * channels_ + c] = FromFloat<T>(DotProduct(filter, window, kTapsPerPhase));
+    }
+    ++written;
+    phase_ += down_;
+    next_input_ += phase_ / up_;
+    phase_ %= up_;
+  }
+  next_input_ -= input_frames;
+
+  for (int c = 0; c < channels_; ++c) {
+    auto *history = history_.data() + c * kChannelStride;
+    memmove(history, history + input_frames, kHistoryFrames * sizeof(float));
+  }
+  return written;
+}
@@ -0,0 +1,93 @@
+//
+// Rational polyphase resampler from the opus rate to the device rate.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__POLYPHASE_RESAMPLER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__POLYPHASE_RESAMPLER_H_
+
+#include <cstdint>
+#include <vector>
+
+// Converts interleaved pcm from |input_rate| to |output_rate| with a Kaiser
+// windowed sinc, upsampled by |up| and decimated by |down|, the reduced
+// ratio of the two rates. The filter bank, one filter per phase, is computed
+// once in the constructor, Process() only runs dot products over it.
+//
+// The filter delay is compensated, output frame n lines up with input frame
+// n * input_rate / output_rate, so positions convert with the plain ratio.
+// Flush() pushes the last input frames out at the end of the stream.
+//
+// Not thread safe, owned by the decoder thread.
+class PolyphaseResampler {
+
+ public:
+  // taps of every phase filter, a multiple of 8 for the simd dot product.
+  static const int kTapsPerPhase = 48;
+
+  // ratios with more phases are left to SDL, see IsSupported().
+  static const int kMaxPhases = 320;
+
+  // false if the reduced ratio needs more than kMaxPhases filters.
+  static bool IsSupported(int input_rate, int output_rate);
+
+  PolyphaseResampler(int input_rate, int output_rate, int channels);
+
+  PolyphaseResampler(const PolyphaseResampler &) = delete;
+  PolyphaseResampler &operator=(const PolyphaseResampler &) = delete;
+
+  // Upper bound of the frames Process() writes for |input_frames|.
+  int MaxOutputFrames(int input_frames) const;
+
+  // Resample |input_frames| interleaved frames to |output|, which must hold
+  // MaxOutputFrames(input_frames) frames. All input is consumed, return the
+  // count of frames written.
+  int Process(const int16_t *input, int input_frames, int16_t *output);
+  int Process(const float *input, int input_frames, float *output);
+
+  // Write the frames still held back by the filter delay and Reset(), up to
+  // the output frame of the last input frame, so the stream is resampled to
+  // exactly ceil(input frames * output_rate / input_rate) frames. |output|
+  // must hold MaxOutputFrames(kTapsPerPhase) frames.
+  int Flush(int16_t *output);
+  int Flush(float *output);
+
+  // Forget all input, e.g. after a seek.
+  void Reset();
+
+  int channels() const { return channels_; }
+
+ private:
+  int up_;
+  int down_;
+  int channels_;
+
+  // |up_| filters of kTapsPerPhase taps, reversed so each output is a dot
+  // product over consecutive input frames.
+  std::vector<float> filter_bank_;
+
+  // planar, per channel the last kTapsPerPhase - 1 input frames followed by
+  // room for kBlockFrames new ones.
+  std::vector<float> history_;
+
+  // newest input frame the next output reads, relative to the frames not
+  // yet added to |history_|, and its phase.
+  int next_input_ = 0;
+  int phase_ = 0;
+
+  // frames processed and written since the last Reset(), Flush() stops at
+  // the frame of the last input.
+  int64_t input_frames_ = 0;
+  int64_t output_frames_ = 0;
+
+  template<typename T>
+  int ProcessBlock(const T *input, int input_frames, T *output);
+
+  template<typename T>
+  int ProcessSamples(const T *input, int input_frames, T *output);
+
+  template<typename T>
+  int FlushSamples(T *output);
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__POLYPHASE_RESAMPLER_H_
@@ -0,0 +1,98 @@
+//
+// Byte streams that are still being downloaded while they are played.
+//
+
+#include "progressive_stream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+constexpr std::chrono::milliseconds ProgressiveStream::kWaitInterval;
+
+int ProgressiveStream::Read(unsigned char *buffer, int size) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!cancelled_) {
+    // check before reading, bytes written right before Finish() must not
+    // be mistaken for the end of the stream.
+    auto finished = finished_;
+    auto read = ReadAvailable(buffer, size);
+    if (read != 0 || finished) {
+      return read;
+    }
+    if (waiting_callback_) {
+      lock.unlock();
+      waiting_callback_();
+      lock.lock();
+    }
+    if (!cancelled_ && !finished_) {
+      condition_.wait_for(lock, kWaitInterval);
+    }
+  }
+  return 0;
+}
+
+void ProgressiveStream::Finish() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  finished_ = true;
+  condition_.notify_all();
+}
+
+void ProgressiveStream::Cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cancelled_ = true;
+  condition_.notify_all();
+}
+
+void ProgressiveStream::SetWaitingCallback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  waiting_callback_ = std::move(callback);
+}
+
+void ByteQueueStream::Append(const unsigned char *data, size_t length) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // drop the bytes already read before growing the queue.
+  if (read_offset_ > 0 && read_offset_ >= bytes_.size() / 2) {
+    bytes_.erase(bytes_.begin(), bytes_.begin() + long(read_offset_));
+    read_offset_ = 0;
+  }
+  bytes_.insert(bytes_.end(), data, data + length);
+  NotifyLocked();
+}
+
+int ByteQueueStream::ReadAvailable(unsigned char *buffer, int size) {
+  auto count = std::min(size_t(std::max(0, size)), bytes_.size() - read_offset_);
+  if (count == 0) {
+    return 0;
+  }
+  memcpy(buffer, bytes_.data() + read_offset_, count);
+  read_offset_ += count;
+  return int(count);
+}
+
+GrowingFileStream::GrowingFileStream(const char *file_path)
+    : file_path_(file_path), file_callbacks_() {
+}
+
+GrowingFileStream::~GrowingFileStream() {
+  if (file_) {
+    file_callbacks_.close(file_);
+  }
+}
+
+int GrowingFileStream::ReadAvailable(unsigned char *buffer, int size) {
+  if (!file_) {
+    // the download may not have created the file yet.
+    file_ = op_fopen(&file_callbacks_, file_path_.c_str(), "rb");
+    if (!file_) {
+      return 0;
+    }
+  }
+  auto read = file_callbacks_.read(file_, buffer, size);
+  if (read == 0) {
+    // op_fopen streams are stdio FILEs, clear the sticky end of file flag
+    // so the next read sees bytes appended in the meantime.
+    clearerr(static_cast<FILE *>(file_));
+  }
+  return read;
+}
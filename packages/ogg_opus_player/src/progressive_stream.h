@@ -0,0 +1,111 @@
+//
+// Byte streams that are still being downloaded while they are played.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__PROGRESSIVE_STREAM_H_
+#define OGG_OPUS_PLAYER_LIBRARY__PROGRESSIVE_STREAM_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ogg_opus_reader.h"
+
+// A stream whose end is not known yet. Read() blocks until more bytes
+// arrive instead of reporting the end of the stream, so opusfile never sees
+// a premature end. It only returns 0 once Finish() was called and every byte
+// was read, or after Cancel().
+//
+// Read() is meant to run on the decoder thread, the other methods may be
+// called from any thread.
+class ProgressiveStream : public OggOpusStream {
+
+ public:
+  int Read(unsigned char *buffer, int size) override;
+
+  // no more bytes will arrive.
+  void Finish();
+
+  // unblock Read() for good, e.g. before the player is destroyed.
+  void Cancel();
+
+  // append bytes to the stream. only byte queue streams take bytes, the
+  // others ignore them, e.g. growing files are appended to by their writer.
+  virtual void Append(const unsigned char * /*data*/, size_t /*length*/) {}
+
+  // called on the reading thread about every |kWaitInterval| while Read()
+  // waits for more bytes.
+  void SetWaitingCallback(std::function<void()> callback);
+
+  static constexpr std::chrono::milliseconds kWaitInterval{20};
+
+ protected:
+  // read the bytes available right now, without blocking. called with
+  // |mutex_| held.
+  virtual int ReadAvailable(unsigned char *buffer, int size) = 0;
+
+  // wake up a waiting Read(). call with |mutex_| held.
+  void NotifyLocked() { condition_.notify_all(); }
+
+  std::mutex mutex_;
+
+ private:
+  std::condition_variable condition_;
+  bool finished_ = false;
+  bool cancelled_ = false;
+  std::function<void()> waiting_callback_;
+
+};
+
+// Reads a progressive stream owned by someone else, who keeps it alive for
+// as long as the reader exists.
+class BorrowedStream : public OggOpusStream {
+
+ public:
+  explicit BorrowedStream(ProgressiveStream *stream) : stream_(stream) {}
+
+  int Read(unsigned char *buffer, int size) override { return stream_->Read(buffer, size); }
+
+ private:
+  ProgressiveStream *stream_;
+
+};
+
+// Bytes pushed by the application, e.g. from a http response. Bytes are
+// dropped once opusfile read them, the stream is not seekable.
+class ByteQueueStream : public ProgressiveStream {
+
+ public:
+  void Append(const unsigned char *data, size_t length) override;
+
+ protected:
+  int ReadAvailable(unsigned char *buffer, int size) override;
+
+ private:
+  std::vector<unsigned char> bytes_;
+  size_t read_offset_ = 0;
+
+};
+
+// A file another writer is still appending to. The file does not need to
+// exist yet, it is polled every |kWaitInterval| until Finish() is called.
+class GrowingFileStream : public ProgressiveStream {
+
+ public:
+  explicit GrowingFileStream(const char *file_path);
+  ~GrowingFileStream() override;
+
+ protected:
+  int ReadAvailable(unsigned char *buffer, int size) override;
+
+ private:
+  std::string file_path_;
+  OpusFileCallbacks file_callbacks_;
+  void *file_ = nullptr;
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__PROGRESSIVE_STREAM_H_
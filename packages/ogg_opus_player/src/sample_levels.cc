@@ -0,0 +1,239 @@
+//
+// Peak and rms of blocks of int16 samples, vectorized for the cpu it runs on.
+//
+
+#include "sample_levels.h"
+
+#include <initializer_list>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OGG_OPUS_LEVELS_SSE2
+#include <emmintrin.h>
+#endif
+
+// the avx2 kernel is compiled for avx2 on its own and only called if the
+// cpu supports it, the rest of the library keeps the baseline flags.
+#if defined(OGG_OPUS_LEVELS_SSE2) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define OGG_OPUS_LEVELS_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define OGG_OPUS_TARGET_AVX2
+#else
+#define OGG_OPUS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+SampleLevels MeasureScalar(const int16_t *samples, int count) {
+  if (count <= 0) {
+    return {0, 0, 0};
+  }
+  SampleLevels levels = {samples[0], samples[0], 0};
+  for (int i = 0; i < count; ++i) {
+    auto sample = samples[i];
+    levels.min = std::min(levels.min, sample);
+    levels.max = std::max(levels.max, sample);
+    levels.square_sum += int32_t(sample) * int32_t(sample);
+  }
+  return levels;
+}
+
+#if defined(OGG_OPUS_LEVELS_SSE2)
+
+// The squares of a pair of samples add up to at most 2^31, which only fits
+// the lanes of _mm_madd_epi16 unsigned. Their low and high 16 bits are
+// summed apart in 32 bit lanes, which can not overflow before
+// kMaxSplitIterations, and combined at the end.
+const int kMaxSplitIterations = 1 << 15;
+
+// reduced in registers, storing the lanes to an array makes compilers keep
+// the running min and max in that array throughout the loop.
+int16_t HorizontalMin(__m128i v) {
+  v = _mm_min_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_min_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  v = _mm_min_epi16(v, _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return int16_t(_mm_cvtsi128_si32(v));
+}
+
+int16_t HorizontalMax(__m128i v) {
+  v = _mm_max_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_max_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  v = _mm_max_epi16(v, _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return int16_t(_mm_cvtsi128_si32(v));
+}
+
+SampleLevels MeasureSse2(const int16_t *samples, int count) {
+  if (count < 8) {
+    return MeasureScalar(samples, count);
+  }
+  const auto low_mask = _mm_set1_epi32(0xffff);
+  auto min = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples));
+  auto max = min;
+  int64_t square_sum = 0;
+  int i = 0;
+  while (i + 8 <= count) {
+    auto low = _mm_setzero_si128();
+    auto high = _mm_setzero_si128();
+    auto end = std::min(count - 7, i + 8 * kMaxSplitIterations);
+    for (; i < end; i += 8) {
+      auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+      min = _mm_min_epi16(min, v);
+      max = _mm_max_epi16(max, v);
+      auto squares = _mm_madd_epi16(v, v);
+      low = _mm_add_epi32(low, _mm_and_si128(squares, low_mask));
+      high = _mm_add_epi32(high, _mm_srli_epi32(squares, 16));
+    }
+    uint32_t lows[4], highs[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lows), low);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(highs), high);
+    for (int lane = 0; lane < 4; ++lane) {
+      square_sum += int64_t(lows[lane]) + (int64_t(highs[lane]) << 16);
+    }
+  }
+
+  SampleLevels levels = {HorizontalMin(min), HorizontalMax(max), square_sum};
+  if (i < count) {
+    auto tail = MeasureScalar(samples + i, count - i);
+    levels.min = std::min(levels.min, tail.min);
+    levels.max = std::max(levels.max, tail.max);
+    levels.square_sum += tail.square_sum;
+  }
+  return levels;
+}
+
+#endif
+
+#if defined(OGG_OPUS_LEVELS_AVX2)
+
+OGG_OPUS_TARGET_AVX2 SampleLevels MeasureAvx2(const int16_t *samples, int count) {
+  if (count < 16) {
+    return MeasureSse2(samples, count);
+  }
+  const auto low_mask = _mm256_set1_epi32(0xffff);
+  auto min = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples));
+  auto max = min;
+  int64_t square_sum = 0;
+  int i = 0;
+  while (i + 16 <= count) {
+    auto low = _mm256_setzero_si256();
+    auto high = _mm256_setzero_si256();
+    auto end = std::min(count - 15, i + 16 * kMaxSplitIterations);
+    for (; i < end; i += 16) {
+      auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i));
+      min = _mm256_min_epi16(min, v);
+      max = _mm256_max_epi16(max, v);
+      auto squares = _mm256_madd_epi16(v, v);
+      low = _mm256_add_epi32(low, _mm256_and_si256(squares, low_mask));
+      high = _mm256_add_epi32(high, _mm256_srli_epi32(squares, 16));
+    }
+    uint32_t lows[8], highs[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lows), low);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(highs), high);
+    for (int lane = 0; lane < 8; ++lane) {
+      square_sum += int64_t(lows[lane]) + (int64_t(highs[lane]) << 16);
+    }
+  }
+
+  auto min_halves = _mm_min_epi16(_mm256_castsi256_si128(min), _mm256_extracti128_si256(min, 1));
+  auto max_halves = _mm_max_epi16(_mm256_castsi256_si128(max), _mm256_extracti128_si256(max, 1));
+  SampleLevels levels = {HorizontalMin(min_halves), HorizontalMax(max_halves), square_sum};
+  if (i < count) {
+    auto tail = MeasureSse2(samples + i, count - i);
+    levels.min = std::min(levels.min, tail.min);
+    levels.max = std::max(levels.max, tail.max);
+    levels.square_sum += tail.square_sum;
+  }
+  return levels;
+}
+
+bool CpuSupportsAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  // the cpu has avx2 and the os saves the ymm registers.
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info, 1);
+  const int kOsXsave = 1 << 27;
+  const int kAvx = 1 << 28;
+  if ((info[2] & (kOsXsave | kAvx)) != (kOsXsave | kAvx) || (_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+}
+
+bool IsLevelKernelSupported(LevelKernel kernel) {
+  switch (kernel) {
+    case LevelKernel::kScalar:
+      return true;
+    case LevelKernel::kSse2:
+#if defined(OGG_OPUS_LEVELS_SSE2)
+      return true;
+#else
+      return false;
+#endif
+    case LevelKernel::kAvx2: {
+#if defined(OGG_OPUS_LEVELS_AVX2)
+      static const bool supported = CpuSupportsAvx2();
+      return supported;
+#else
+      return false;
+#endif
+    }
+  }
+  return false;
+}
+
+LevelKernel BestLevelKernel() {
+  static const auto best = [] {
+    for (auto kernel : {LevelKernel::kAvx2, LevelKernel::kSse2}) {
+      if (IsLevelKernelSupported(kernel)) {
+        return kernel;
+      }
+    }
+    return LevelKernel::kScalar;
+  }();
+  return best;
+}
+
+const char *LevelKernelName(LevelKernel kernel) {
+  switch (kernel) {
+    case LevelKernel::kScalar:
+      return "scalar";
+    case LevelKernel::kSse2:
+      return "sse2";
+    case LevelKernel::kAvx2:
+      return "avx2";
+  }
+  return "unknown";
+}
+
+SampleLevels MeasureLevels(const int16_t *samples, int count) {
+  return MeasureLevels(BestLevelKernel(), samples, count);
+}
+
+SampleLevels MeasureLevels(LevelKernel kernel, const int16_t *samples, int count) {
+  switch (kernel) {
+#if defined(OGG_OPUS_LEVELS_AVX2)
+    case LevelKernel::kAvx2:
+      return MeasureAvx2(samples, count);
+#endif
+#if defined(OGG_OPUS_LEVELS_SSE2)
+    case LevelKernel::kSse2:
+      return MeasureSse2(samples, count);
+#endif
+    default:
+      return MeasureScalar(samples, count);
+  }
+}
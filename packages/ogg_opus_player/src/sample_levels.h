@@ -0,0 +1,41 @@
+//
+// Peak and rms of blocks of int16 samples, vectorized for the cpu it runs on.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__SAMPLE_LEVELS_H_
+#define OGG_OPUS_PLAYER_LIBRARY__SAMPLE_LEVELS_H_
+
+#include <algorithm>
+#include <cstdint>
+
+struct SampleLevels {
+  int16_t min;
+  int16_t max;
+  // exact, a block of 2^33 full scale samples still fits.
+  int64_t square_sum;
+
+  // largest absolute sample, 32768 for a full scale negative sample.
+  int32_t Peak() const { return std::max(-int32_t(min), int32_t(max)); }
+};
+
+enum class LevelKernel {
+  kScalar,
+  kSse2,
+  kAvx2,
+};
+
+// false if the build or the cpu lacks the instructions of |kernel|.
+bool IsLevelKernelSupported(LevelKernel kernel);
+
+// the fastest supported kernel, detected once.
+LevelKernel BestLevelKernel();
+
+const char *LevelKernelName(LevelKernel kernel);
+
+// levels of |count| samples with the fastest kernel, all 0 if |count| is 0.
+SampleLevels MeasureLevels(const int16_t *samples, int count);
+
+// the same with |kernel|, which must be supported.
+SampleLevels MeasureLevels(LevelKernel kernel, const int16_t *samples, int count);
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__SAMPLE_LEVELS_H_
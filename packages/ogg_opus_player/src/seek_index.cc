@@ -0,0 +1,343 @@
+//
+// Granule position to byte offset checkpoints of an ogg opus file, seeks
+// jump straight to a page instead of bisecting the file.
+//
+
+#include "seek_index.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "mapped_file_stream.h"
+#include "ogg_opus_reader.h"
+
+namespace {
+
+const char kIndexMagic[4] = {'O', 'O', 'S', 'I'};
+const uint8_t kIndexVersion = 1;
+
+// ogg page header up to the segment table, see RFC 3533.
+const int kPageHeaderBytes = 27;
+const uint8_t kPageContinued = 0x01;
+const uint8_t kPageFirst = 0x02;
+const uint8_t kPageLast = 0x04;
+
+// OpusHead up to the pre-skip, see RFC 7845.
+const int kOpusHeadBytes = 12;
+
+bool ReadFully(OggOpusStream *stream, uint8_t *data, int size) {
+  while (size > 0) {
+    auto read = stream->Read(data, size);
+    if (read <= 0) {
+      return false;
+    }
+    data += read;
+    size -= read;
+  }
+  return true;
+}
+
+uint32_t ReadLittleEndian32(const uint8_t *data) {
+  return uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+}
+
+int64_t ReadLittleEndian64(const uint8_t *data) {
+  return int64_t(uint64_t(ReadLittleEndian32(data)) | uint64_t(ReadLittleEndian32(data + 4)) << 32);
+}
+
+// LEB128, deltas are zigzag encoded first, so small negative values stay
+// short too.
+void WriteVarint(std::vector<uint8_t> *out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(uint8_t(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(uint8_t(value));
+}
+
+bool ReadVarint(const uint8_t **data, const uint8_t *end, uint64_t *value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && *data < end; shift += 7) {
+    auto byte = *(*data)++;
+    *value |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t ZigZag(int64_t value) {
+  return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+  return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+// the file did not change since |index| was built, not even grew.
+bool IsUnchanged(const SeekIndex &index, const FileIdentity &identity) {
+  return index.identity().size == identity.size && index.identity().modified_at == identity.modified_at;
+}
+
+}
+
+std::shared_ptr<const SeekIndex> SeekIndex::Build(OggOpusStream *stream, const FileIdentity &identity,
+                                                  const SeekIndex *previous) {
+  auto index = std::make_shared<SeekIndex>();
+  if (previous && previous->scanned_bytes_ <= identity.size && previous->MatchesPrefix(stream)) {
+    *index = *previous;
+  }
+  index->identity_ = identity;
+  if (!index->Scan(stream)) {
+    return nullptr;
+  }
+  return index;
+}
+
+bool SeekIndex::MatchesPrefix(OggOpusStream *stream) const {
+  if (last_page_offset_ < 0) {
+    return true;
+  }
+  uint8_t header[kPageHeaderBytes];
+  if (stream->Seek(last_page_offset_, SEEK_SET) != 0 || !ReadFully(stream, header, kPageHeaderBytes)) {
+    return false;
+  }
+  return memcmp(header, "OggS", 4) == 0 && ReadLittleEndian64(header + 6) == last_page_granule_
+      && ReadLittleEndian32(header + 14) == serial_;
+}
+
+bool SeekIndex::Scan(OggOpusStream *stream) {
+  if (stream->Seek(0, SEEK_END) != 0) {
+    return false;
+  }
+  auto stream_size = stream->Tell();
+
+  // the granule of the page before, it becomes a checkpoint if the next page
+  // starts with a new packet. -1 if no packet ended on that page.
+  auto pending_granule = last_page_granule_;
+  auto offset = scanned_bytes_;
+  uint8_t header[kPageHeaderBytes + 255];
+  while (offset + kPageHeaderBytes <= stream_size) {
+    if (stream->Seek(offset, SEEK_SET) != 0 || !ReadFully(stream, header, kPageHeaderBytes)) {
+      return false;
+    }
+    if (memcmp(header, "OggS", 4) != 0 || header[4] != 0) {
+      return false;
+    }
+    auto segments = int(header[26]);
+    if (offset + kPageHeaderBytes + segments > stream_size
+        || !ReadFully(stream, header + kPageHeaderBytes, segments)) {
+      break;
+    }
+    int64_t body_bytes = 0;
+    for (int i = 0; i < segments; ++i) {
+      body_bytes += header[kPageHeaderBytes + i];
+    }
+    auto page_bytes = kPageHeaderBytes + segments + body_bytes;
+    if (offset + page_bytes > stream_size) {
+      // the writer of a growing file did not finish the page yet.
+      break;
+    }
+
+    auto flags = header[5];
+    auto granule = ReadLittleEndian64(header + 6);
+    auto serial = ReadLittleEndian32(header + 14);
+    if (flags & kPageFirst) {
+      // a second logical stream, chained or multiplexed.
+      if (last_page_offset_ >= 0) {
+        return false;
+      }
+      uint8_t head[kOpusHeadBytes];
+      if (body_bytes < kOpusHeadBytes || !ReadFully(stream, head, kOpusHeadBytes)
+          || memcmp(head, "OpusHead", 8) != 0) {
+        return false;
+      }
+      serial_ = serial;
+      pre_skip_ = head[10] | head[11] << 8;
+    } else if (last_page_offset_ < 0 || serial != serial_) {
+      return false;
+    }
+
+    // granule 0 belongs to the header pages, decoding never starts there.
+    if (pending_granule > 0 && !(flags & kPageContinued)) {
+      if (!checkpoints_.empty() && pending_granule < checkpoints_.back().granule) {
+        return false;
+      }
+      checkpoints_.push_back({pending_granule, offset});
+    }
+    pending_granule = (flags & kPageLast) ? -1 : granule;
+    last_page_offset_ = offset;
+    last_page_granule_ = granule;
+    offset += page_bytes;
+    scanned_bytes_ = offset;
+  }
+  return true;
+}
+
+const SeekCheckpoint *SeekIndex::Find(int64_t frame) const {
+  auto granule = frame + pre_skip_;
+  auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), granule - kPrerollFrames,
+                             [](int64_t value, const SeekCheckpoint &checkpoint) {
+                               return value < checkpoint.granule;
+                             });
+  if (it == checkpoints_.begin()) {
+    return nullptr;
+  }
+  --it;
+  if (granule - it->granule > kMaxDecodeFrames) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+bool SeekIndex::Save(const char *index_path) const {
+  std::vector<uint8_t> data(kIndexMagic, kIndexMagic + sizeof(kIndexMagic));
+  data.push_back(kIndexVersion);
+  WriteVarint(&data, uint64_t(identity_.size));
+  WriteVarint(&data, uint64_t(identity_.modified_at));
+  WriteVarint(&data, uint64_t(scanned_bytes_));
+  WriteVarint(&data, serial_);
+  WriteVarint(&data, uint64_t(pre_skip_));
+  WriteVarint(&data, ZigZag(last_page_offset_));
+  WriteVarint(&data, ZigZag(last_page_granule_));
+  WriteVarint(&data, checkpoints_.size());
+  SeekCheckpoint previous = {0, 0};
+  for (const auto &checkpoint : checkpoints_) {
+    WriteVarint(&data, ZigZag(checkpoint.granule - previous.granule));
+    WriteVarint(&data, ZigZag(checkpoint.offset - previous.offset));
+    previous = checkpoint;
+  }
+
+  auto *file = fopen(index_path, "wb");
+  if (!file) {
+    return false;
+  }
+  auto written = fwrite(data.data(), 1, data.size(), file);
+  return fclose(file) == 0 && written == data.size();
+}
+
+std::shared_ptr<const SeekIndex> SeekIndex::Load(const char *index_path) {
+  auto *file = fopen(index_path, "rb");
+  if (!file) {
+    return nullptr;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buffer[4096];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + read);
+  }
+  fclose(file);
+
+  if (data.size() < sizeof(kIndexMagic) + 1 || memcmp(data.data(), kIndexMagic, sizeof(kIndexMagic)) != 0
+      || data[sizeof(kIndexMagic)] != kIndexVersion) {
+    return nullptr;
+  }
+  const auto *position = data.data() + sizeof(kIndexMagic) + 1;
+  const auto *end = data.data() + data.size();
+  uint64_t values[8];
+  for (auto &value : values) {
+    if (!ReadVarint(&position, end, &value)) {
+      return nullptr;
+    }
+  }
+  auto index = std::make_shared<SeekIndex>();
+  index->identity_.size = int64_t(values[0]);
+  index->identity_.modified_at = int64_t(values[1]);
+  index->scanned_bytes_ = int64_t(values[2]);
+  index->serial_ = uint32_t(values[3]);
+  index->pre_skip_ = int(values[4]);
+  index->last_page_offset_ = UnZigZag(values[5]);
+  index->last_page_granule_ = UnZigZag(values[6]);
+  // every checkpoint takes at least 2 bytes, do not trust a larger count.
+  auto count = values[7];
+  if (count > uint64_t(end - position) / 2) {
+    return nullptr;
+  }
+  index->checkpoints_.reserve(size_t(count));
+  SeekCheckpoint checkpoint = {0, 0};
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t granule_delta, offset_delta;
+    if (!ReadVarint(&position, end, &granule_delta) || !ReadVarint(&position, end, &offset_delta)) {
+      return nullptr;
+    }
+    checkpoint.granule += UnZigZag(granule_delta);
+    checkpoint.offset += UnZigZag(offset_delta);
+    index->checkpoints_.push_back(checkpoint);
+  }
+  return index;
+}
+
+SeekIndexRegistry *SeekIndexRegistry::Instance() {
+  static auto *registry = new SeekIndexRegistry();
+  return registry;
+}
+
+std::shared_ptr<const SeekIndex> SeekIndexRegistry::Build(const char *file_path, const char *index_path) {
+  FileIdentity identity;
+  if (!GetFileIdentity(file_path, &identity)) {
+    return nullptr;
+  }
+  Entry entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(identity.path);
+    if (it != entries_.end()) {
+      entry = it->second;
+    }
+  }
+  if (index_path) {
+    entry.index_path = index_path;
+    if (!entry.index) {
+      entry.index = SeekIndex::Load(index_path);
+    }
+  }
+  return Update(identity, entry.index.get(), entry.index_path);
+}
+
+std::shared_ptr<const SeekIndex> SeekIndexRegistry::Lookup(const FileIdentity &identity) {
+  Entry entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(identity.path);
+    if (it == entries_.end()) {
+      return nullptr;
+    }
+    entry = it->second;
+  }
+  if (IsUnchanged(*entry.index, identity)) {
+    return entry.index;
+  }
+  return Update(identity, entry.index.get(), entry.index_path);
+}
+
+std::shared_ptr<const SeekIndex> SeekIndexRegistry::Update(const FileIdentity &identity, const SeekIndex *previous,
+                                                           const std::string &index_path) {
+  std::shared_ptr<const SeekIndex> index;
+  if (previous && IsUnchanged(*previous, identity)) {
+    // a sidecar of the file as it is, loaded after a restart.
+    auto unchanged = std::make_shared<SeekIndex>(*previous);
+    unchanged->identity_ = identity;
+    index = std::move(unchanged);
+  } else {
+    // the file may still be written, it is only mapped if the app opted in.
+    auto stream = OpenFileStream(identity.path.c_str());
+    if (stream) {
+      index = SeekIndex::Build(stream.get(), identity, previous);
+    }
+    if (index && !index_path.empty() && !index->Save(index_path.c_str())) {
+      std::cerr << "failed to write seek index: " << index_path << std::endl;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index) {
+    entries_[identity.path] = {index, index_path};
+  } else {
+    entries_.erase(identity.path);
+  }
+  return index;
+}
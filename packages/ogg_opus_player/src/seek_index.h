@@ -0,0 +1,125 @@
+//
+// Granule position to byte offset checkpoints of an ogg opus file, seeks
+// jump straight to a page instead of bisecting the file.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__SEEK_INDEX_H_
+#define OGG_OPUS_PLAYER_LIBRARY__SEEK_INDEX_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "file_identity.h"
+
+class OggOpusStream;
+
+// Decoding the page at |offset| starts at |granule|, no packet of the page
+// continues one of the page before.
+struct SeekCheckpoint {
+  int64_t granule;
+  int64_t offset;
+};
+
+// The checkpoints of every page of a file with a single logical opus stream,
+// chained and multiplexed files are not indexed. Immutable once built, an
+// update of a grown file builds a new index.
+class SeekIndex {
+
+ public:
+  // opus needs 80ms of decoded audio to converge after a jump, the decoder
+  // starts at least this many frames before the seek target.
+  static const int64_t kPrerollFrames = 3840;
+
+  // jumps that would decode more than this before reaching the target, e.g.
+  // past the indexed part of a growing file, are left to opusfile.
+  static const int64_t kMaxDecodeFrames = 10 * 48000;
+
+  // Scan the ogg pages of |stream|, which is |identity|. Only the bytes past
+  // |previous| are scanned if it indexed the start of the same file, e.g.
+  // before the file grew. return null if the stream is not a single opus
+  // logical stream.
+  static std::shared_ptr<const SeekIndex> Build(OggOpusStream *stream, const FileIdentity &identity,
+                                                const SeekIndex *previous);
+
+  // read an index written by Save(), null if it is missing or malformed.
+  static std::shared_ptr<const SeekIndex> Load(const char *index_path);
+
+  // write the index to |index_path| in a compact binary format, about 4
+  // bytes per page. return false on error.
+  bool Save(const char *index_path) const;
+
+  // the checkpoint to decode from to reach pcm frame |frame| with enough
+  // preroll, null if the index does not cover the frame.
+  const SeekCheckpoint *Find(int64_t frame) const;
+
+  // the file as it was when it was scanned.
+  const FileIdentity &identity() const { return identity_; }
+
+  // pcm frame of a checkpoint granule.
+  int64_t FrameOf(const SeekCheckpoint &checkpoint) const { return checkpoint.granule - pre_skip_; }
+
+  size_t size() const { return checkpoints_.size(); }
+
+ private:
+  FileIdentity identity_;
+  // end of the last complete page scanned, the next scan starts here.
+  int64_t scanned_bytes_ = 0;
+  uint32_t serial_ = 0;
+  int pre_skip_ = 0;
+  // offset of the last complete page and its granule, checked before an
+  // update to make sure the file only grew. -1 if no page was scanned.
+  int64_t last_page_offset_ = -1;
+  int64_t last_page_granule_ = -1;
+  std::vector<SeekCheckpoint> checkpoints_;
+
+  friend class SeekIndexRegistry;
+
+  // false if |stream| no longer holds the last page scanned.
+  bool MatchesPrefix(OggOpusStream *stream) const;
+
+  // scan the pages from |scanned_bytes_| on, return false if the stream is
+  // not a single opus logical stream.
+  bool Scan(OggOpusStream *stream);
+
+};
+
+// Indexes of the files the app asked to index, shared by their readers.
+class SeekIndexRegistry {
+
+ public:
+  static SeekIndexRegistry *Instance();
+
+  // Index |file_path|, reusing the index at |index_path| or the one built
+  // before if they match the file, and keep it for the readers of the file.
+  // The index is written to |index_path| if it is not null. return null if
+  // the file can not be indexed.
+  std::shared_ptr<const SeekIndex> Build(const char *file_path, const char *index_path);
+
+  // the index of the file of |identity|, null if none was built. the part
+  // of a file that grew since it was indexed is scanned first.
+  std::shared_ptr<const SeekIndex> Lookup(const FileIdentity &identity);
+
+ private:
+  SeekIndexRegistry() = default;
+
+  struct Entry {
+    std::shared_ptr<const SeekIndex> index;
+    // sidecar written after updates, empty if none.
+    std::string index_path;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+
+  // scan |identity| starting from |previous|, store and save the result.
+  // called without |mutex_| held, scanning reads the file.
+  std::shared_ptr<const SeekIndex> Update(const FileIdentity &identity, const SeekIndex *previous,
+                                          const std::string &index_path);
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__SEEK_INDEX_H_
@@ -118,13 +118,25 @@ static short sincTable[SINC_TABLE_SIZE] = {
    microcontrollers. */
 #ifndef SONIC_NO_MALLOC
 
+/* If SONIC_ALLOCATION_HOOK is defined, it names a function that is called
+   before every calloc/realloc, so the caller can track allocations. */
+#ifdef SONIC_ALLOCATION_HOOK
+void SONIC_ALLOCATION_HOOK(void);
+#endif
+
 /* Just call calloc. */
 static void *sonicCalloc(int num, int size) {
+#ifdef SONIC_ALLOCATION_HOOK
+  SONIC_ALLOCATION_HOOK();
+#endif
   return calloc(num, size);
 }
 
 /* Just call realloc */
 static void *sonicRealloc(void *p, int oldNum, int newNum, int size) {
+#ifdef SONIC_ALLOCATION_HOOK
+  SONIC_ALLOCATION_HOOK();
+#endif
   return realloc(p, newNum * size);
 }
 
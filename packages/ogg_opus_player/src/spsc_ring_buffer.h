@@ -0,0 +1,150 @@
+//
+// Single producer / single consumer lock-free ring buffer.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__SPSC_RING_BUFFER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__SPSC_RING_BUFFER_H_
+
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// A bounded FIFO of trivially copyable elements.
+//
+// Exactly one thread may call the producer side (Write, WriteSpace) and
+// exactly one thread may call the consumer side (Read, ReadAvailable).
+// Neither side ever blocks or allocates, so the consumer side is safe to use
+// from a realtime audio callback.
+template<typename T>
+class SpscRingBuffer {
+
+ public:
+  // The capacity is rounded up to the next power of two.
+  explicit SpscRingBuffer(size_t capacity);
+
+  SpscRingBuffer(const SpscRingBuffer &) = delete;
+  SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+  // Producer side. Returns the number of elements actually written.
+  size_t Write(const T *data, size_t count);
+
+  // Producer side. Number of elements that can be written without overflow.
+  size_t WriteSpace() const;
+
+  // Producer side. Position of the next element to be written, it can be
+  // handed to the consumer to drop everything written before it.
+  size_t WritePosition() const;
+
+  // Consumer side. Returns the number of elements actually read.
+  size_t Read(T *data, size_t count);
+
+  // Consumer side. Number of elements ready to be read.
+  size_t ReadAvailable() const;
+
+  // Consumer side. Drop all elements before |position|, a value returned by
+  // WritePosition(). Does nothing if they were already read.
+  void DiscardUntil(size_t position);
+
+  size_t Capacity() const { return buffer_.size(); }
+
+  // Drop everything. Only safe while neither side is running.
+  void Clear();
+
+ private:
+  std::vector<T> buffer_;
+  size_t mask_;
+
+  alignas(64) std::atomic<size_t> write_index_;
+  alignas(64) std::atomic<size_t> read_index_;
+
+};
+
+inline size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+template<typename T>
+SpscRingBuffer<T>::SpscRingBuffer(size_t capacity)
+    : buffer_(RoundUpToPowerOfTwo(std::max<size_t>(capacity, 2))),
+      mask_(buffer_.size() - 1),
+      write_index_(0),
+      read_index_(0) {
+}
+
+template<typename T>
+size_t SpscRingBuffer<T>::Write(const T *data, size_t count) {
+  auto write = write_index_.load(std::memory_order_relaxed);
+  auto read = read_index_.load(std::memory_order_acquire);
+  count = std::min(count, buffer_.size() - (write - read));
+  if (count == 0) {
+    return 0;
+  }
+  auto offset = write & mask_;
+  auto first = std::min(count, buffer_.size() - offset);
+  memcpy(buffer_.data() + offset, data, first * sizeof(T));
+  if (count > first) {
+    memcpy(buffer_.data(), data + first, (count - first) * sizeof(T));
+  }
+  write_index_.store(write + count, std::memory_order_release);
+  return count;
+}
+
+template<typename T>
+size_t SpscRingBuffer<T>::WriteSpace() const {
+  auto write = write_index_.load(std::memory_order_relaxed);
+  auto read = read_index_.load(std::memory_order_acquire);
+  return buffer_.size() - (write - read);
+}
+
+template<typename T>
+size_t SpscRingBuffer<T>::Read(T *data, size_t count) {
+  auto read = read_index_.load(std::memory_order_relaxed);
+  auto write = write_index_.load(std::memory_order_acquire);
+  count = std::min(count, write - read);
+  if (count == 0) {
+    return 0;
+  }
+  auto offset = read & mask_;
+  auto first = std::min(count, buffer_.size() - offset);
+  memcpy(data, buffer_.data() + offset, first * sizeof(T));
+  if (count > first) {
+    memcpy(data + first, buffer_.data(), (count - first) * sizeof(T));
+  }
+  read_index_.store(read + count, std::memory_order_release);
+  return count;
+}
+
+template<typename T>
+size_t SpscRingBuffer<T>::ReadAvailable() const {
+  auto read = read_index_.load(std::memory_order_relaxed);
+  auto write = write_index_.load(std::memory_order_acquire);
+  return write - read;
+}
+
+template<typename T>
+size_t SpscRingBuffer<T>::WritePosition() const {
+  return write_index_.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+void SpscRingBuffer<T>::DiscardUntil(size_t position) {
+  auto read = read_index_.load(std::memory_order_relaxed);
+  // indices grow monotonically, compare the distance to survive wrap around.
+  if (position - read <= buffer_.size() && position != read) {
+    read_index_.store(position, std::memory_order_release);
+  }
+}
+
+template<typename T>
+void SpscRingBuffer<T>::Clear() {
+  write_index_.store(0, std::memory_order_relaxed);
+  read_index_.store(0, std::memory_order_relaxed);
+}
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__SPSC_RING_BUFFER_H_
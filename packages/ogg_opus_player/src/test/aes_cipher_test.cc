@@ -0,0 +1,329 @@
+//
+// Checks AesCipher against the FIPS-197 and SP 800-38A vectors, and
+// DecryptingStream against a reference encryption of random plaintext.
+//
+// usage: ogg_opus_aes_cipher_test
+// exits with 1 and prints the failed checks if any.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../aes_cipher.h"
+#include "../decrypting_stream.h"
+#include "test_utils.h"
+
+namespace {
+
+const int kBlockSize = AesCipher::kBlockSize;
+
+std::vector<uint8_t> FromHex(const char *hex) {
+  std::vector<uint8_t> bytes;
+  for (size_t i = 0; hex[i] && hex[i + 1]; i += 2) {
+    bytes.push_back(uint8_t(std::stoi(std::string(hex + i, 2), nullptr, 16)));
+  }
+  return bytes;
+}
+
+// a ciphertext file held in memory.
+class MemoryStream : public OggOpusStream {
+ public:
+  explicit MemoryStream(std::vector<uint8_t> bytes) : bytes_(std::move(bytes)) {}
+
+  int Read(unsigned char *buffer, int size) override {
+    auto count = int(std::min<int64_t>(size, int64_t(bytes_.size()) - position_));
+    if (count <= 0) {
+      return 0;
+    }
+    memcpy(buffer, bytes_.data() + position_, size_t(count));
+    position_ += count;
+    return count;
+  }
+
+  bool IsSeekable() const override { return true; }
+
+  int Seek(int64_t offset, int whence) override {
+    auto base = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? position_ : int64_t(bytes_.size());
+    if (base + offset < 0) {
+      return -1;
+    }
+    position_ = base + offset;
+    return 0;
+  }
+
+  int64_t Tell() override { return position_; }
+
+ private:
+  std::vector<uint8_t> bytes_;
+  int64_t position_ = 0;
+};
+
+std::unique_ptr<DecryptingStream> Decrypt(const std::vector<uint8_t> &ciphertext, CipherMode mode,
+                                          const std::vector<uint8_t> &key, const std::vector<uint8_t> &iv) {
+  return std::make_unique<DecryptingStream>(std::make_unique<MemoryStream>(ciphertext), mode,
+                                            key.data(), key.size(), iv.data());
+}
+
+// read |size| bytes in reads of at most |chunk| bytes.
+std::vector<uint8_t> ReadAll(OggOpusStream *stream, int size, int chunk) {
+  std::vector<uint8_t> bytes(static_cast<size_t>(size));
+  auto read = 0;
+  while (read < size) {
+    auto count = stream->Read(bytes.data() + read, std::min(chunk, size - read));
+    if (count <= 0) {
+      break;
+    }
+    read += count;
+  }
+  bytes.resize(size_t(read));
+  return bytes;
+}
+
+// reference encryptions, one block at a time.
+std::vector<uint8_t> EncryptCtr(const std::vector<uint8_t> &plaintext, const std::vector<uint8_t> &key,
+                                const std::vector<uint8_t> &iv) {
+  AesCipher cipher;
+  cipher.SetKey(key.data(), key.size());
+  auto counter = iv;
+  std::vector<uint8_t> ciphertext(plaintext.size());
+  uint8_t keystream[kBlockSize];
+  for (size_t offset = 0; offset < plaintext.size(); offset += kBlockSize) {
+    cipher.EncryptBlock(counter.data(), keystream);
+    for (size_t i = offset; i < std::min(plaintext.size(), offset + kBlockSize); ++i) {
+      ciphertext[i] = plaintext[i] ^ keystream[i - offset];
+    }
+    // increment the whole 128 bit counter.
+    for (int i = kBlockSize - 1; i >= 0 && ++counter[size_t(i)] == 0; --i) {
+    }
+  }
+  return ciphertext;
+}
+
+std::vector<uint8_t> EncryptCbc(std::vector<uint8_t> plaintext, const std::vector<uint8_t> &key,
+                                const std::vector<uint8_t> &iv) {
+  AesCipher cipher;
+  cipher.SetKey(key.data(), key.size());
+  auto padding = kBlockSize - int(plaintext.size() % kBlockSize);
+  plaintext.insert(plaintext.end(), size_t(padding), uint8_t(padding));
+  std::vector<uint8_t> ciphertext(plaintext.size());
+  auto previous = iv;
+  for (size_t offset = 0; offset < plaintext.size(); offset += kBlockSize) {
+    uint8_t block[kBlockSize];
+    for (int i = 0; i < kBlockSize; ++i) {
+      block[i] = plaintext[offset + size_t(i)] ^ previous[size_t(i)];
+    }
+    cipher.EncryptBlock(block, ciphertext.data() + offset);
+    previous.assign(ciphertext.begin() + long(offset), ciphertext.begin() + long(offset) + kBlockSize);
+  }
+  return ciphertext;
+}
+
+std::vector<uint8_t> RandomBytes(std::mt19937 &random, size_t size) {
+  std::vector<uint8_t> bytes(size);
+  for (auto &byte : bytes) {
+    byte = uint8_t(random());
+  }
+  return bytes;
+}
+
+// FIPS-197 appendix C, one block with each key length.
+void TestFips197() {
+  struct Vector {
+    const char *key;
+    const char *ciphertext;
+  };
+  const Vector vectors[] = {
+      {"000102030405060708090a0b0c0d0e0f", "69c4e0d86a7b0430d8cdb78070b4c55a"},
+      {"000102030405060708090a0b0c0d0e0f1011121314151617", "dda97ca4864cdfe06eaf70a0ec0d7191"},
+      {"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", "8ea2b7ca516745bfeafc49904b496089"},
+  };
+  auto plaintext = FromHex("00112233445566778899aabbccddeeff");
+  for (const auto &vector : vectors) {
+    auto key = FromHex(vector.key);
+    auto expected = FromHex(vector.ciphertext);
+    AesCipher cipher;
+    if (!Check(cipher.SetKey(key.data(), key.size()), "fips-197 %zu byte key is accepted", key.size())) {
+      continue;
+    }
+    uint8_t block[kBlockSize];
+    cipher.EncryptBlock(plaintext.data(), block);
+    Check(memcmp(block, expected.data(), kBlockSize) == 0, "fips-197 encrypt with a %zu byte key", key.size());
+    // in place, as the cbc decryption uses it.
+    cipher.DecryptBlock(block, block);
+    Check(memcmp(block, plaintext.data(), kBlockSize) == 0, "fips-197 decrypt with a %zu byte key", key.size());
+  }
+
+  AesCipher cipher;
+  uint8_t key[kBlockSize + 1] = {};
+  Check(!cipher.SetKey(key, sizeof(key)), "a 17 byte key is rejected");
+  Check(!cipher.SetKey(key, 0), "an empty key is rejected");
+}
+
+// SP 800-38A F.5.1 and F.2.1, the aes-128 plaintext of both.
+const char *kSp80038aKey = "2b7e151628aed2a6abf7158809cf4f3c";
+const char *kSp80038aPlaintext =
+    "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+    "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710";
+
+void TestSp80038aCtr() {
+  auto key = FromHex(kSp80038aKey);
+  auto iv = FromHex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");
+  auto ciphertext = FromHex(
+      "874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"
+      "5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee");
+  auto plaintext = FromHex(kSp80038aPlaintext);
+  auto stream = Decrypt(ciphertext, CipherMode::kAesCtr, key, iv);
+  if (!Check(stream->IsValid(), "sp 800-38a ctr stream is valid")) {
+    return;
+  }
+  Check(ReadAll(stream.get(), int(plaintext.size()) + 1, 4096) == plaintext, "sp 800-38a ctr decrypt");
+}
+
+void TestSp80038aCbc() {
+  auto key = FromHex(kSp80038aKey);
+  auto iv = FromHex("000102030405060708090a0b0c0d0e0f");
+  auto ciphertext = FromHex(
+      "7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2"
+      "73bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7");
+  auto plaintext = FromHex(kSp80038aPlaintext);
+  // the vector is not padded, append a block of 16 bytes of PKCS#7 padding
+  // chained to its last block.
+  AesCipher cipher;
+  cipher.SetKey(key.data(), key.size());
+  uint8_t padding[kBlockSize];
+  for (int i = 0; i < kBlockSize; ++i) {
+    padding[i] = uint8_t(kBlockSize) ^ ciphertext[ciphertext.size() - kBlockSize + size_t(i)];
+  }
+  ciphertext.resize(ciphertext.size() + kBlockSize);
+  cipher.EncryptBlock(padding, ciphertext.data() + ciphertext.size() - kBlockSize);
+  Check(EncryptCbc(plaintext, key, iv) == ciphertext, "sp 800-38a cbc encrypt");
+
+  auto stream = Decrypt(ciphertext, CipherMode::kAesCbc, key, iv);
+  if (!Check(stream->IsValid(), "sp 800-38a cbc stream is valid")) {
+    return;
+  }
+  Check(stream->Seek(0, SEEK_END) == 0 && stream->Tell() == int64_t(plaintext.size()),
+        "sp 800-38a cbc padding is stripped");
+  stream->Seek(0, SEEK_SET);
+  Check(ReadAll(stream.get(), int(plaintext.size()) + 1, 4096) == plaintext, "sp 800-38a cbc decrypt");
+}
+
+// the low 64 bits of the counter wrap within the stream, the carry must
+// reach the upper half.
+void TestCtrCarry() {
+  std::mt19937 random(7);
+  auto key = RandomBytes(random, 32);
+  auto iv = FromHex("0123456789abcdeffffffffffffffffd");
+  auto plaintext = RandomBytes(random, 10 * kBlockSize + 5);
+  auto stream = Decrypt(EncryptCtr(plaintext, key, iv), CipherMode::kAesCtr, key, iv);
+  Check(ReadAll(stream.get(), int(plaintext.size()), 4096) == plaintext, "ctr counter carries into the upper half");
+
+  // and across all 128 bits.
+  iv = FromHex("ffffffffffffffffffffffffffffffff");
+  stream = Decrypt(EncryptCtr(plaintext, key, iv), CipherMode::kAesCtr, key, iv);
+  Check(ReadAll(stream.get(), int(plaintext.size()), 4096) == plaintext, "ctr counter wraps around");
+}
+
+// reads of odd sizes from odd offsets, as opusfile does while it seeks.
+void TestUnalignedAccess(CipherMode mode, const char *name) {
+  std::mt19937 random(mode == CipherMode::kAesCtr ? 11 : 13);
+  for (auto key_length : {16, 24, 32}) {
+    auto key = RandomBytes(random, size_t(key_length));
+    auto iv = RandomBytes(random, kBlockSize);
+    for (auto size : {1, 15, 16, 17, 4095, 70001}) {
+      auto plaintext = RandomBytes(random, size_t(size));
+      auto ciphertext = mode == CipherMode::kAesCtr ? EncryptCtr(plaintext, key, iv) : EncryptCbc(plaintext, key, iv);
+      auto stream = Decrypt(ciphertext, mode, key, iv);
+      if (!Check(stream->IsValid(), "%s stream of %d bytes is valid", name, size)) {
+        continue;
+      }
+      Check(stream->Seek(0, SEEK_END) == 0 && stream->Tell() == size, "%s size of %d bytes", name, size);
+      stream->Seek(0, SEEK_SET);
+      Check(ReadAll(stream.get(), size, 7) == plaintext, "%s sequential reads of 7 bytes of %d", name, size);
+
+      auto mismatches = 0;
+      for (int i = 0; i < 200; ++i) {
+        auto offset = int64_t(random() % uint32_t(size));
+        auto count = int(1 + random() % uint32_t(std::min(size, 3 * kBlockSize + 3)));
+        auto whence = int(random() % 3);
+        auto target = whence == SEEK_SET ? offset : whence == SEEK_CUR ? offset - stream->Tell() : offset - size;
+        if (stream->Seek(target, whence) != 0 || stream->Tell() != offset) {
+          mismatches++;
+          continue;
+        }
+        auto expected = std::vector<uint8_t>(plaintext.begin() + long(offset),
+                                             plaintext.begin() + long(std::min<int64_t>(size, offset + count)));
+        if (ReadAll(stream.get(), count, count) != expected) {
+          mismatches++;
+        }
+      }
+      Check(mismatches == 0, "%s %d of 200 random seeks and reads in %d bytes differ", name, mismatches, size);
+
+      uint8_t byte;
+      stream->Seek(0, SEEK_END);
+      Check(stream->Read(&byte, 1) == 0, "%s read at the end of %d bytes", name, size);
+      Check(stream->Seek(-1, SEEK_SET) != 0, "%s seek before the start", name);
+    }
+  }
+}
+
+void TestInvalidCbc() {
+  std::mt19937 random(17);
+  auto key = RandomBytes(random, 16);
+  auto iv = RandomBytes(random, kBlockSize);
+  auto plaintext = RandomBytes(random, 40);
+  auto ciphertext = EncryptCbc(plaintext, key, iv);
+  Check(Decrypt(ciphertext, CipherMode::kAesCbc, key, iv)->IsValid(), "a cbc stream with a valid pad");
+
+  // ciphertext that is not a whole number of blocks, or empty.
+  for (auto size : {size_t(0), size_t(15), ciphertext.size() - 1, ciphertext.size() + 1}) {
+    auto truncated = ciphertext;
+    truncated.resize(size);
+    Check(!Decrypt(truncated, CipherMode::kAesCbc, key, iv)->IsValid(), "a cbc stream of %zu bytes is rejected", size);
+  }
+
+  // re-encrypt the last block with broken pads: 0, larger than a block, and
+  // bytes that do not all hold the pad length.
+  AesCipher cipher;
+  cipher.SetKey(key.data(), key.size());
+  auto *previous = ciphertext.data() + ciphertext.size() - 2 * kBlockSize;
+  auto last_block = [&](const uint8_t *block) {
+    auto broken = ciphertext;
+    uint8_t chained[kBlockSize];
+    for (int i = 0; i < kBlockSize; ++i) {
+      chained[i] = block[i] ^ previous[i];
+    }
+    cipher.EncryptBlock(chained, broken.data() + broken.size() - kBlockSize);
+    return broken;
+  };
+  uint8_t block[kBlockSize];
+  memset(block, 0, sizeof(block));
+  Check(!Decrypt(last_block(block), CipherMode::kAesCbc, key, iv)->IsValid(), "a pad of 0 is rejected");
+  memset(block, kBlockSize + 1, sizeof(block));
+  Check(!Decrypt(last_block(block), CipherMode::kAesCbc, key, iv)->IsValid(), "a pad of 17 is rejected");
+  memset(block, 4, sizeof(block));
+  block[kBlockSize - 3] = 3;
+  Check(!Decrypt(last_block(block), CipherMode::kAesCbc, key, iv)->IsValid(), "a pad of mixed bytes is rejected");
+  memset(block, 16, sizeof(block));
+  Check(Decrypt(last_block(block), CipherMode::kAesCbc, key, iv)->IsValid(), "a whole block of padding is valid");
+
+  Check(!Decrypt(ciphertext, CipherMode(2), key, iv)->IsValid(), "an unknown mode is rejected");
+  auto short_key = RandomBytes(random, 20);
+  Check(!Decrypt(ciphertext, CipherMode::kAesCbc, short_key, iv)->IsValid(), "a 20 byte key is rejected");
+}
+
+}
+
+int main() {
+  TestFips197();
+  TestSp80038aCtr();
+  TestSp80038aCbc();
+  TestCtrCarry();
+  TestUnalignedAccess(CipherMode::kAesCtr, "ctr");
+  TestUnalignedAccess(CipherMode::kAesCbc, "cbc");
+  TestInvalidCbc();
+  return TestResult();
+}
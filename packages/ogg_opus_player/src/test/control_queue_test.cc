@@ -0,0 +1,89 @@
+//
+// Posts numbered commands from several threads while one consumer takes
+// them, every post must be taken at most once and the last one at the end.
+//
+// usage: ogg_opus_control_queue_test
+// exits with 1 and prints the failed checks if any.
+//
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../control_queue.h"
+#include "test_utils.h"
+
+namespace {
+
+const int kProducers = 3;
+const int kPostsPerProducer = 200000;
+
+void TestEachPostIsTakenOnce() {
+  ControlQueue queue;
+  std::atomic<int> running(kProducers);
+  std::vector<std::thread> producers;
+  for (int producer = 0; producer < kProducers; ++producer) {
+    producers.emplace_back([&queue, &running, producer] {
+      // producer |p| posts p + 1, p + 1 + kProducers, ... so every argument
+      // names one post.
+      for (int i = 0; i < kPostsPerProducer; ++i) {
+        queue.Post(ControlCommand::kSeek, double(producer + 1 + i * kProducers));
+      }
+      running.fetch_sub(1, std::memory_order_release);
+    });
+  }
+
+  std::vector<bool> taken(size_t(kProducers * kPostsPerProducer + 1), false);
+  auto duplicates = 0;
+  auto takes = 0;
+  double last = 0;
+  auto consume = [&] {
+    double argument;
+    if (!queue.Take(ControlCommand::kSeek, &argument)) {
+      return;
+    }
+    takes++;
+    auto index = size_t(argument);
+    if (taken[index]) {
+      duplicates++;
+    }
+    taken[index] = true;
+    last = argument;
+  };
+  while (running.load(std::memory_order_acquire) > 0) {
+    consume();
+  }
+  consume();
+  for (auto &producer : producers) {
+    producer.join();
+  }
+
+  Check(duplicates == 0, "%d of %d takes took a post again", duplicates, takes);
+  Check(queue.TakenCount(ControlCommand::kSeek) == uint32_t(kProducers * kPostsPerProducer),
+        "taken count %u after %d posts", queue.TakenCount(ControlCommand::kSeek), kProducers * kPostsPerProducer);
+  Check(queue.PostedCount(ControlCommand::kSeek) == uint32_t(kProducers * kPostsPerProducer), "posted count");
+  Check(queue.Argument(ControlCommand::kSeek, -1) == last, "the last take is the latest argument");
+  double argument;
+  Check(!queue.Take(ControlCommand::kSeek, &argument), "nothing left to take");
+}
+
+void TestKindsAreIndependent() {
+  ControlQueue queue;
+  double argument = 0;
+  Check(queue.Argument(ControlCommand::kVolume, 0.5) == 0.5, "fallback before the first post");
+  queue.Post(ControlCommand::kVolume, 0.25);
+  queue.Post(ControlCommand::kVolume, 0.75);
+  Check(!queue.Take(ControlCommand::kPlaybackRate, &argument), "another kind was not posted");
+  Check(queue.Take(ControlCommand::kVolume, &argument) && argument == 0.75, "the latest post replaces the one before");
+  Check(!queue.Take(ControlCommand::kVolume, &argument), "a post is taken once");
+  Check(queue.PostedCount(ControlCommand::kVolume) == 2 && queue.TakenCount(ControlCommand::kVolume) == 2,
+        "both posts are counted");
+}
+
+}
+
+int main() {
+  TestKindsAreIndependent();
+  TestEachPostIsTakenOnce();
+  return TestResult();
+}
@@ -0,0 +1,191 @@
+//
+// Plays a streaming player with a file queued after it, rendered offline
+// through the shared mixer. Bytes are appended after the streaming track
+// was played and dropped, and players are disposed while they stream.
+//
+// usage: ogg_opus_player_queue_test
+// exits with 1 and prints the failed checks if any.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "../benchmark/benchmark_utils.h"
+#include "../audio_mixer.h"
+#include "../ogg_opus_player.h"
+#include "dart_api_dl.h"
+#include "test_utils.h"
+
+namespace {
+
+// messages of ogg_opus_player.cc, see DartPortMessage and PlayerEventKind.
+const int64_t kPlayerReachEnded = 0;
+const int64_t kPlayerEventTrackChanged = 1;
+const int64_t kPlayerEventSourceReleased = 2;
+
+std::atomic<bool> reach_ended(false);
+std::atomic<int64_t> track_index(0);
+// bit i is set once source i was released.
+std::atomic<int64_t> released_sources(0);
+
+bool PostInteger(Dart_Port_DL, int64_t message) {
+  if (message == kPlayerReachEnded) {
+    reach_ended.store(true, std::memory_order_release);
+  }
+  return true;
+}
+
+bool PostCObject(Dart_Port_DL, Dart_CObject *message) {
+  if (message->type != Dart_CObject_kArray || message->value.as_array.length < 2) {
+    return true;
+  }
+  auto **values = message->value.as_array.values;
+  auto kind = values[0]->value.as_int64;
+  if (kind == kPlayerEventTrackChanged) {
+    track_index.store(values[1]->value.as_int64, std::memory_order_release);
+  } else if (kind == kPlayerEventSourceReleased) {
+    released_sources.fetch_or(int64_t(1) << values[1]->value.as_int64, std::memory_order_acq_rel);
+  }
+  return true;
+}
+
+std::vector<uint8_t> ReadFile(const char *path) {
+  std::vector<uint8_t> bytes;
+  if (FILE *file = fopen(path, "rb")) {
+    uint8_t buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+      bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    fclose(file);
+  }
+  return bytes;
+}
+
+// render a buffer, paced to leave the decoder thread room to keep up.
+void RenderBuffer() {
+  static std::vector<int16_t> output;
+  const auto &spec = AudioMixer::Instance()->spec();
+  output.resize(size_t(spec.frames_per_buffer) * spec.channels);
+  AudioMixer::Instance()->Mix(output.data(), spec.frames_per_buffer);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+}
+
+// render until |condition| holds, at most |max_buffers| buffers.
+template<typename Condition>
+bool RenderUntil(Condition condition, int max_buffers) {
+  for (int i = 0; i < max_buffers; ++i) {
+    if (condition()) {
+      return true;
+    }
+    RenderBuffer();
+  }
+  return condition();
+}
+
+void ResetMessages() {
+  reach_ended.store(false);
+  track_index.store(0);
+  released_sources.store(0);
+}
+
+// the streaming track plays to its end, the queued file after it. the
+// streaming reader is dropped once the file plays, bytes appended after
+// that must not reach it.
+void TestStreamThenFile(const std::vector<uint8_t> &stream_bytes, const char *queued_path) {
+  ResetMessages();
+  auto *player = ogg_opus_player_create_streaming(1);
+  Check(player != nullptr, "create a streaming player");
+  if (!player) {
+    return;
+  }
+  auto half = int64_t(stream_bytes.size() / 2);
+  ogg_opus_player_append_data(player, stream_bytes.data(), half);
+  Check(ogg_opus_player_enqueue_file(player, queued_path) == 0, "enqueue a file after the stream");
+  ogg_opus_player_play(player);
+  RenderUntil([] { return false; }, 20);
+  ogg_opus_player_append_data(player, stream_bytes.data() + half, int64_t(stream_bytes.size()) - half);
+  ogg_opus_player_end_of_data(player);
+
+  Check(RenderUntil([] { return track_index.load() == 1; }, 2000), "the queued file starts after the stream");
+  Check(RenderUntil([] { return (released_sources.load() & 1) != 0; }, 200),
+        "the stream is released once the queued file plays");
+  // the stream outlives the reader that played it.
+  ogg_opus_player_append_data(player, stream_bytes.data(), half);
+  ogg_opus_player_end_of_data(player);
+
+  Check(RenderUntil([] { return reach_ended.load(); }, 2000), "the queued file plays to its end");
+  ogg_opus_player_dispose(player);
+  Check(released_sources.load() == 3, "dispose releases the queued file");
+}
+
+// dispose while the stream waits for more bytes, with tracks still queued.
+void TestDisposeWhileStreaming(const std::vector<uint8_t> &stream_bytes, const char *queued_path) {
+  ResetMessages();
+  auto *player = ogg_opus_player_create_streaming(1);
+  Check(player != nullptr, "create a streaming player");
+  if (!player) {
+    return;
+  }
+  ogg_opus_player_append_data(player, stream_bytes.data(), int64_t(stream_bytes.size() / 4));
+  ogg_opus_player_enqueue_file(player, queued_path);
+  ogg_opus_player_enqueue_file(player, queued_path);
+  ogg_opus_player_play(player);
+  RenderUntil([] { return false; }, 50);
+  ogg_opus_player_dispose(player);
+  Check(released_sources.load() == 7, "dispose releases the stream and the queued files");
+}
+
+// dispose before the stream headers arrived, the decoder thread still waits
+// to open the reader.
+void TestDisposeBeforeHeaders(const char *queued_path) {
+  ResetMessages();
+  auto *player = ogg_opus_player_create_streaming(1);
+  Check(player != nullptr, "create a streaming player");
+  if (!player) {
+    return;
+  }
+  ogg_opus_player_enqueue_file(player, queued_path);
+  ogg_opus_player_play(player);
+  RenderUntil([] { return false; }, 5);
+  ogg_opus_player_dispose(player);
+  Check(released_sources.load() == 3, "dispose releases a stream that never opened");
+}
+
+}
+
+int main() {
+  const char *stream_path = "ogg_opus_player_queue_test_stream.ogg";
+  const char *queued_path = "ogg_opus_player_queue_test_queued.ogg";
+  if (GenerateOggOpusFile(stream_path, 2, 2) != 0 || GenerateOggOpusFile(queued_path, 1, 1) != 0) {
+    printf("failed to generate the test files\n");
+    return 1;
+  }
+  auto stream_bytes = ReadFile(stream_path);
+  if (stream_bytes.empty()) {
+    printf("failed to read %s\n", stream_path);
+    return 1;
+  }
+
+  // no dart vm here, record the messages the players post instead.
+  Dart_PostInteger_DL = PostInteger;
+  Dart_PostCObject_DL = PostCObject;
+
+  AudioOutputSpec spec;
+  spec.sample_rate = 48000;
+  spec.channels = 2;
+  spec.frames_per_buffer = 1024;
+  spec.format = SampleFormat::kInt16;
+  AudioMixer::Instance()->OpenOffline(spec);
+
+  TestStreamThenFile(stream_bytes, queued_path);
+  TestDisposeWhileStreaming(stream_bytes, queued_path);
+  TestDisposeBeforeHeaders(queued_path);
+
+  remove(stream_path);
+  remove(queued_path);
+  return TestResult();
+}
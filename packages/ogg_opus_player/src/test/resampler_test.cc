@@ -0,0 +1,157 @@
+//
+// Checks the polyphase resampler against sines computed at the output rate,
+// its alias rejection, the frames it writes until Flush(), and Reset().
+//
+// usage: ogg_opus_resampler_test
+// exits with 1 and prints the failed checks if any.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+#include <vector>
+
+#include "../polyphase_resampler.h"
+#include "test_utils.h"
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+const int kOpusRate = 48000;
+
+// 0.5 * sin(2 pi |frequency| t + |channel|) at |rate|, |channel| shifts the
+// phase so the channels differ.
+std::vector<float> Sine(double frequency, int rate, int frames, int channels) {
+  std::vector<float> samples(size_t(frames) * channels);
+  for (int i = 0; i < frames; ++i) {
+    for (int c = 0; c < channels; ++c) {
+      samples[size_t(i) * channels + c] = float(0.5 * std::sin(2 * kPi * frequency * i / rate + c));
+    }
+  }
+  return samples;
+}
+
+// resample all of |input| in chunks of |chunk_frames|, flushed at the end.
+template<typename T>
+std::vector<T> Resample(PolyphaseResampler &resampler, const std::vector<T> &input, int chunk_frames) {
+  auto channels = resampler.channels();
+  auto frames = int(input.size()) / channels;
+  std::vector<T> output;
+  auto buffer_frames = resampler.MaxOutputFrames(std::max(chunk_frames, int(PolyphaseResampler::kTapsPerPhase)));
+  std::vector<T> buffer(size_t(buffer_frames) * channels);
+  for (int offset = 0; offset < frames; offset += chunk_frames) {
+    auto count = std::min(chunk_frames, frames - offset);
+    auto written = resampler.Process(input.data() + size_t(offset) * channels, count, buffer.data());
+    output.insert(output.end(), buffer.begin(), buffer.begin() + written * channels);
+  }
+  auto written = resampler.Flush(buffer.data());
+  output.insert(output.end(), buffer.begin(), buffer.begin() + written * channels);
+  return output;
+}
+
+// largest difference of |a| and |b| over frames [|from|, |to|).
+double MaxError(const std::vector<float> &a, const std::vector<float> &b, int channels, int from, int to) {
+  double error = 0;
+  for (size_t i = size_t(from) * channels; i < size_t(to) * channels && i < a.size() && i < b.size(); ++i) {
+    error = std::max(error, double(std::fabs(a[i] - b[i])));
+  }
+  return error;
+}
+
+double Rms(const std::vector<float> &samples, int channels, int from, int to) {
+  double sum = 0;
+  for (size_t i = size_t(from) * channels; i < size_t(to) * channels; ++i) {
+    sum += double(samples[i]) * samples[i];
+  }
+  return std::sqrt(sum / (double(to - from) * channels));
+}
+
+// a 1kHz sine resampled from the opus rate matches the sine computed at the
+// output rate, and back to the opus rate it matches the input. the filter
+// ramps up over its first taps and rings out after the end, those frames
+// are not compared.
+void TestSineRoundTrip(int rate) {
+  const int kChannels = 2;
+  const int kSeconds = 1;
+  auto input = Sine(1000, kOpusRate, kOpusRate * kSeconds, kChannels);
+  PolyphaseResampler to_device(kOpusRate, rate, kChannels);
+  auto output = Resample(to_device, input, 960);
+  auto expected = Sine(1000, rate, rate * kSeconds, kChannels);
+  auto edge = PolyphaseResampler::kTapsPerPhase * 2;
+  auto error = MaxError(output, expected, kChannels, edge, rate * kSeconds - edge);
+  Check(error < 1e-4, "48000 to %d: a 1kHz sine is off by %g", rate, error);
+
+  PolyphaseResampler to_opus(rate, kOpusRate, kChannels);
+  auto round_trip = Resample(to_opus, output, 441);
+  error = MaxError(round_trip, input, kChannels, edge * 4, kOpusRate * kSeconds - edge * 4);
+  Check(error < 2e-4, "48000 to %d and back: a 1kHz sine is off by %g", rate, error);
+}
+
+// a sine between the passband and the input nyquist frequency would alias
+// into the output, the filter removes it.
+void TestAliasRejection(int rate, double frequency, double min_rejection_db) {
+  auto input = Sine(frequency, kOpusRate, kOpusRate, 1);
+  PolyphaseResampler resampler(kOpusRate, rate, 1);
+  auto output = Resample(resampler, input, 960);
+  auto edge = PolyphaseResampler::kTapsPerPhase * 2;
+  auto rejection_db = 20 * std::log10(Rms(input, 1, 0, kOpusRate) / Rms(output, 1, edge, rate - edge));
+  Check(rejection_db >= min_rejection_db, "48000 to %d: a %gHz sine is only %.1fdB down", rate, frequency,
+        rejection_db);
+}
+
+// every input frame comes out once Flush() pushed the filter delay out,
+// whatever the chunks.
+void TestFrameCount(int rate) {
+  for (auto frames : {1, 47, 960, 1000, 48000, 48001}) {
+    for (auto chunk : {1, 480, 1024, 4096}) {
+      PolyphaseResampler resampler(kOpusRate, rate, 1);
+      auto output = Resample(resampler, Sine(440, kOpusRate, frames, 1), chunk);
+      auto expected = (int64_t(frames) * rate + kOpusRate - 1) / kOpusRate;
+      if (!Check(int64_t(output.size()) == expected, "48000 to %d: %d frames in chunks of %d give %zu, not %lld",
+                 rate, frames, chunk, output.size(), (long long) expected)) {
+        return;
+      }
+    }
+  }
+}
+
+// the output does not depend on how the input is chunked, and a Reset() or
+// Flush() resampler starts over like a new one.
+template<typename T>
+void TestResetAndChunking(int rate) {
+  const int kChannels = 2;
+  auto sine = Sine(700, kOpusRate, 12345, kChannels);
+  std::vector<T> input(sine.size());
+  for (size_t i = 0; i < sine.size(); ++i) {
+    input[i] = T(std::is_same<T, float>::value ? sine[i] : std::lround(sine[i] * 32767));
+  }
+
+  PolyphaseResampler fresh(kOpusRate, rate, kChannels);
+  auto expected = Resample(fresh, input, 12345);
+  PolyphaseResampler chunked(kOpusRate, rate, kChannels);
+  Check(Resample(chunked, input, 333) == expected, "48000 to %d: chunks change the output", rate);
+
+  // flushed by Resample(), then half a stream dropped by Reset().
+  Check(Resample(chunked, input, 960) == expected, "48000 to %d: a flushed resampler does not start over", rate);
+  std::vector<T> buffer(size_t(chunked.MaxOutputFrames(6000)) * kChannels);
+  chunked.Process(input.data(), 6000, buffer.data());
+  chunked.Reset();
+  Check(Resample(chunked, input, 960) == expected, "48000 to %d: a reset resampler does not start over", rate);
+}
+
+}
+
+int main() {
+  for (auto rate : {44100, 16000, 96000}) {
+    TestSineRoundTrip(rate);
+    TestFrameCount(rate);
+    TestResetAndChunking<float>(rate);
+    TestResetAndChunking<int16_t>(rate);
+  }
+  TestAliasRejection(44100, 23000, 75);
+  TestAliasRejection(16000, 10000, 75);
+  Check(PolyphaseResampler::IsSupported(48000, 44100), "48000 to 44100 is supported");
+  return TestResult();
+}
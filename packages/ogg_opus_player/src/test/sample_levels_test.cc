@@ -0,0 +1,97 @@
+//
+// Checks every level kernel the cpu supports against the scalar kernel.
+//
+// usage: ogg_opus_sample_levels_test
+// exits with 1 and prints the failed checks if any.
+//
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../sample_levels.h"
+#include "test_utils.h"
+
+namespace {
+
+// kMaxSplitIterations of sample_levels.cc, the simd kernels fold their split
+// square sums after this many vectors.
+const int kMaxSplitIterations = 1 << 15;
+
+bool operator==(const SampleLevels &a, const SampleLevels &b) {
+  return a.min == b.min && a.max == b.max && a.square_sum == b.square_sum;
+}
+
+// |kernel| and the scalar kernel agree on |count| samples from |offset|.
+bool Matches(LevelKernel kernel, const std::vector<int16_t> &samples, int offset, int count) {
+  auto expected = MeasureLevels(LevelKernel::kScalar, samples.data() + offset, count);
+  auto actual = MeasureLevels(kernel, samples.data() + offset, count);
+  return Check(actual == expected, "%s: %d samples from %d: min %d max %d sum %lld, scalar %d %d %lld",
+               LevelKernelName(kernel), count, offset, actual.min, actual.max, (long long) actual.square_sum,
+               expected.min, expected.max, (long long) expected.square_sum);
+}
+
+std::vector<int16_t> RandomSamples(std::mt19937 &random, size_t count) {
+  std::uniform_int_distribution<int> distribution(-32768, 32767);
+  std::vector<int16_t> samples(count);
+  for (auto &sample : samples) {
+    sample = int16_t(distribution(random));
+  }
+  return samples;
+}
+
+void TestKernel(LevelKernel kernel) {
+  std::mt19937 random(int(kernel) + 1);
+
+  // every length up to two avx2 vectors and one more, from every offset in a
+  // vector, so loads are unaligned and the tails have every size.
+  auto short_samples = RandomSamples(random, 64);
+  for (int count = 0; count <= 17; ++count) {
+    for (int offset = 0; offset < 16; ++offset) {
+      if (!Matches(kernel, short_samples, offset, count)) {
+        return;
+      }
+    }
+  }
+  Check(MeasureLevels(kernel, short_samples.data(), 0) == SampleLevels{0, 0, 0}, "%s: no samples",
+        LevelKernelName(kernel));
+
+  // tails that are not a multiple of 8 or 16 after whole vectors.
+  auto samples = RandomSamples(random, 4096);
+  for (auto count : {31, 33, 100, 1001, 4093}) {
+    Matches(kernel, samples, 3, count);
+  }
+
+  // the extremes, alone and mixed, where the squares of a pair only fit
+  // unsigned 32 bits.
+  std::vector<int16_t> full_scale(4099, -32768);
+  Matches(kernel, full_scale, 0, int(full_scale.size()));
+  for (size_t i = 0; i < full_scale.size(); i += 3) {
+    full_scale[i] = 32767;
+  }
+  Matches(kernel, full_scale, 1, int(full_scale.size()) - 1);
+
+  // longer than a split block of either kernel, all -32768 fill the split
+  // sums to their limit.
+  auto long_count = 16 * kMaxSplitIterations * 2 + 13;
+  std::vector<int16_t> long_full_scale(size_t(long_count), -32768);
+  Matches(kernel, long_full_scale, 0, long_count);
+  Check(MeasureLevels(kernel, long_full_scale.data(), long_count).square_sum
+            == int64_t(long_count) * 32768 * 32768, "%s: %d full scale samples", LevelKernelName(kernel), long_count);
+  auto long_samples = RandomSamples(random, size_t(long_count));
+  Matches(kernel, long_samples, 0, long_count);
+  Matches(kernel, long_samples, 5, 8 * kMaxSplitIterations + 7);
+}
+
+}
+
+int main() {
+  for (auto kernel : {LevelKernel::kScalar, LevelKernel::kSse2, LevelKernel::kAvx2}) {
+    if (!IsLevelKernelSupported(kernel)) {
+      printf("%s: not supported, skipped\n", LevelKernelName(kernel));
+      continue;
+    }
+    TestKernel(kernel);
+  }
+  return TestResult();
+}
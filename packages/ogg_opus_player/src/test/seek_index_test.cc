@@ -0,0 +1,280 @@
+//
+// Checks that seeks through a SeekIndex decode the same pcm as op_pcm_seek,
+// that indexes survive Save() and Load(), and that the index of a file that
+// grew is updated incrementally.
+//
+// usage: ogg_opus_seek_index_test
+// exits with 1 and prints the failed checks if any.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../benchmark/benchmark_utils.h"
+#include "../file_identity.h"
+#include "../mapped_file_stream.h"
+#include "../ogg_opus_reader.h"
+#include "../pcm_cache.h"
+#include "../seek_index.h"
+#include "test_utils.h"
+
+namespace {
+
+std::vector<uint8_t> ReadFile(const std::string &path) {
+  std::vector<uint8_t> bytes;
+  if (FILE *file = fopen(path.c_str(), "rb")) {
+    uint8_t buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+      bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    fclose(file);
+  }
+  return bytes;
+}
+
+bool WriteFile(const std::string &path, const uint8_t *data, size_t size, const char *mode = "wb") {
+  auto *file = fopen(path.c_str(), mode);
+  if (!file) {
+    return false;
+  }
+  auto written = fwrite(data, 1, size, file);
+  return fclose(file) == 0 && written == size;
+}
+
+// start of every ogg page of |bytes|, and its size as the last entry.
+std::vector<size_t> PageOffsets(const std::vector<uint8_t> &bytes) {
+  std::vector<size_t> offsets;
+  size_t offset = 0;
+  while (offset + 27 <= bytes.size()) {
+    offsets.push_back(offset);
+    auto segments = bytes[offset + 26];
+    size_t body = 0;
+    for (int i = 0; i < segments; ++i) {
+      body += bytes[offset + 27 + size_t(i)];
+    }
+    offset += 27 + segments + body;
+  }
+  offsets.push_back(bytes.size());
+  return offsets;
+}
+
+// a stream that remembers the lowest offset it was read at.
+class WatchedStream : public OggOpusStream {
+ public:
+  explicit WatchedStream(const char *file_path) : file_(file_path) {}
+
+  int Read(unsigned char *buffer, int size) override {
+    lowest_read_offset_ = std::min(lowest_read_offset_, file_.Tell());
+    return file_.Read(buffer, size);
+  }
+
+  bool IsSeekable() const override { return true; }
+
+  int Seek(int64_t offset, int whence) override { return file_.Seek(offset, whence); }
+
+  int64_t Tell() override { return file_.Tell(); }
+
+  int64_t lowest_read_offset() const { return lowest_read_offset_; }
+
+ private:
+  FileStream file_;
+  int64_t lowest_read_offset_ = INT64_MAX;
+};
+
+std::shared_ptr<const SeekIndex> BuildIndex(const std::string &path, const SeekIndex *previous) {
+  FileIdentity identity;
+  if (!GetFileIdentity(path.c_str(), &identity)) {
+    return nullptr;
+  }
+  FileStream stream(path.c_str());
+  return SeekIndex::Build(&stream, identity, previous);
+}
+
+// both indexes jump to the same page for every frame up to |frames|.
+bool SameCheckpoints(const SeekIndex &a, const SeekIndex &b, int64_t frames) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (int64_t frame = 0; frame <= frames; frame += 480) {
+    const auto *x = a.Find(frame);
+    const auto *y = b.Find(frame);
+    if ((x == nullptr) != (y == nullptr) || (x && (x->granule != y->granule || x->offset != y->offset))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// random seeks, to the edges and inside the first preroll, read the same
+// pcm with and without the index.
+void TestSeeksMatchOpusfile(const std::string &path) {
+  // a reader opened before the file is indexed bisects with op_pcm_seek.
+  OggOpusReader bisecting(path.c_str());
+  auto index = SeekIndexRegistry::Instance()->Build(path.c_str(), nullptr);
+  if (!Check(index != nullptr && index->size() > 0, "index %s", path.c_str())) {
+    return;
+  }
+  OggOpusReader indexed(path.c_str());
+  auto total = bisecting.GetTotalFrames();
+  auto channels = bisecting.GetChannelCount();
+  if (!Check(total > 0 && indexed.GetTotalFrames() == total, "open %s", path.c_str())) {
+    return;
+  }
+
+  std::vector<int64_t> targets = {0, 1, SeekIndex::kPrerollFrames - 1, SeekIndex::kPrerollFrames,
+                                  SeekIndex::kPrerollFrames + 1, total / 2, total - 960, total - 1, total};
+  std::mt19937_64 random(3);
+  std::uniform_int_distribution<int64_t> distribution(0, total - 1);
+  for (int i = 0; i < 300; ++i) {
+    targets.push_back(distribution(random));
+  }
+
+  const int kReadFrames = 1920;
+  std::vector<opus_int16> expected(size_t(kReadFrames * channels));
+  std::vector<opus_int16> actual(size_t(kReadFrames * channels));
+  auto jumps = 0;
+  auto mismatches = 0;
+  int64_t first_mismatch = -1;
+  for (auto target : targets) {
+    if (index->Find(target)) {
+      jumps++;
+    }
+    auto expected_frame = bisecting.Seek(target);
+    auto actual_frame = indexed.Seek(target);
+    auto expected_read = bisecting.ReadPcmData(expected.data(), kReadFrames);
+    auto actual_read = indexed.ReadPcmData(actual.data(), kReadFrames);
+    if (expected_frame != actual_frame || expected_read != actual_read
+        || !std::equal(expected.begin(), expected.begin() + expected_read * channels, actual.begin())) {
+      first_mismatch = mismatches++ == 0 ? target : first_mismatch;
+    }
+  }
+  Check(mismatches == 0, "%d of %zu seeks of %s differ from op_pcm_seek, the first to %lld",
+        mismatches, targets.size(), path.c_str(), (long long) first_mismatch);
+  // seeks into the first page and its preroll are left to opusfile.
+  Check(jumps >= int(targets.size()) * 3 / 4, "only %d of %zu seeks of %s jump through the index",
+        jumps, targets.size(), path.c_str());
+}
+
+void TestSaveAndLoad(const std::string &path, const std::string &index_path, int64_t frames) {
+  auto index = BuildIndex(path, nullptr);
+  if (!Check(index != nullptr, "index %s", path.c_str())) {
+    return;
+  }
+  Check(index->Save(index_path.c_str()), "save %s", index_path.c_str());
+  auto loaded = SeekIndex::Load(index_path.c_str());
+  if (!Check(loaded != nullptr, "load %s", index_path.c_str())) {
+    return;
+  }
+  Check(loaded->identity().size == index->identity().size
+            && loaded->identity().modified_at == index->identity().modified_at,
+        "a loaded index keeps the identity of the file");
+  Check(SameCheckpoints(*index, *loaded, frames), "a loaded index has the checkpoints it was saved with");
+
+  // every truncated sidecar, e.g. written by a process that was killed, and
+  // a foreign file are rejected.
+  auto bytes = ReadFile(index_path);
+  auto truncated_path = index_path + ".truncated";
+  auto accepted = 0;
+  for (size_t size = 0; size < bytes.size(); size += size < 64 ? 1 : 61) {
+    WriteFile(truncated_path, bytes.data(), size);
+    if (SeekIndex::Load(truncated_path.c_str())) {
+      accepted++;
+    }
+  }
+  Check(accepted == 0, "%d truncated sidecars of %zu bytes are accepted", accepted, bytes.size());
+  auto foreign = bytes;
+  foreign[0] = 'X';
+  WriteFile(truncated_path, foreign.data(), foreign.size());
+  Check(SeekIndex::Load(truncated_path.c_str()) == nullptr, "a sidecar with another magic is rejected");
+  foreign = bytes;
+  foreign[4]++;
+  WriteFile(truncated_path, foreign.data(), foreign.size());
+  Check(SeekIndex::Load(truncated_path.c_str()) == nullptr, "a sidecar of another version is rejected");
+  Check(SeekIndex::Load((index_path + ".missing").c_str()) == nullptr, "a missing sidecar is rejected");
+  remove(truncated_path.c_str());
+}
+
+// a file written page by page: the index of its first half is updated with
+// the pages appended since, and ends up like the index of the whole file.
+void TestIncrementalUpdate(const std::string &source_path, const std::string &path, int64_t frames) {
+  auto bytes = ReadFile(source_path);
+  auto pages = PageOffsets(bytes);
+  if (!Check(pages.size() > 10 && pages.back() == bytes.size(), "parse the pages of %s", source_path.c_str())) {
+    return;
+  }
+  auto full = BuildIndex(source_path, nullptr);
+  if (!Check(full != nullptr, "index %s", source_path.c_str())) {
+    return;
+  }
+
+  // the first half, and a page cut short as a writer leaves it.
+  auto half = pages[pages.size() / 2];
+  auto last_half_page = pages[pages.size() / 2 - 1];
+  WriteFile(path, bytes.data(), half + 10);
+  auto index_path = path + ".index";
+  auto registered = SeekIndexRegistry::Instance()->Build(path.c_str(), index_path.c_str());
+  auto prefix = BuildIndex(path, nullptr);
+  if (!Check(registered != nullptr && prefix != nullptr, "index the first half of %s", path.c_str())) {
+    return;
+  }
+  Check(prefix->size() < full->size(), "the first half has fewer checkpoints");
+
+  WriteFile(path, bytes.data() + half + 10, bytes.size() - half - 10, "ab");
+  FileIdentity identity;
+  GetFileIdentity(path.c_str(), &identity);
+  WatchedStream stream(path.c_str());
+  auto updated = SeekIndex::Build(&stream, identity, prefix.get());
+  if (!Check(updated != nullptr, "update the index of %s", path.c_str())) {
+    return;
+  }
+  Check(stream.lowest_read_offset() >= int64_t(last_half_page),
+        "the update read from %lld, before the last page indexed at %lld",
+        (long long) stream.lowest_read_offset(), (long long) last_half_page);
+  Check(SameCheckpoints(*full, *updated, frames), "an updated index matches the index of the whole file");
+
+  // readers of the file update the registered index and its sidecar.
+  auto looked_up = SeekIndexRegistry::Instance()->Lookup(identity);
+  Check(looked_up != nullptr && SameCheckpoints(*full, *looked_up, frames), "the registry updates a grown file");
+  auto sidecar = SeekIndex::Load(index_path.c_str());
+  Check(sidecar != nullptr && SameCheckpoints(*full, *sidecar, frames), "the sidecar of a grown file is rewritten");
+
+  // a file rewritten with other pages is scanned from the start.
+  auto rewritten = bytes;
+  rewritten[last_half_page + 6] ^= 0xff;
+  WriteFile(path, rewritten.data(), rewritten.size());
+  GetFileIdentity(path.c_str(), &identity);
+  WatchedStream rescanned(path.c_str());
+  SeekIndex::Build(&rescanned, identity, prefix.get());
+  Check(rescanned.lowest_read_offset() == 0, "a rewritten file is scanned from the start");
+  remove(index_path.c_str());
+  remove(path.c_str());
+}
+
+}
+
+int main() {
+  // the cache would serve replays without seeking.
+  PcmCache::Instance()->SetCapacity(0);
+
+  const std::string mono_path = "ogg_opus_seek_index_test_mono.ogg";
+  const std::string stereo_path = "ogg_opus_seek_index_test_stereo.ogg";
+  if (GenerateOggOpusFile(mono_path, 60, 1) != 0 || GenerateOggOpusFile(stereo_path, 20, 2) != 0) {
+    printf("failed to generate the test files\n");
+    return 1;
+  }
+
+  TestSeeksMatchOpusfile(mono_path);
+  TestSeeksMatchOpusfile(stereo_path);
+  TestSaveAndLoad(mono_path, mono_path + ".index", 60 * kOpusSampleRate);
+  TestIncrementalUpdate(stereo_path, "ogg_opus_seek_index_test_growing.ogg", 20 * kOpusSampleRate);
+
+  remove(mono_path.c_str());
+  remove((mono_path + ".index").c_str());
+  remove(stereo_path.c_str());
+  return TestResult();
+}
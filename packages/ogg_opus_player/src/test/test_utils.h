@@ -0,0 +1,43 @@
+//
+// Shared helpers for the ogg_opus_player tests. Each test is a plain
+// executable run by ctest, it fails by exiting with 1.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__TEST_UTILS_H_
+#define OGG_OPUS_PLAYER_LIBRARY__TEST_UTILS_H_
+
+#include <cstdarg>
+#include <cstdio>
+
+// count of the checks failed so far.
+inline int &TestFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+// print the printf style |format| if |condition| does not hold and count the
+// failure. return |condition|.
+inline bool Check(bool condition, const char *format, ...) {
+  if (!condition) {
+    va_list arguments;
+    va_start(arguments, format);
+    printf("FAILED: ");
+    vprintf(format, arguments);
+    printf("\n");
+    va_end(arguments);
+    TestFailures()++;
+  }
+  return condition;
+}
+
+// print the outcome of the test, the exit code of main().
+inline int TestResult() {
+  if (TestFailures() > 0) {
+    printf("%d checks failed\n", TestFailures());
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__TEST_UTILS_H_
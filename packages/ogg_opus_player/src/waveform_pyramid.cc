@@ -0,0 +1,150 @@
+//
+// Fixed size min / max / rms summary of a recording at every resolution.
+//
+
+#include "waveform_pyramid.h"
+
+#include <algorithm>
+
+#include "sample_levels.h"
+
+namespace {
+
+// squared int16 samples to squares of samples scaled to [-1, 1].
+const double kSquareScale = 1.0 / (32768.0 * 32768.0);
+
+WaveformBucket Merge(const WaveformBucket &a, const WaveformBucket &b) {
+  return {std::min(a.min, b.min), std::max(a.max, b.max), (a.mean_square + b.mean_square) / 2};
+}
+
+}
+
+WaveformPyramid::WaveformPyramid() : levels_(kLevels) {
+  int64_t span = kBlockSamples;
+  for (auto &level : levels_) {
+    level.buckets.resize(kLevelCapacity);
+    level.span = span;
+    span *= 2;
+  }
+}
+
+void WaveformPyramid::Push(const int16_t *samples, int count) {
+  while (count > 0) {
+    auto length = std::min(count, kBlockSamples - block_samples_);
+    auto levels = MeasureLevels(samples, length);
+    if (block_samples_ == 0) {
+      block_min_ = levels.min;
+      block_max_ = levels.max;
+      block_square_sum_ = levels.square_sum;
+    } else {
+      block_min_ = std::min(block_min_, levels.min);
+      block_max_ = std::max(block_max_, levels.max);
+      block_square_sum_ += levels.square_sum;
+    }
+    block_samples_ += length;
+    samples += length;
+    count -= length;
+    if (block_samples_ == kBlockSamples) {
+      Complete(0, {block_min_, block_max_, float(double(block_square_sum_) * kSquareScale / kBlockSamples)});
+      block_samples_ = 0;
+    }
+  }
+}
+
+void WaveformPyramid::Complete(int level, const WaveformBucket &bucket) {
+  auto &current = levels_[level];
+  current.buckets[current.count & (kLevelCapacity - 1)] = bucket;
+  current.count++;
+  if (level == kLevels - 1) {
+    if (current.count == kLevelCapacity) {
+      Compact();
+    }
+    return;
+  }
+
+  auto &parent = levels_[level + 1];
+  if (parent.pending_children == 0) {
+    parent.pending_min = bucket.min;
+    parent.pending_max = bucket.max;
+    parent.pending_square_sum = 0;
+  } else {
+    parent.pending_min = std::min(parent.pending_min, bucket.min);
+    parent.pending_max = std::max(parent.pending_max, bucket.max);
+  }
+  parent.pending_square_sum += bucket.mean_square;
+  if (++parent.pending_children == parent.children_per_bucket) {
+    parent.pending_children = 0;
+    Complete(level + 1, {parent.pending_min, parent.pending_max,
+                         float(parent.pending_square_sum / parent.children_per_bucket)});
+  }
+}
+
+void WaveformPyramid::Compact() {
+  auto &top = levels_[kLevels - 1];
+  for (int i = 0; i < kLevelCapacity / 2; ++i) {
+    top.buckets[i] = Merge(top.buckets[2 * i], top.buckets[2 * i + 1]);
+  }
+  // the pending bucket started at the end of the last pair, it keeps going
+  // until it covers the doubled span.
+  top.count = kLevelCapacity / 2;
+  top.span *= 2;
+  top.children_per_bucket *= 2;
+}
+
+int64_t WaveformPyramid::Oldest(int level) const {
+  return std::max<int64_t>(0, levels_[level].count - kLevelCapacity);
+}
+
+void WaveformPyramid::Accumulate(int level, int64_t from, int64_t to, Accumulator *accumulator) const {
+  const auto &current = levels_[level];
+  auto first = std::max(from / current.span, Oldest(level));
+  auto last = std::min((to + current.span - 1) / current.span, current.count);
+  for (auto k = first; k < last; ++k) {
+    const auto &bucket = current.buckets[k & (kLevelCapacity - 1)];
+    accumulator->min = std::min(accumulator->min, bucket.min);
+    accumulator->max = std::max(accumulator->max, bucket.max);
+    accumulator->square_sum += double(bucket.mean_square) * double(current.span);
+    accumulator->samples += current.span;
+  }
+  // the levels above lag behind by their pending bucket.
+  auto end = current.count * current.span;
+  if (level > 0 && to > end) {
+    Accumulate(level - 1, std::max(from, end), to, accumulator);
+  }
+}
+
+void WaveformPyramid::Render(int64_t first, int64_t last, int count, WaveformBucket *bars) const {
+  if (count <= 0) {
+    return;
+  }
+  last = std::min(last, samples());
+  first = std::max<int64_t>(0, std::min(first, last));
+  auto length = last - first;
+
+  // the coarsest level with at least one bucket per bar that still holds
+  // |first|, a bar then merges at most a few buckets.
+  int level = 0;
+  for (int i = kLevels - 1; i > 0; --i) {
+    if (levels_[i].span * count <= length) {
+      level = i;
+      break;
+    }
+  }
+  while (level < kLevels - 1 && Oldest(level) * levels_[level].span > first) {
+    ++level;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    auto from = first + length * i / count;
+    auto to = std::max(first + length * (i + 1) / count, from + 1);
+    Accumulator accumulator;
+    if (length > 0) {
+      Accumulate(level, from, to, &accumulator);
+    }
+    if (accumulator.samples == 0) {
+      bars[i] = {0, 0, 0};
+    } else {
+      bars[i] = {accumulator.min, accumulator.max, float(accumulator.square_sum / double(accumulator.samples))};
+    }
+  }
+}
@@ -0,0 +1,90 @@
+//
+// Fixed size min / max / rms summary of a recording at every resolution.
+//
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__WAVEFORM_PYRAMID_H_
+#define OGG_OPUS_PLAYER_LIBRARY__WAVEFORM_PYRAMID_H_
+
+#include <cstdint>
+#include <vector>
+
+struct WaveformBucket {
+  int16_t min;
+  int16_t max;
+  // mean of the squared samples, scaled to [-1, 1].
+  float mean_square;
+};
+
+// Mip levels of buckets, each level summarizes twice as many samples per
+// bucket as the one below and keeps only its most recent kLevelCapacity
+// buckets. The coarsest level keeps the whole recording, it merges its
+// buckets in pairs whenever it is full.
+//
+// Memory does not depend on the length of the recording, pushing a block
+// of samples updates a constant number of buckets on average, and a
+// summary of any range costs about as much as its bar count.
+class WaveformPyramid {
+
+ public:
+  // samples of a bucket of the finest level.
+  static const int kBlockSamples = 100;
+  static const int kLevels = 12;
+  // a power of two, ring indexes wrap with a mask.
+  static const int kLevelCapacity = 1024;
+
+  WaveformPyramid();
+
+  void Push(const int16_t *samples, int count);
+
+  // samples summarized so far, the block being filled is not.
+  int64_t samples() const { return levels_[0].count * kBlockSamples; }
+
+  // Summarize the samples in [|first|, |last|) in |count| bars of equal
+  // length. Parts older than the levels fine enough to resolve them are
+  // summarized at the resolution of the finest level that still holds them.
+  void Render(int64_t first, int64_t last, int count, WaveformBucket *bars) const;
+
+ private:
+  struct Level {
+    std::vector<WaveformBucket> buckets;
+    // buckets completed, bucket |k| is at |k| % kLevelCapacity.
+    int64_t count = 0;
+    // samples per bucket.
+    int64_t span = 0;
+
+    // buckets of the level below merged into the next bucket.
+    int children_per_bucket = 2;
+    int pending_children = 0;
+    int16_t pending_min = 0;
+    int16_t pending_max = 0;
+    double pending_square_sum = 0;
+  };
+
+  struct Accumulator {
+    int16_t min = INT16_MAX;
+    int16_t max = INT16_MIN;
+    double square_sum = 0;
+    int64_t samples = 0;
+  };
+
+  std::vector<Level> levels_;
+
+  int block_samples_ = 0;
+  int16_t block_min_ = 0;
+  int16_t block_max_ = 0;
+  int64_t block_square_sum_ = 0;
+
+  void Complete(int level, const WaveformBucket &bucket);
+
+  // merge each pair of buckets of the full coarsest level.
+  void Compact();
+
+  int64_t Oldest(int level) const;
+
+  // merge the buckets of |level| that overlap [|from|, |to|), the part
+  // past the completed buckets of |level| from the levels below.
+  void Accumulate(int level, int64_t from, int64_t to, Accumulator *accumulator) const;
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__WAVEFORM_PYRAMID_H_